@@ -23,10 +23,37 @@
 
 
 #include <Orochi/Orochi.h>
+#include <Orochi/OrochiCapture.h>
 #include <stdio.h>
 #include <string.h>
 #include <unordered_map>
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <unordered_set>
+#include <chrono>
+#include <type_traits>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <filesystem>
+#include <climits>
+#include <new>
+#include <tuple>
+#if defined( _WIN32 )
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <unistd.h>
+#endif
 
 
 
@@ -756,79 +783,2560 @@ namespace CU4ORO
 #define nvrtcVersion nvrtcVersion_oro
 
 
-///// END REGION: OROCHI_SUMMONER_REGION_orochi_cpp_define
-///// (region automatically generated by Orochi Summoner)
-#pragma endregion
+///// END REGION: OROCHI_SUMMONER_REGION_orochi_cpp_define
+///// (region automatically generated by Orochi Summoner)
+#pragma endregion
+
+
+#include "nvidia_hip_runtime_api_oro.h"
+#include "nvidia_hiprtc_oro.h"
+#endif
+}
+
+
+
+
+
+
+
+
+// the wrappers of the driver contexts, created by oroCtxCreate or adopted by oroCtxCreateFromRaw. guarded by mtx.
+std::unordered_map<void*, oroCtx> s_oroCtxs;
+static std::mutex mtx;
+// the current context of the calling thread, kept by oroCtxSetCurrent, oroCtxCreate and oroCtxDestroy so oroCtxGetCurrent doesn't go to the driver.
+// until the thread sets one, the driver is asked once. the contexts made current by the raw API ( oroCtxPushCurrent, oroSetDevice ) are not tracked.
+// the cache is dropped when any context is destroyed, as an other thread may destroy the current context of this one.
+thread_local static oroCtx s_ctx = nullptr;
+thread_local static bool s_ctxKnown = false;
+thread_local static uint32_t s_ctxGeneration = 0;
+// incremented by the destruction of a context.
+static std::atomic<uint32_t> s_ctxDestroyed( 0 );
+
+// caches ctx as current for the calling thread. generation is s_ctxDestroyed before the context was made or found current.
+static inline void cacheCurrentCtx( oroCtx ctx, bool known, uint32_t generation )
+{
+	s_ctx = ctx;
+	s_ctxKnown = known;
+	s_ctxGeneration = generation;
+}
+
+// the calls are dispatched to the API of the current context of the calling thread, so threads can drive devices of different APIs concurrently.
+// a thread without context uses the API given to oroInitialize.
+thread_local static oroApi s_api = (oroApi)0;
+static std::atomic<oroApi> s_defaultApi( ORO_API_HIP );
+
+static inline oroApi getCurrentApi()
+{
+	const oroApi api = s_api;
+	return api ? api : s_defaultApi.load( std::memory_order_relaxed );
+}
+static oroU32 s_loadedApis = 0;
+// the runtime compilers loaded by their first call, among s_loadedApis.
+static oroU32 s_deferredApis = 0;
+
+struct ioroCtx_t
+{
+public:
+
+	ioroCtx_t()
+	{
+		m_ptr = nullptr;
+		m_storage = 0;
+	}
+
+	void* m_ptr;
+private:
+	oroU32 m_storage;
+
+public:
+	oroApi getApi() const { return (oroApi)m_storage; }
+	void setApi( oroApi api ) { m_storage = api; }
+};
+
+struct ioroDevice
+{
+private:
+	oroU32 m_api : 8;
+	oroU32 m_deviceIdx : 16;
+
+public:
+	ioroDevice( int src = 0)
+	{
+		((int*)this)[0] = src;
+	}
+
+	oroApi getApi() const { return (oroApi)m_api; }
+	void setApi(oroApi api) { m_api = api; }
+	int getDevice() const { return m_deviceIdx; }
+	void setDevice( int d ) { m_deviceIdx = d; }
+};
+
+// the tracer of the calls going through __ORO_FUNCX, so of all the generated wrappers ( see oroTraceEnable ).
+// each call site registers its name and call once. a thread records its calls in its own ring buffer and statistics,
+// which only it writes, so recording takes no lock. the exporters read them while the threads record: the slots of the rings are atomic words,
+// and a slot overwritten while it's copied is dropped ( see traceRecord ).
+namespace
+{
+const int TRACE_MAX_FUNCTIONS = 512;
+// the buffers of the threads, about 350KB each. the ones of the threads which exited are reused, the calls of the threads beyond are not recorded.
+const int TRACE_MAX_THREADS = 256;
+// the arguments of a call, recorded for the functions the capture intercepts too ( see ORO_CAPTURE ).
+const int TRACE_MAX_ARGS = 12;
+const int TRACE_ARGS_CAPACITY = 2 * ORO_TRACE_CAPACITY;
+
+struct TraceEvent
+{
+	int m_id;
+	int m_result;
+	uint64_t m_start;
+	uint64_t m_duration;
+	// the arguments are in the ring of the thread from m_args, the ones set in m_pointers are pointers.
+	uint64_t m_args;
+	uint16_t m_numArgs;
+	uint16_t m_pointers;
+};
+
+// a TraceEvent in the ring, as relaxed atomic words.
+struct TraceEventSlot
+{
+	std::atomic<uint64_t> m_words[5];
+
+	void store( const TraceEvent& e )
+	{
+		m_words[0].store( (uint64_t)(uint32_t)e.m_id | ( (uint64_t)(uint32_t)e.m_result << 32 ), std::memory_order_relaxed );
+		m_words[1].store( e.m_start, std::memory_order_relaxed );
+		m_words[2].store( e.m_duration, std::memory_order_relaxed );
+		m_words[3].store( e.m_args, std::memory_order_relaxed );
+		m_words[4].store( (uint64_t)e.m_numArgs | ( (uint64_t)e.m_pointers << 16 ), std::memory_order_relaxed );
+	}
+	TraceEvent load() const
+	{
+		const uint64_t w0 = m_words[0].load( std::memory_order_relaxed );
+		const uint64_t w4 = m_words[4].load( std::memory_order_relaxed );
+		return { (int)(uint32_t)w0, (int)(uint32_t)( w0 >> 32 ), m_words[1].load( std::memory_order_relaxed ), m_words[2].load( std::memory_order_relaxed ),
+				 m_words[3].load( std::memory_order_relaxed ), (uint16_t)w4, (uint16_t)( w4 >> 16 ) };
+	}
+};
+
+struct TraceStats
+{
+	std::atomic<uint64_t> m_count{ 0 };
+	std::atomic<uint64_t> m_errors{ 0 };
+	std::atomic<uint64_t> m_totalNs{ 0 };
+	std::atomic<uint64_t> m_minNs{ UINT64_MAX };
+	std::atomic<uint64_t> m_maxNs{ 0 };
+	std::atomic<uint64_t> m_histogram[ORO_TRACE_NUM_BUCKETS] = {};
+};
+
+// the threads which recorded in a buffer, from the index of their first call.
+struct TraceOwner
+{
+	uint64_t m_first;
+	int m_tid;
+};
+
+struct TraceThread
+{
+	// guarded by s_traceMutex. the buffer is free again when m_live is false, the owners are trimmed to the calls still in m_events.
+	bool m_live = true;
+	std::vector<TraceOwner> m_owners;
+	// the number of calls recorded, the last ORO_TRACE_CAPACITY are in m_events.
+	std::atomic<uint64_t> m_head{ 0 };
+	TraceEventSlot m_events[ORO_TRACE_CAPACITY];
+	// the number of arguments recorded, the last TRACE_ARGS_CAPACITY are in m_args.
+	std::atomic<uint64_t> m_argsHead{ 0 };
+	std::atomic<uint64_t> m_args[TRACE_ARGS_CAPACITY];
+	TraceStats m_stats[TRACE_MAX_FUNCTIONS];
+};
+
+struct TraceFunction
+{
+	const char* m_name;
+	const char* m_call;
+};
+
+std::atomic<bool> s_traceEnabled( false );
+std::mutex s_traceMutex;
+// guarded by s_traceMutex. the buffers are kept after their threads exit, their calls are exported with the next ones.
+std::vector<std::unique_ptr<TraceThread>> s_traceThreads;
+int s_traceNextTid = 0;
+TraceFunction s_traceFunctions[TRACE_MAX_FUNCTIONS];
+std::atomic<int> s_numTraceFunctions( 0 );
+
+// the buffer of a thread, given back when the thread exits.
+struct TraceSlot
+{
+	TraceThread* m_thread = nullptr;
+	bool m_full = false;
+	~TraceSlot()
+	{
+		if( !m_thread ) 
+			return;
+		std::lock_guard<std::mutex> lock( s_traceMutex );
+		m_thread->m_live = false;
+	}
+};
+thread_local TraceSlot s_traceSlot;
+
+inline uint64_t traceNow() 
+{ 
+	return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count(); 
+}
+
+// -1 when the functions are more than TRACE_MAX_FUNCTIONS, their calls aren't recorded.
+int traceRegister( const char* name, const char* call )
+{
+	std::lock_guard<std::mutex> lock( s_traceMutex );
+	const int id = s_numTraceFunctions.load( std::memory_order_relaxed );
+	if( id == TRACE_MAX_FUNCTIONS ) 
+		return -1;
+	s_traceFunctions[id] = { name, call };
+	s_numTraceFunctions.store( id + 1, std::memory_order_release );
+	return id;
+}
+
+// nullptr when TRACE_MAX_THREADS threads are recording.
+TraceThread* getTraceThread()
+{
+	TraceSlot& slot = s_traceSlot;
+	if( slot.m_thread || slot.m_full ) 
+		return slot.m_thread;
+
+	std::lock_guard<std::mutex> lock( s_traceMutex );
+	TraceThread* thread = nullptr;
+	for( const auto& t : s_traceThreads )
+	{
+		if( !t->m_live ) 
+		{
+			thread = t.get();
+			break;
+		}
+	}
+	if( !thread ) 
+	{
+		if( s_traceThreads.size() == TRACE_MAX_THREADS ) 
+		{
+			slot.m_full = true;
+			return nullptr;
+		}
+		s_traceThreads.emplace_back( new TraceThread );
+		thread = s_traceThreads.back().get();
+	}
+	// the calls of the previous owners stay until they are overwritten, the statistics are summed over all the owners.
+	const uint64_t head = thread->m_head.load( std::memory_order_relaxed );
+	const uint64_t begin = head > ORO_TRACE_CAPACITY ? head - ORO_TRACE_CAPACITY : 0;
+	auto& owners = thread->m_owners;
+	size_t firstKept = 0;
+	while( firstKept + 1 < owners.size() && owners[firstKept + 1].m_first <= begin )
+		firstKept++;
+	owners.erase( owners.begin(), owners.begin() + firstKept );
+	owners.push_back( { head, s_traceNextTid++ } );
+	thread->m_live = true;
+	slot.m_thread = thread;
+	return thread;
+}
+
+void traceRecord( int id, uint64_t start, int result, const uint64_t* args, int numArgs, uint16_t pointers )
+{
+	const uint64_t duration = traceNow() - start;
+	TraceThread* t = getTraceThread();
+	if( !t ) 
+		return;
+
+	// the slots written next hold the oldest call and arguments, which the exporters may be copying. the fence orders the heads published
+	// before with these writes: an exporter which copied a slot after it's overwritten sees the new heads, and drops the slot.
+	std::atomic_thread_fence( std::memory_order_release );
+
+	const uint64_t argsHead = t->m_argsHead.load( std::memory_order_relaxed );
+	for( int i = 0; i < numArgs; i++ )
+		t->m_args[( argsHead + i ) % TRACE_ARGS_CAPACITY].store( args[i], std::memory_order_relaxed );
+	t->m_argsHead.store( argsHead + numArgs, std::memory_order_release );
+
+	const uint64_t head = t->m_head.load( std::memory_order_relaxed );
+	t->m_events[head % ORO_TRACE_CAPACITY].store( { id, result, start, duration, argsHead, (uint16_t)numArgs, pointers } );
+	t->m_head.store( head + 1, std::memory_order_release );
+
+	// single writer: no read-modify-write needed.
+	TraceStats& s = t->m_stats[id];
+	s.m_count.store( s.m_count.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+	if( result != 0 ) 
+		s.m_errors.store( s.m_errors.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+	s.m_totalNs.store( s.m_totalNs.load( std::memory_order_relaxed ) + duration, std::memory_order_relaxed );
+	if( duration < s.m_minNs.load( std::memory_order_relaxed ) ) 
+		s.m_minNs.store( duration, std::memory_order_relaxed );
+	if( duration > s.m_maxNs.load( std::memory_order_relaxed ) ) 
+		s.m_maxNs.store( duration, std::memory_order_relaxed );
+	int bucket = 0;
+	for( uint64_t d = duration; d > 1 && bucket < ORO_TRACE_NUM_BUCKETS - 1; d >>= 1 )
+		bucket++;
+	std::atomic<uint64_t>& b = s.m_histogram[bucket];
+	b.store( b.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+}
+
+template<typename T>
+inline int traceResult( T r )
+{
+	if constexpr( std::is_enum<T>::value || std::is_integral<T>::value )
+		return (int)r;
+	else
+		return 0;
+}
+
+// set while a capture runs, see oroCaptureBegin.
+std::atomic<bool> s_capturing( false );
+
+// times a call when the tracer is enabled, end() records it with its result. the capture takes the start of the call from it too,
+// and gives it the arguments of the call ( see captureArgs ).
+struct TraceScope
+{
+	int m_id;
+	bool m_trace;
+	uint64_t m_start;
+	uint64_t m_args[TRACE_MAX_ARGS];
+	int m_numArgs = 0;
+	uint16_t m_pointers = 0;
+
+	TraceScope( int id )
+		: m_id( id ), m_trace( id >= 0 && s_traceEnabled.load( std::memory_order_relaxed ) ), m_start( ( m_trace || s_capturing.load( std::memory_order_relaxed ) ) ? traceNow() : 0 )
+	{
+	}
+
+	// the pointers and the integers, the other arguments are 0.
+	template<typename... A>
+	void setArgs( A... a )
+	{
+		static_assert( sizeof...( A ) <= TRACE_MAX_ARGS, "too many arguments to trace" );
+		m_numArgs = 0;
+		m_pointers = 0;
+		( setArg( a ), ... );
+	}
+
+	template<typename T>
+	void setArg( T a )
+	{
+		uint64_t value = 0;
+		if constexpr( std::is_pointer<T>::value ) 
+		{
+			value = (uint64_t)(uintptr_t)a;
+			m_pointers |= 1 << m_numArgs;
+		}
+		else if constexpr( std::is_enum<T>::value || std::is_integral<T>::value ) 
+			value = (uint64_t)(int64_t)a;
+		m_args[m_numArgs++] = value;
+	}
+
+	template<typename T>
+	T end( T r )
+	{
+		if( m_trace ) 
+			traceRecord( m_id, m_start, traceResult( r ), m_args, m_numArgs, m_pointers );
+		return r;
+	}
+};
+
+// the names of the arguments of a call registered, "hipMalloc(ptr, size)": the last identifier of each argument, without the casts.
+std::vector<std::string> traceArgNames( const char* call )
+{
+	std::vector<std::string> names;
+	const char* p = strchr( call, '(' );
+	if( !p ) 
+		return names;
+	int depth = 0;
+	std::string name;
+	std::string last;
+	bool empty = true;
+	for( p++; *p; p++ )
+	{
+		const char c = *p;
+		const bool identifier = isalnum( (unsigned char)c ) || c == '_';
+		if( c == ')' && depth == 0 && empty && names.empty() ) 
+			break;
+		empty = empty && isspace( (unsigned char)c );
+		if( identifier ) 
+			name += c;
+		else if( !name.empty() ) 
+		{
+			if( !isdigit( (unsigned char)name[0] ) ) 
+				last = name;
+			name.clear();
+		}
+		if( c == '(' ) 
+			depth++;
+		if( ( c == ',' || c == ')' ) && depth == 0 ) 
+		{
+			names.push_back( last.empty() ? "arg" + std::to_string( names.size() ) : last );
+			last.clear();
+			empty = true;
+			if( c == ')' ) 
+				break;
+		}
+		else if( c == ')' ) 
+			depth--;
+	}
+	return names;
+}
+
+std::string s_traceExitPath;
+void traceAtExit()
+{
+	oroTracePrintStats();
+	oroTraceWriteChromeTrace( s_traceExitPath.c_str() );
+}
+} // namespace
+
+void oroTraceEnable( bool enable ) 
+{ 
+	s_traceEnabled = enable; 
+}
+
+bool oroTraceEnabled() 
+{ 
+	return s_traceEnabled; 
+}
+
+int oroTraceGetStats( oroTraceStats* stats, int maxStats )
+{
+	const int numFunctions = s_numTraceFunctions.load( std::memory_order_acquire );
+	std::lock_guard<std::mutex> lock( s_traceMutex );
+	int n = 0;
+	for( int id = 0; id < numFunctions; id++ )
+	{
+		oroTraceStats s = {};
+		s.name = s_traceFunctions[id].m_name;
+		s.minNs = UINT64_MAX;
+		for( const auto& t : s_traceThreads )
+		{
+			const TraceStats& ts = t->m_stats[id];
+			s.count += ts.m_count.load( std::memory_order_relaxed );
+			s.errors += ts.m_errors.load( std::memory_order_relaxed );
+			s.totalNs += ts.m_totalNs.load( std::memory_order_relaxed );
+			s.minNs = std::min<uint64_t>( s.minNs, ts.m_minNs.load( std::memory_order_relaxed ) );
+			s.maxNs = std::max<uint64_t>( s.maxNs, ts.m_maxNs.load( std::memory_order_relaxed ) );
+			for( int i = 0; i < ORO_TRACE_NUM_BUCKETS; i++ )
+				s.histogram[i] += ts.m_histogram[i].load( std::memory_order_relaxed );
+		}
+		if( s.count == 0 ) 
+			continue;
+		if( n < maxStats ) 
+			stats[n] = s;
+		n++;
+	}
+	return n;
+}
+
+void oroTracePrintStats()
+{
+	std::vector<oroTraceStats> stats( TRACE_MAX_FUNCTIONS );
+	const int n = std::min( oroTraceGetStats( stats.data(), TRACE_MAX_FUNCTIONS ), TRACE_MAX_FUNCTIONS );
+	printf( "%-40s %10s %8s %12s %10s %10s %10s\n", "function", "calls", "errors", "total(us)", "avg(us)", "min(us)", "max(us)" );
+	for( int i = 0; i < n; i++ )
+	{
+		const oroTraceStats& s = stats[i];
+		printf( "%-40s %10llu %8llu %12.1f %10.2f %10.2f %10.2f\n", s.name, (unsigned long long)s.count, (unsigned long long)s.errors, s.totalNs / 1000.0, s.totalNs / 1000.0 / s.count, s.minNs / 1000.0, s.maxNs / 1000.0 );
+		// the buckets, as "<upper bound>:<calls>".
+		printf( "  " );
+		for( int b = 0; b < ORO_TRACE_NUM_BUCKETS; b++ )
+		{
+			if( s.histogram[b] == 0 ) continue;
+			const uint64_t bound = 2ull << b;
+			if( bound < 1000 )
+				printf( " <%lluns:%llu", (unsigned long long)bound, (unsigned long long)s.histogram[b] );
+			else
+				printf( " <%lluus:%llu", (unsigned long long)( bound / 1000 ), (unsigned long long)s.histogram[b] );
+		}
+		printf( "\n" );
+	}
+}
+
+oroError oroTraceWriteChromeTrace( const char* path )
+{
+	FILE* f = fopen( path, "w" );
+	if( !f )
+	{
+		printf( "Orochi trace: can't write %s\n", path );
+		return oroErrorUnknown;
+	}
+	const int numFunctions = s_numTraceFunctions.load( std::memory_order_acquire );
+	std::lock_guard<std::mutex> lock( s_traceMutex );
+	std::vector<std::vector<std::string>> argNames( numFunctions );
+	for( int id = 0; id < numFunctions; id++ )
+		argNames[id] = traceArgNames( s_traceFunctions[id].m_call );
+
+	fprintf( f, "{\"traceEvents\":[\n" );
+	bool first = true;
+	std::vector<TraceEvent> events;
+	std::vector<uint64_t> args;
+	for( const auto& t : s_traceThreads )
+	{
+		// the events and their arguments can be overwritten while they are copied. after the copy, the heads tell which slots may have been:
+		// the ones older than the capacity, and the ones the thread writes before publishing its heads ( one event, TRACE_MAX_ARGS arguments ).
+		const uint64_t head = t->m_head.load( std::memory_order_acquire );
+		const uint64_t begin = head > ORO_TRACE_CAPACITY ? head - ORO_TRACE_CAPACITY : 0;
+		events.clear();
+		args.clear();
+		for( uint64_t i = begin; i < head; i++ )
+		{
+			const TraceEvent e = t->m_events[i % ORO_TRACE_CAPACITY].load();
+			events.push_back( e );
+			for( int a = 0; a < std::min<int>( e.m_numArgs, TRACE_MAX_ARGS ); a++ )
+				args.push_back( t->m_args[( e.m_args + a ) % TRACE_ARGS_CAPACITY].load( std::memory_order_relaxed ) );
+		}
+		std::atomic_thread_fence( std::memory_order_acquire );
+		const uint64_t after = t->m_head.load( std::memory_order_relaxed ) + 1;
+		const uint64_t valid = after > ORO_TRACE_CAPACITY ? after - ORO_TRACE_CAPACITY : 0;
+		const uint64_t argsAfter = t->m_argsHead.load( std::memory_order_relaxed ) + TRACE_MAX_ARGS;
+		const uint64_t argsValid = argsAfter > TRACE_ARGS_CAPACITY ? argsAfter - TRACE_ARGS_CAPACITY : 0;
+
+		size_t arg = 0;
+		size_t owner = 0;
+		for( uint64_t i = begin; i < head; i++ )
+		{
+			const TraceEvent& e = events[i - begin];
+			const uint64_t* values = args.data() + arg;
+			arg += std::min<int>( e.m_numArgs, TRACE_MAX_ARGS );
+			while( owner + 1 < t->m_owners.size() && t->m_owners[owner + 1].m_first <= i )
+				owner++;
+			if( i < valid || e.m_id < 0 || e.m_id >= numFunctions ) continue;
+			fprintf( f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"result\":%d", first ? "" : ",\n", 
+				s_traceFunctions[e.m_id].m_name, t->m_owners[owner].m_tid, e.m_start / 1000.0, e.m_duration / 1000.0, e.m_result );
+			const std::vector<std::string>& names = argNames[e.m_id];
+			if( e.m_args >= argsValid && (size_t)e.m_numArgs == names.size() ) 
+			{
+				for( int a = 0; a < e.m_numArgs; a++ )
+				{
+					if( e.m_pointers & ( 1 << a ) ) 
+						fprintf( f, ",\"%s\":\"0x%llx\"", names[a].c_str(), (unsigned long long)values[a] );
+					else
+						fprintf( f, ",\"%s\":%lld", names[a].c_str(), (long long)values[a] );
+				}
+			}
+			fprintf( f, "}}" );
+			first = false;
+		}
+	}
+	fprintf( f, "\n]}\n" );
+	fclose( f );
+	return oroSuccess;
+}
+
+// the host backend ( ORO_API_HOST ): a device emulated on the CPU. HostApi has the functions of hipew it emulates, with the same names and
+// signatures, so the wrappers of the region call them as they call HIP ( see hostCall ). the other functions return hipErrorNotSupported.
+namespace
+{
+const char HOST_KERNEL_HEADER[] =
+#include <Orochi/OrochiHostKernel.h>
+	;
+
+// the code of a host program, given to oroModuleLoadData: the header, then the shared library.
+const char HOST_IMAGE_MAGIC[8] = "OROHOST";
+struct HostImageHeader
+{
+	char m_magic[8];
+	uint64_t m_size;
+};
+
+const unsigned int HOST_KERNEL_VERSION = 1;
+const unsigned int HOST_MAX_THREADS_PER_BLOCK = 1024;
+const int HOST_VERSION = 1;
+// __shared__ isn't bounded, but kernels size their work by it.
+const size_t HOST_SHARED_MEMORY = 64 * 1024;
+const size_t HOST_ALIGNMENT = 256;
+
+// must match Launch and Kernel in OrochiHostKernel.h.
+struct HostLaunch
+{
+	unsigned int m_grid[3];
+	unsigned int m_block[3];
+	unsigned int m_sharedMemBytes;
+	const void* m_args;
+};
+
+struct HostKernel
+{
+	unsigned int m_version;
+	unsigned int m_argsAlignment;
+	size_t m_argsSize;
+	int ( *m_pack )( void* args, void** kernelParams, const void* buffer, size_t bufferSize );
+	void ( *m_run )( const HostLaunch* launch, unsigned int block );
+};
+
+// a stream: a thread running its work in order.
+struct HostStream
+{
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::condition_variable m_idle;
+	std::deque<std::function<void()>> m_work;
+	bool m_busy = false;
+	bool m_exit = false;
+	std::thread m_thread;
+
+	HostStream() { m_thread = std::thread( [this]() { loop(); } ); }
+
+	// runs the work left before returning.
+	~HostStream()
+	{
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			m_exit = true;
+		}
+		m_cv.notify_all();
+		m_thread.join();
+	}
+
+	void push( std::function<void()> work )
+	{
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			m_work.push_back( std::move( work ) );
+		}
+		m_cv.notify_one();
+	}
+
+	void synchronize()
+	{
+		std::unique_lock<std::mutex> lock( m_mutex );
+		m_idle.wait( lock, [this]() { return m_work.empty() && !m_busy; } );
+	}
+
+	bool idle()
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		return m_work.empty() && !m_busy;
+	}
+
+	void loop()
+	{
+		std::unique_lock<std::mutex> lock( m_mutex );
+		for( ;; )
+		{
+			m_cv.wait( lock, [this]() { return m_exit || !m_work.empty(); } );
+			if( m_work.empty() )
+				return;
+			std::function<void()> work = std::move( m_work.front() );
+			m_work.pop_front();
+			m_busy = true;
+			lock.unlock();
+			work();
+			lock.lock();
+			m_busy = false;
+			if( m_work.empty() )
+				m_idle.notify_all();
+		}
+	}
+};
+
+// the workers running the blocks of a launch, with the thread of the stream launching it. one launch runs at a time.
+class HostPool
+{
+public:
+	explicit HostPool( int numThreads )
+	{
+		for( int i = 1; i < numThreads; i++ )
+			std::thread( [this]() { work(); } ).detach();
+	}
+
+	// runs f( 0 ) .. f( n - 1 ). the indices are taken in increasing order, so a block can wait for the blocks before it.
+	void run( unsigned int n, const std::function<void( unsigned int )>& f )
+	{
+		std::lock_guard<std::mutex> launchLock( m_launchMutex );
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			m_job = &f;
+			m_size = n;
+			m_next = 0;
+			m_generation++;
+		}
+		m_cv.notify_all();
+		execute( f, n );
+
+		std::unique_lock<std::mutex> lock( m_mutex );
+		m_done.wait( lock, [this]() { return m_active == 0; } );
+		m_job = nullptr;
+	}
+
+private:
+	void execute( const std::function<void( unsigned int )>& f, unsigned int n )
+	{
+		for( unsigned int i = m_next++; i < n; i = m_next++ )
+			f( i );
+	}
+
+	void work()
+	{
+		uint64_t generation = 0;
+		std::unique_lock<std::mutex> lock( m_mutex );
+		for( ;; )
+		{
+			m_cv.wait( lock, [&]() { return m_generation != generation; } );
+			generation = m_generation;
+			if( !m_job )
+				continue;
+			const std::function<void( unsigned int )>& f = *m_job;
+			const unsigned int n = m_size;
+			m_active++;
+			lock.unlock();
+			execute( f, n );
+			lock.lock();
+			if( --m_active == 0 )
+				m_done.notify_all();
+		}
+	}
+
+	std::mutex m_launchMutex;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::condition_variable m_done;
+	const std::function<void( unsigned int )>* m_job = nullptr;
+	unsigned int m_size = 0;
+	std::atomic<unsigned int> m_next{ 0 };
+	uint64_t m_generation = 0;
+	int m_active = 0;
+};
+
+// an event: the number of records pushed to streams and reached by them, and the time of the last one reached.
+struct HostEvent
+{
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	uint64_t m_recorded = 0;
+	uint64_t m_completed = 0;
+	uint64_t m_time = 0;
+
+	void wait( uint64_t record )
+	{
+		std::unique_lock<std::mutex> lock( m_mutex );
+		m_cv.wait( lock, [this, record]() { return m_completed >= record; } );
+	}
+};
+
+// a hipEvent_t points to a reference, and the work pushed to the streams holds another one: a destroyed event lives until it ran.
+using HostEventRef = std::shared_ptr<HostEvent>;
+
+struct HostContext
+{
+	unsigned int m_flags;
+};
+
+struct HostAllocation
+{
+	size_t m_size;
+	hipMemoryType m_type;
+};
+
+struct HostModule;
+
+struct HostFunction
+{
+	const HostKernel* m_kernel;
+	HostModule* m_module;
+};
+
+struct HostModule
+{
+	void* m_library = nullptr;
+	// the library can't be removed while it's loaded on Windows.
+	std::filesystem::path m_directory;
+	std::mutex m_mutex;
+	// guarded by m_mutex.
+	std::unordered_map<std::string, std::unique_ptr<HostFunction>> m_functions;
+};
+
+struct HostProgram
+{
+	std::string m_source;
+	std::vector<std::pair<std::string, std::string>> m_headers;
+	// deques, as the lowered names are returned by pointer.
+	std::deque<std::string> m_nameExpressions;
+	std::deque<std::string> m_loweredNames;
+	std::string m_log;
+	std::vector<char> m_code;
+};
+
+// never freed: the streams and the workers can outlive the static objects.
+struct HostState
+{
+	std::mutex m_mutex;
+	std::unordered_set<HostStream*> m_streams;
+	std::map<uintptr_t, HostAllocation> m_allocations;
+	HostStream* m_nullStream = nullptr;
+	HostPool* m_pool = nullptr;
+};
+
+HostState& hostState()
+{
+	static HostState* s_state = new HostState;
+	return *s_state;
+}
+
+thread_local HostContext* t_hostCtx = nullptr;
+thread_local std::vector<HostContext*> t_hostCtxStack;
+thread_local hipError_t t_hostLastError = hipSuccess;
+
+// ORO_HOST_THREADS, or a thread per core.
+int hostNumThreads()
+{
+	static const int s_numThreads = []() {
+		const char* threads = getenv( "ORO_HOST_THREADS" );
+		const int n = threads ? atoi( threads ) : (int)std::thread::hardware_concurrency();
+		return std::max( n, 1 );
+	}();
+	return s_numThreads;
+}
+
+HostPool& hostPool()
+{
+	HostState& s = hostState();
+	std::lock_guard<std::mutex> lock( s.m_mutex );
+	if( !s.m_pool )
+		s.m_pool = new HostPool( hostNumThreads() );
+	return *s.m_pool;
+}
+
+HostStream* hostStream( hipStream_t stream )
+{
+	if( stream )
+		return (HostStream*)stream;
+	HostState& s = hostState();
+	std::lock_guard<std::mutex> lock( s.m_mutex );
+	if( !s.m_nullStream )
+		s.m_nullStream = new HostStream;
+	return s.m_nullStream;
+}
+
+HostEventRef hostEvent( hipEvent_t event ) { return event ? *(HostEventRef*)event : nullptr; }
+
+void hostSynchronize()
+{
+	HostState& s = hostState();
+	std::vector<HostStream*> streams;
+	{
+		std::lock_guard<std::mutex> lock( s.m_mutex );
+		streams.assign( s.m_streams.begin(), s.m_streams.end() );
+		if( s.m_nullStream )
+			streams.push_back( s.m_nullStream );
+	}
+	for( HostStream* stream : streams )
+		stream->synchronize();
+}
+
+// the allocation containing the pointer, null if there is none.
+const HostAllocation* hostFindAllocation( const void* ptr, uintptr_t* base = nullptr )
+{
+	HostState& s = hostState();
+	std::lock_guard<std::mutex> lock( s.m_mutex );
+	auto it = s.m_allocations.upper_bound( (uintptr_t)ptr );
+	if( it == s.m_allocations.begin() )
+		return nullptr;
+	--it;
+	if( (uintptr_t)ptr >= it->first + std::max<size_t>( it->second.m_size, 1 ) )
+		return nullptr;
+	if( base )
+		*base = it->first;
+	return &it->second;
+}
+
+hipError_t hostMalloc( void** ptr, size_t size, hipMemoryType type )
+{
+	if( !ptr )
+		return hipErrorInvalidValue;
+	*ptr = nullptr;
+	if( size == 0 )
+		return hipSuccess;
+	void* p = ::operator new( size, std::align_val_t( HOST_ALIGNMENT ), std::nothrow );
+	if( !p )
+		return hipErrorOutOfMemory;
+	HostState& s = hostState();
+	std::lock_guard<std::mutex> lock( s.m_mutex );
+	s.m_allocations[(uintptr_t)p] = { size, type };
+	*ptr = p;
+	return hipSuccess;
+}
+
+hipError_t hostFree( void* ptr )
+{
+	if( !ptr )
+		return hipSuccess;
+	// as on the GPU, the work using the memory completes first.
+	hostSynchronize();
+	HostState& s = hostState();
+	{
+		std::lock_guard<std::mutex> lock( s.m_mutex );
+		if( s.m_allocations.erase( (uintptr_t)ptr ) == 0 )
+			return hipErrorInvalidValue;
+	}
+	::operator delete( ptr, std::align_val_t( HOST_ALIGNMENT ) );
+	return hipSuccess;
+}
+
+hipError_t hostCopyAsync( void* dst, const void* src, size_t size, hipStream_t stream )
+{
+	if( size == 0 )
+		return hipSuccess;
+	if( !dst || !src )
+		return hipErrorInvalidValue;
+	// the memory of the application may be reused once the call returns, as it's copied to staging memory by the drivers.
+	if( !hostFindAllocation( src ) )
+	{
+		std::shared_ptr<std::vector<char>> staging = std::make_shared<std::vector<char>>( (const char*)src, (const char*)src + size );
+		hostStream( stream )->push( [dst, staging]() { memcpy( dst, staging->data(), staging->size() ); } );
+		return hipSuccess;
+	}
+	hostStream( stream )->push( [dst, src, size]() { memcpy( dst, src, size ); } );
+	return hipSuccess;
+}
+
+hipError_t hostCopy( void* dst, const void* src, size_t size )
+{
+	if( size == 0 )
+		return hipSuccess;
+	if( !dst || !src )
+		return hipErrorInvalidValue;
+	hostSynchronize();
+	memcpy( dst, src, size );
+	return hipSuccess;
+}
+
+template<typename T>
+void hostFill( void* dst, T value, size_t count )
+{
+	if( sizeof( T ) == 1 )
+	{
+		memset( dst, (int)value, count );
+		return;
+	}
+	T* p = (T*)dst;
+	for( size_t i = 0; i < count; i++ )
+		p[i] = value;
+}
+
+template<typename T>
+hipError_t hostMemset( void* dst, T value, size_t count, hipStream_t stream, bool async )
+{
+	if( count == 0 )
+		return hipSuccess;
+	if( !dst )
+		return hipErrorInvalidValue;
+	if( async )
+	{
+		hostStream( stream )->push( [dst, value, count]() { hostFill( dst, value, count ); } );
+		return hipSuccess;
+	}
+	hostSynchronize();
+	hostFill( dst, value, count );
+	return hipSuccess;
+}
+
+size_t hostPhysicalMemory()
+{
+#if defined( _WIN32 )
+	MEMORYSTATUSEX status = {};
+	status.dwLength = sizeof( status );
+	return GlobalMemoryStatusEx( &status ) ? (size_t)status.ullTotalPhys : 0;
+#else
+	return (size_t)sysconf( _SC_PHYS_PAGES ) * (size_t)sysconf( _SC_PAGE_SIZE );
+#endif
+}
+
+void hostGetProperties( hipDeviceProp_t* props )
+{
+	*props = {};
+	snprintf( props->name, sizeof( props->name ), "Orochi host ( %d threads )", hostNumThreads() );
+#if defined( __aarch64__ ) || defined( _M_ARM64 )
+	snprintf( props->gcnArchName, sizeof( props->gcnArchName ), "host-aarch64" );
+#else
+	snprintf( props->gcnArchName, sizeof( props->gcnArchName ), "host-x86_64" );
+#endif
+	props->totalGlobalMem = hostPhysicalMemory();
+	props->sharedMemPerBlock = HOST_SHARED_MEMORY;
+	props->regsPerBlock = 65536;
+	props->warpSize = 32;
+	props->maxThreadsPerBlock = HOST_MAX_THREADS_PER_BLOCK;
+	props->maxThreadsDim[0] = HOST_MAX_THREADS_PER_BLOCK;
+	props->maxThreadsDim[1] = HOST_MAX_THREADS_PER_BLOCK;
+	props->maxThreadsDim[2] = 64;
+	props->maxGridSize[0] = INT_MAX;
+	props->maxGridSize[1] = 65535;
+	props->maxGridSize[2] = 65535;
+	props->clockRate = 1000000;
+	props->totalConstMem = HOST_SHARED_MEMORY;
+	props->major = 1;
+	props->minor = 0;
+	// a worker runs a block at a time.
+	props->multiProcessorCount = hostNumThreads();
+	props->maxThreadsPerMultiProcessor = HOST_MAX_THREADS_PER_BLOCK;
+	props->maxSharedMemoryPerMultiProcessor = HOST_SHARED_MEMORY;
+	props->canMapHostMemory = 1;
+	props->integrated = 1;
+	props->managedMemory = 1;
+	props->directManagedMemAccessFromHost = 1;
+	props->concurrentManagedAccess = 1;
+	props->pageableMemoryAccess = 1;
+	props->pageableMemoryAccessUsesHostPageTables = 1;
+	props->arch.hasGlobalInt32Atomics = props->arch.hasSharedInt32Atomics = 1;
+	props->arch.hasGlobalInt64Atomics = props->arch.hasSharedInt64Atomics = 1;
+	props->arch.hasGlobalFloatAtomicExch = props->arch.hasSharedFloatAtomicExch = props->arch.hasFloatAtomicAdd = 1;
+	props->arch.hasDoubles = props->arch.hasWarpVote = props->arch.hasWarpBallot = props->arch.hasWarpShuffle = 1;
+	props->arch.hasThreadFenceSystem = props->arch.hasSyncThreadsExt = props->arch.has3dGrid = 1;
+}
+
+std::filesystem::path hostTempDirectory()
+{
+	static std::atomic<unsigned int> s_counter( 0 );
+	std::error_code ec;
+	const std::filesystem::path base = std::filesystem::temp_directory_path( ec );
+	if( ec )
+		return {};
+	for( int i = 0; i < 16; i++ )
+	{
+		const std::filesystem::path dir = base / ( "orochi_host_" + std::to_string( traceNow() ) + "_" + std::to_string( s_counter++ ) );
+		if( std::filesystem::create_directory( dir, ec ) )
+			return dir;
+	}
+	return {};
+}
+
+bool hostWriteFile( const std::filesystem::path& path, const void* data, size_t size )
+{
+	FILE* f = fopen( path.string().c_str(), "wb" );
+	if( !f )
+		return false;
+	const bool written = fwrite( data, 1, size, f ) == size;
+	return ( fclose( f ) == 0 ) && written;
+}
+
+bool hostWriteFile( const std::filesystem::path& path, const std::string& text )
+{
+	return hostWriteFile( path, text.data(), text.size() );
+}
+
+bool hostReadFile( const std::filesystem::path& path, std::string& data )
+{
+	FILE* f = fopen( path.string().c_str(), "rb" );
+	if( !f )
+		return false;
+	char buffer[4096];
+	size_t n;
+	while( ( n = fread( buffer, 1, sizeof( buffer ), f ) ) > 0 )
+		data.append( buffer, n );
+	fclose( f );
+	return true;
+}
+
+std::string hostQuote( const std::string& s )
+{
+#if defined( _WIN32 )
+	return "\"" + s + "\"";
+#else
+	std::string q = "'";
+	for( char c : s )
+		q += ( c == '\'' ) ? std::string( "'\\''" ) : std::string( 1, c );
+	return q + "'";
+#endif
+}
+
+// runs a command, its output is added to the log. true if it succeeds.
+bool hostRun( const std::string& command, std::string& log )
+{
+#if defined( _WIN32 )
+	// cmd removes the first and the last quotes of the command.
+	FILE* pipe = _popen( ( "\"" + command + " 2>&1\"" ).c_str(), "r" );
+#else
+	FILE* pipe = popen( ( command + " 2>&1" ).c_str(), "r" );
+#endif
+	if( !pipe )
+	{
+		log += "Orochi host: can't run " + command + "\n";
+		return false;
+	}
+	char buffer[4096];
+	size_t n;
+	while( ( n = fread( buffer, 1, sizeof( buffer ), pipe ) ) > 0 )
+		log.append( buffer, n );
+#if defined( _WIN32 )
+	return _pclose( pipe ) == 0;
+#else
+	return pclose( pipe ) == 0;
+#endif
+}
+
+// the options of orortc understood by the C++ compiler: the defines, the include paths, the optimization and fast math. the others are for the GPU compilers.
+// the emulation layer needs C++17 at least.
+std::string hostCompilerOptions( int numOptions, const char** options )
+{
+	std::string out;
+	bool standard = false;
+	bool optimization = false;
+	for( int i = 0; i < numOptions; i++ )
+	{
+		const std::string o = options[i] ? options[i] : "";
+		if( ( o == "-D" || o == "-U" || o == "-I" || o == "-include" ) && i + 1 < numOptions )
+		{
+			out += " " + o + " " + hostQuote( options[++i] );
+			continue;
+		}
+		if( o.compare( 0, 2, "-D" ) == 0 || o.compare( 0, 2, "-U" ) == 0 || o.compare( 0, 2, "-I" ) == 0 )
+			out += " " + hostQuote( o );
+		else if( ( o.compare( 0, 5, "-std=" ) == 0 || o.compare( 0, 6, "--std=" ) == 0 ) && o.find( "++2" ) != std::string::npos )
+		{
+			out += " -std=" + o.substr( o.find( '=' ) + 1 );
+			standard = true;
+		}
+		else if( o.compare( 0, 2, "-O" ) == 0 && o.size() <= 3 )
+		{
+			out += " " + o;
+			optimization = true;
+		}
+		else if( o == "-ffast-math" || o == "--use_fast_math" || o == "-use_fast_math" )
+			out += " -ffast-math";
+		else if( o == "-g" || o == "-G" )
+			out += " -g";
+	}
+	if( !standard )
+		out += " -std=c++17";
+	if( !optimization )
+		out += " -O2";
+	if( const char* flags = getenv( "ORO_HOST_CXXFLAGS" ) )
+		out += std::string( " " ) + flags;
+	return out;
+}
+
+bool hostHasWord( const std::string& s, const char* word )
+{
+	const size_t n = strlen( word );
+	for( size_t at = s.find( word ); at != std::string::npos; at = s.find( word, at + n ) )
+	{
+		const bool before = at == 0 || !( isalnum( (unsigned char)s[at - 1] ) || s[at - 1] == '_' );
+		const bool after = at + n == s.size() || !( isalnum( (unsigned char)s[at + n] ) || s[at + n] == '_' );
+		if( before && after )
+			return true;
+	}
+	return false;
+}
+
+// the kernels of a program preprocessed with ORO_HOST_FIND_KERNELS: the definitions marked by __global__ at global scope, except the templates.
+std::vector<std::string> hostFindKernels( const std::string& code )
+{
+	std::vector<std::string> kernels;
+	const char MARKER[] = "oro_kernel";
+	for( size_t at = code.find( MARKER ); at != std::string::npos; at = code.find( MARKER, at + 1 ) )
+	{
+		const size_t begin = code.find_last_of( ";{}", at );
+		const size_t start = ( begin == std::string::npos ) ? 0 : begin + 1;
+		const bool isTemplate = hostHasWord( code.substr( start, at - start ), "template" );
+
+		// the attribute ends with 2 parentheses, the name is just before the next one.
+		size_t open = code.find( ')', at );
+		if( open != std::string::npos ) open = code.find( ')', open + 1 );
+		if( open != std::string::npos ) open = code.find( '(', open + 1 );
+		if( open == std::string::npos )
+			break;
+		size_t end = open;
+		while( end > 0 && isspace( (unsigned char)code[end - 1] ) )
+			end--;
+		size_t name = end;
+		while( name > 0 && ( isalnum( (unsigned char)code[name - 1] ) || code[name - 1] == '_' ) )
+			name--;
+		const bool qualified = name > 0 && code[name - 1] == ':';
+
+		// the parameters, then the body or the end of a declaration.
+		int depth = 0;
+		size_t i = open;
+		for( ; i < code.size(); i++ )
+		{
+			if( code[i] == '(' ) depth++;
+			if( code[i] == ')' && --depth == 0 ) break;
+		}
+		const size_t next = code.find_first_of( "{;", i );
+		if( isTemplate || qualified || name == end || next == std::string::npos || code[next] != '{' )
+			continue;
+		const std::string kernel = code.substr( name, end - name );
+		if( std::find( kernels.begin(), kernels.end(), kernel ) == kernels.end() )
+			kernels.push_back( kernel );
+	}
+	return kernels;
+}
+
+// compiles the program in a temporary directory: the source and the headers are written in dir/include. a first pass finds the kernels,
+// the second one builds the library exporting them.
+hiprtcResult hostCompile( HostProgram& p, const std::filesystem::path& dir, const std::string& options )
+{
+	std::error_code ec;
+	const std::filesystem::path include = dir / "include";
+	std::filesystem::create_directories( include, ec );
+	for( const auto& header : p.m_headers )
+	{
+		// a header outside of the directory isn't written, the compiler looks for it in the include paths.
+		const std::filesystem::path name = std::filesystem::path( header.first ).lexically_normal();
+		if( name.empty() || name.is_absolute() || *name.begin() == ".." )
+			continue;
+		std::filesystem::create_directories( ( include / name ).parent_path(), ec );
+		hostWriteFile( include / name, header.second );
+	}
+	const std::string prelude = "#include \"oro_host_kernel.h\"\n#include \"include/kernel.cpp\"\n";
+	if( !hostWriteFile( dir / "oro_host_kernel.h", HOST_KERNEL_HEADER, sizeof( HOST_KERNEL_HEADER ) - 1 ) || !hostWriteFile( include / "kernel.cpp", p.m_source ) ||
+		!hostWriteFile( dir / "find.cpp", prelude ) )
+	{
+		p.m_log += "Orochi host: can't write in " + dir.string() + "\n";
+		return HIPRTC_ERROR_INTERNAL_ERROR;
+	}
+
+	const char* compiler = getenv( "ORO_HOST_CXX" );
+#if defined( _WIN32 )
+	const std::string cxx = compiler ? compiler : "clang++";
+	const std::string LIBRARY = "kernel.dll";
+	const std::string SHARED = " -shared";
+#else
+	const std::string cxx = compiler ? compiler : "c++";
+	const std::string LIBRARY = "kernel.so";
+	// hidden, or the inline variables of the layer ( t_block... ) would be unique in the process, shared by all the loaded modules.
+	const std::string SHARED = " -shared -fPIC -fvisibility=hidden";
+#endif
+	const std::string flags = options + " -I" + hostQuote( include.string() );
+	if( !hostRun( cxx + flags + " -DORO_HOST_FIND_KERNELS -E " + hostQuote( ( dir / "find.cpp" ).string() ) + " -o " + hostQuote( ( dir / "find.ii" ).string() ), p.m_log ) )
+		return HIPRTC_ERROR_COMPILATION;
+	std::string preprocessed;
+	hostReadFile( dir / "find.ii", preprocessed );
+
+	std::string host = prelude;
+	for( const std::string& kernel : hostFindKernels( preprocessed ) )
+		host += "ORO_HOST_KERNEL( " + kernel + " )\n";
+	hostWriteFile( dir / "host.cpp", host );
+	if( !hostRun( cxx + flags + SHARED + " " + hostQuote( ( dir / "host.cpp" ).string() ) + " -o " + hostQuote( ( dir / LIBRARY ).string() ), p.m_log ) )
+		return HIPRTC_ERROR_COMPILATION;
+
+	std::string library;
+	if( !hostReadFile( dir / LIBRARY, library ) )
+	{
+		p.m_log += "Orochi host: can't read " + ( dir / LIBRARY ).string() + "\n";
+		return HIPRTC_ERROR_INTERNAL_ERROR;
+	}
+	HostImageHeader header = {};
+	memcpy( header.m_magic, HOST_IMAGE_MAGIC, sizeof( header.m_magic ) );
+	header.m_size = library.size();
+	p.m_code.resize( sizeof( header ) + library.size() );
+	memcpy( p.m_code.data(), &header, sizeof( header ) );
+	memcpy( p.m_code.data() + sizeof( header ), library.data(), library.size() );
+	return HIPRTC_SUCCESS;
+}
+
+struct HostError
+{
+	int m_code;
+	const char* m_name;
+	const char* m_string;
+};
+
+const HostError HOST_ERRORS[] = {
+	{ hipSuccess, "hipSuccess", "no error" },
+	{ hipErrorInvalidValue, "hipErrorInvalidValue", "invalid argument" },
+	{ hipErrorOutOfMemory, "hipErrorOutOfMemory", "out of memory" },
+	{ hipErrorNotInitialized, "hipErrorNotInitialized", "initialization error" },
+	{ hipErrorInvalidConfiguration, "hipErrorInvalidConfiguration", "invalid configuration argument" },
+	{ hipErrorInvalidDevice, "hipErrorInvalidDevice", "invalid device ordinal" },
+	{ hipErrorInvalidImage, "hipErrorInvalidImage", "device kernel image is invalid" },
+	{ hipErrorInvalidContext, "hipErrorInvalidContext", "invalid device context" },
+	{ hipErrorSharedObjectInitFailed, "hipErrorSharedObjectInitFailed", "shared object initialization failed" },
+	{ hipErrorInvalidHandle, "hipErrorInvalidHandle", "invalid resource handle" },
+	{ hipErrorNotFound, "hipErrorNotFound", "named symbol not found" },
+	{ hipErrorNotReady, "hipErrorNotReady", "device not ready" },
+	{ hipErrorUnsupportedLimit, "hipErrorUnsupportedLimit", "limit is not supported on this architecture" },
+	{ hipErrorNotSupported, "hipErrorNotSupported", "operation not supported by the host backend" },
+	{ hipErrorUnknown, "hipErrorUnknown", "unknown error" },
+};
+
+const HostError& hostFindError( int code )
+{
+	for( const HostError& e : HOST_ERRORS )
+	{
+		if( e.m_code == code )
+			return e;
+	}
+	return HOST_ERRORS[sizeof( HOST_ERRORS ) / sizeof( HOST_ERRORS[0] ) - 1];
+}
+
+// the functions of hipew emulated by the host backend.
+struct HostApi
+{
+	static hipError_t hipInit( unsigned int flags ) { return hipSuccess; }
+	static hipError_t hipDriverGetVersion( int* driverVersion ) { return ( *driverVersion = HOST_VERSION, hipSuccess ); }
+	// the version of the emulation layer, a hash of OrochiHostKernel.h: the caches of the programs built with an other one miss.
+	static hipError_t hipRuntimeGetVersion( int* runtimeVersion )
+	{
+		static const int s_version = []() {
+			uint32_t h = 2166136261u;
+			for( const char* c = HOST_KERNEL_HEADER; *c; c++ )
+				h = ( h ^ (unsigned char)*c ) * 16777619u;
+			return (int)( h & 0x7fffffff );
+		}();
+		*runtimeVersion = s_version;
+		return hipSuccess;
+	}
+	static hipError_t hipGetDeviceCount( int* count ) { return ( *count = 1, hipSuccess ); }
+
+	static hipError_t hipDeviceGet( hipDevice_t* device, int ordinal )
+	{
+		if( ordinal != 0 )
+			return hipErrorInvalidDevice;
+		*device = 0;
+		return hipSuccess;
+	}
+
+	static hipError_t hipGetDeviceProperties( hipDeviceProp_t* prop, int deviceId )
+	{
+		if( deviceId != 0 )
+			return hipErrorInvalidDevice;
+		hostGetProperties( prop );
+		return hipSuccess;
+	}
+
+	static hipError_t hipDeviceGetName( char* name, int len, hipDevice_t device )
+	{
+		hipDeviceProp_t props;
+		const hipError_t e = hipGetDeviceProperties( &props, device );
+		if( e == hipSuccess && len > 0 )
+			snprintf( name, len, "%s", props.name );
+		return e;
+	}
+
+	static hipError_t hipDeviceGetAttribute( int* pi, hipDeviceAttribute_t attr, int deviceId )
+	{
+		hipDeviceProp_t p;
+		const hipError_t e = hipGetDeviceProperties( &p, deviceId );
+		if( e != hipSuccess )
+			return e;
+		switch( attr )
+		{
+		case hipDeviceAttributeMaxThreadsPerBlock: *pi = p.maxThreadsPerBlock; break;
+		case hipDeviceAttributeMaxBlockDimX: *pi = p.maxThreadsDim[0]; break;
+		case hipDeviceAttributeMaxBlockDimY: *pi = p.maxThreadsDim[1]; break;
+		case hipDeviceAttributeMaxBlockDimZ: *pi = p.maxThreadsDim[2]; break;
+		case hipDeviceAttributeMaxGridDimX: *pi = p.maxGridSize[0]; break;
+		case hipDeviceAttributeMaxGridDimY: *pi = p.maxGridSize[1]; break;
+		case hipDeviceAttributeMaxGridDimZ: *pi = p.maxGridSize[2]; break;
+		case hipDeviceAttributeMaxSharedMemoryPerBlock: *pi = (int)p.sharedMemPerBlock; break;
+		case hipDeviceAttributeSharedMemPerMultiprocessor: *pi = (int)p.maxSharedMemoryPerMultiProcessor; break;
+		case hipDeviceAttributeTotalConstantMemory: *pi = (int)p.totalConstMem; break;
+		case hipDeviceAttributeWarpSize: *pi = p.warpSize; break;
+		case hipDeviceAttributeMaxRegistersPerBlock: *pi = p.regsPerBlock; break;
+		case hipDeviceAttributeClockRate: *pi = p.clockRate; break;
+		case hipDeviceAttributeMultiprocessorCount: *pi = p.multiProcessorCount; break;
+		case hipDeviceAttributeMaxThreadsPerMultiProcessor: *pi = p.maxThreadsPerMultiProcessor; break;
+		case hipDeviceAttributeMaxBlocksPerMultiProcessor: *pi = 1; break;
+		case hipDeviceAttributeComputeCapabilityMajor: *pi = p.major; break;
+		case hipDeviceAttributeComputeCapabilityMinor: *pi = p.minor; break;
+		case hipDeviceAttributeIntegrated: *pi = p.integrated; break;
+		case hipDeviceAttributeCanMapHostMemory: *pi = p.canMapHostMemory; break;
+		case hipDeviceAttributeManagedMemory: *pi = p.managedMemory; break;
+		case hipDeviceAttributeConcurrentManagedAccess: *pi = p.concurrentManagedAccess; break;
+		case hipDeviceAttributePageableMemoryAccess: *pi = p.pageableMemoryAccess; break;
+		case hipDeviceAttributeUnifiedAddressing: *pi = 1; break;
+		case hipDeviceAttributeConcurrentKernels: *pi = p.concurrentKernels; break;
+		case hipDeviceAttributeL2CacheSize: *pi = p.l2CacheSize; break;
+		default: return hipErrorInvalidValue;
+		}
+		return hipSuccess;
+	}
+
+	static hipError_t hipDeviceTotalMem( size_t* bytes, hipDevice_t device )
+	{
+		if( device != 0 )
+			return hipErrorInvalidDevice;
+		*bytes = hostPhysicalMemory();
+		return hipSuccess;
+	}
+
+	static hipError_t hipDeviceComputeCapability( int* major, int* minor, hipDevice_t device )
+	{
+		if( device != 0 )
+			return hipErrorInvalidDevice;
+		*major = 1;
+		*minor = 0;
+		return hipSuccess;
+	}
+
+	static hipError_t hipDeviceCanAccessPeer( int* canAccessPeer, int deviceId, int peerDeviceId ) { return ( *canAccessPeer = 0, hipSuccess ); }
+
+	static hipError_t hipDeviceGetLimit( size_t* pValue, enum hipLimit_t limit )
+	{
+		if( limit != hipLimitStackSize )
+			return hipErrorUnsupportedLimit;
+		*pValue = 128 * 1024;
+		return hipSuccess;
+	}
+
+	static hipError_t hipCtxCreate( hipCtx_t* ctx, unsigned int flags, hipDevice_t device )
+	{
+		if( device != 0 )
+			return hipErrorInvalidDevice;
+		t_hostCtx = new HostContext{ flags };
+		*ctx = (hipCtx_t)t_hostCtx;
+		return hipSuccess;
+	}
+
+	static hipError_t hipCtxDestroy( hipCtx_t ctx )
+	{
+		if( !ctx )
+			return hipErrorInvalidContext;
+		if( t_hostCtx == (HostContext*)ctx )
+			t_hostCtx = nullptr;
+		delete (HostContext*)ctx;
+		return hipSuccess;
+	}
+
+	static hipError_t hipCtxSetCurrent( hipCtx_t ctx ) { return ( t_hostCtx = (HostContext*)ctx, hipSuccess ); }
+	static hipError_t hipCtxGetCurrent( hipCtx_t* ctx ) { return ( *ctx = (hipCtx_t)t_hostCtx, hipSuccess ); }
+
+	static hipError_t hipCtxPushCurrent( hipCtx_t ctx )
+	{
+		t_hostCtxStack.push_back( t_hostCtx );
+		t_hostCtx = (HostContext*)ctx;
+		return hipSuccess;
+	}
+
+	static hipError_t hipCtxPopCurrent( hipCtx_t* ctx )
+	{
+		if( t_hostCtxStack.empty() )
+			return hipErrorInvalidContext;
+		if( ctx )
+			*ctx = (hipCtx_t)t_hostCtx;
+		t_hostCtx = t_hostCtxStack.back();
+		t_hostCtxStack.pop_back();
+		return hipSuccess;
+	}
+
+	static hipError_t hipCtxGetDevice( hipDevice_t* device ) { return ( *device = 0, hipSuccess ); }
+	static hipError_t hipCtxGetFlags( unsigned int* flags ) { return ( *flags = t_hostCtx ? t_hostCtx->m_flags : 0, hipSuccess ); }
+	static hipError_t hipCtxGetApiVersion( hipCtx_t ctx, int* apiVersion ) { return ( *apiVersion = HOST_VERSION, hipSuccess ); }
+	static hipError_t hipCtxSynchronize() { return ( hostSynchronize(), hipSuccess ); }
+	static hipError_t hipSetDevice( int deviceId ) { return ( deviceId == 0 ) ? hipSuccess : hipErrorInvalidDevice; }
+	static hipError_t hipGetDevice( int* deviceId ) { return ( *deviceId = 0, hipSuccess ); }
+	static hipError_t hipDeviceSynchronize() { return ( hostSynchronize(), hipSuccess ); }
+
+	static hipError_t hipGetLastError()
+	{
+		const hipError_t e = t_hostLastError;
+		t_hostLastError = hipSuccess;
+		return e;
+	}
+
+	static hipError_t hipPeekAtLastError() { return t_hostLastError; }
+	static const char* hipGetErrorName( hipError_t hip_error ) { return hostFindError( hip_error ).m_name; }
+	static const char* hipGetErrorString( hipError_t hipError ) { return hostFindError( hipError ).m_string; }
+
+	static hipError_t hipMalloc( void** ptr, size_t size ) { return hostMalloc( ptr, size, hipMemoryTypeDevice ); }
+	static hipError_t hipExtMallocWithFlags( void** ptr, size_t sizeBytes, unsigned int flags ) { return hostMalloc( ptr, sizeBytes, hipMemoryTypeDevice ); }
+	static hipError_t hipMallocManaged( void** dev_ptr, size_t size, unsigned int flags ) { return hostMalloc( dev_ptr, size, hipMemoryTypeManaged ); }
+	static hipError_t hipHostMalloc( void** ptr, size_t size, unsigned int flags ) { return hostMalloc( ptr, size, hipMemoryTypeHost ); }
+	static hipError_t hipMallocHost( void** ptr, size_t size ) { return hostMalloc( ptr, size, hipMemoryTypeHost ); }
+	static hipError_t hipMemAllocHost( void** ptr, size_t size ) { return hostMalloc( ptr, size, hipMemoryTypeHost ); }
+	static hipError_t hipFree( void* ptr ) { return hostFree( ptr ); }
+	static hipError_t hipHostFree( void* ptr ) { return hostFree( ptr ); }
+	static hipError_t hipFreeHost( void* ptr ) { return hostFree( ptr ); }
+
+	static hipError_t hipMemGetInfo( size_t* free, size_t* total )
+	{
+		size_t used = 0;
+		HostState& s = hostState();
+		{
+			std::lock_guard<std::mutex> lock( s.m_mutex );
+			for( const auto& allocation : s.m_allocations )
+				used += allocation.second.m_size;
+		}
+		*total = hostPhysicalMemory();
+		*free = ( *total > used ) ? *total - used : 0;
+		return hipSuccess;
+	}
+
+	static hipError_t hipMemGetAddressRange( hipDeviceptr_t* pbase, size_t* psize, hipDeviceptr_t dptr )
+	{
+		uintptr_t base = 0;
+		const HostAllocation* allocation = hostFindAllocation( dptr, &base );
+		if( !allocation )
+			return hipErrorNotFound;
+		if( pbase )
+			*pbase = (hipDeviceptr_t)base;
+		if( psize )
+			*psize = allocation->m_size;
+		return hipSuccess;
+	}
+
+	static hipError_t hipPointerGetAttributes( hipPointerAttribute_t* attributes, const void* ptr )
+	{
+		const HostAllocation* allocation = hostFindAllocation( ptr );
+		if( !allocation )
+			return hipErrorInvalidValue;
+		*attributes = {};
+		attributes->type = allocation->m_type;
+		attributes->devicePointer = attributes->hostPointer = (void*)ptr;
+		attributes->isManaged = allocation->m_type == hipMemoryTypeManaged;
+		return hipSuccess;
+	}
+
+	// the memory is shared: the direction of a copy doesn't matter.
+	static hipError_t hipMemcpy( void* dst, const void* src, size_t sizeBytes, hipMemcpyKind kind ) { return hostCopy( dst, src, sizeBytes ); }
+	static hipError_t hipMemcpyHtoD( hipDeviceptr_t dst, void* src, size_t sizeBytes ) { return hostCopy( dst, src, sizeBytes ); }
+	static hipError_t hipMemcpyDtoH( void* dst, hipDeviceptr_t src, size_t sizeBytes ) { return hostCopy( dst, src, sizeBytes ); }
+	static hipError_t hipMemcpyDtoD( hipDeviceptr_t dst, hipDeviceptr_t src, size_t sizeBytes ) { return hostCopy( dst, src, sizeBytes ); }
+	static hipError_t hipMemcpyAsync( void* dst, const void* src, size_t sizeBytes, hipMemcpyKind kind, hipStream_t stream ) { return hostCopyAsync( dst, src, sizeBytes, stream ); }
+	static hipError_t hipMemcpyHtoDAsync( hipDeviceptr_t dst, void* src, size_t sizeBytes, hipStream_t stream ) { return hostCopyAsync( dst, src, sizeBytes, stream ); }
+	static hipError_t hipMemcpyDtoHAsync( void* dst, hipDeviceptr_t src, size_t sizeBytes, hipStream_t stream ) { return hostCopyAsync( dst, src, sizeBytes, stream ); }
+	static hipError_t hipMemcpyDtoDAsync( hipDeviceptr_t dst, hipDeviceptr_t src, size_t sizeBytes, hipStream_t stream ) { return hostCopyAsync( dst, src, sizeBytes, stream ); }
+	static hipError_t hipMemset( void* dst, int value, size_t sizeBytes ) { return hostMemset( dst, (unsigned char)value, sizeBytes, nullptr, false ); }
+	static hipError_t hipMemsetAsync( void* dst, int value, size_t sizeBytes, hipStream_t stream ) { return hostMemset( dst, (unsigned char)value, sizeBytes, stream, true ); }
+	static hipError_t hipMemsetD8( hipDeviceptr_t dest, unsigned char value, size_t count ) { return hostMemset( dest, value, count, nullptr, false ); }
+	static hipError_t hipMemsetD8Async( hipDeviceptr_t dest, unsigned char value, size_t count, hipStream_t stream ) { return hostMemset( dest, value, count, stream, true ); }
+	static hipError_t hipMemsetD16( hipDeviceptr_t dest, unsigned short value, size_t count ) { return hostMemset( dest, value, count, nullptr, false ); }
+	static hipError_t hipMemsetD16Async( hipDeviceptr_t dest, unsigned short value, size_t count, hipStream_t stream ) { return hostMemset( dest, value, count, stream, true ); }
+	static hipError_t hipMemsetD32( hipDeviceptr_t dest, int value, size_t count ) { return hostMemset( dest, value, count, nullptr, false ); }
+	static hipError_t hipMemsetD32Async( hipDeviceptr_t dst, int value, size_t count, hipStream_t stream ) { return hostMemset( dst, value, count, stream, true ); }
+
+	static hipError_t hipStreamCreate( hipStream_t* stream ) { return hipStreamCreateWithFlags( stream, 0 ); }
+	static hipError_t hipStreamCreateWithPriority( hipStream_t* stream, unsigned int flags, int priority ) { return hipStreamCreateWithFlags( stream, flags ); }
+
+	static hipError_t hipStreamCreateWithFlags( hipStream_t* stream, unsigned int flags )
+	{
+		HostStream* s = new HostStream;
+		HostState& state = hostState();
+		{
+			std::lock_guard<std::mutex> lock( state.m_mutex );
+			state.m_streams.insert( s );
+		}
+		*stream = (hipStream_t)s;
+		return hipSuccess;
+	}
+
+	static hipError_t hipStreamDestroy( hipStream_t stream )
+	{
+		HostState& state = hostState();
+		{
+			std::lock_guard<std::mutex> lock( state.m_mutex );
+			if( state.m_streams.erase( (HostStream*)stream ) == 0 )
+				return hipErrorInvalidHandle;
+		}
+		delete (HostStream*)stream;
+		return hipSuccess;
+	}
+
+	static hipError_t hipStreamSynchronize( hipStream_t stream ) { return ( hostStream( stream )->synchronize(), hipSuccess ); }
+	static hipError_t hipStreamQuery( hipStream_t stream ) { return hostStream( stream )->idle() ? hipSuccess : hipErrorNotReady; }
+
+	static hipError_t hipStreamWaitEvent( hipStream_t stream, hipEvent_t event, unsigned int flags )
+	{
+		HostEventRef e = hostEvent( event );
+		if( !e )
+			return hipErrorInvalidHandle;
+		uint64_t record;
+		{
+			std::lock_guard<std::mutex> lock( e->m_mutex );
+			record = e->m_recorded;
+		}
+		hostStream( stream )->push( [e, record]() { e->wait( record ); } );
+		return hipSuccess;
+	}
+
+	static hipError_t hipLaunchHostFunc( hipStream_t stream, hipHostFn_t fn, void* userData )
+	{
+		hostStream( stream )->push( [fn, userData]() { fn( userData ); } );
+		return hipSuccess;
+	}
+
+	static hipError_t hipEventCreate( hipEvent_t* event ) { return ( *event = (hipEvent_t) new HostEventRef( std::make_shared<HostEvent>() ), hipSuccess ); }
+	static hipError_t hipEventCreateWithFlags( hipEvent_t* event, unsigned int flags ) { return hipEventCreate( event ); }
+
+	static hipError_t hipEventDestroy( hipEvent_t event )
+	{
+		if( !event )
+			return hipErrorInvalidHandle;
+		delete (HostEventRef*)event;
+		return hipSuccess;
+	}
+
+	static hipError_t hipEventRecord( hipEvent_t event, hipStream_t stream )
+	{
+		HostEventRef e = hostEvent( event );
+		if( !e )
+			return hipErrorInvalidHandle;
+		uint64_t record;
+		{
+			std::lock_guard<std::mutex> lock( e->m_mutex );
+			record = ++e->m_recorded;
+		}
+		hostStream( stream )->push( [e, record]() {
+			{
+				std::lock_guard<std::mutex> lock( e->m_mutex );
+				e->m_completed = record;
+				e->m_time = traceNow();
+			}
+			e->m_cv.notify_all();
+		} );
+		return hipSuccess;
+	}
+
+	static hipError_t hipEventSynchronize( hipEvent_t event )
+	{
+		HostEventRef e = hostEvent( event );
+		if( !e )
+			return hipErrorInvalidHandle;
+		uint64_t record;
+		{
+			std::lock_guard<std::mutex> lock( e->m_mutex );
+			record = e->m_recorded;
+		}
+		e->wait( record );
+		return hipSuccess;
+	}
+
+	static hipError_t hipEventQuery( hipEvent_t event )
+	{
+		HostEventRef e = hostEvent( event );
+		if( !e )
+			return hipErrorInvalidHandle;
+		std::lock_guard<std::mutex> lock( e->m_mutex );
+		return ( e->m_completed == e->m_recorded ) ? hipSuccess : hipErrorNotReady;
+	}
+
+	static hipError_t hipEventElapsedTime( float* ms, hipEvent_t start, hipEvent_t stop )
+	{
+		HostEventRef events[] = { hostEvent( start ), hostEvent( stop ) };
+		uint64_t times[2];
+		for( int i = 0; i < 2; i++ )
+		{
+			if( !events[i] )
+				return hipErrorInvalidHandle;
+			std::lock_guard<std::mutex> lock( events[i]->m_mutex );
+			if( events[i]->m_recorded == 0 )
+				return hipErrorInvalidHandle;
+			if( events[i]->m_completed != events[i]->m_recorded )
+				return hipErrorNotReady;
+			times[i] = events[i]->m_time;
+		}
+		*ms = (float)( ( (double)times[1] - (double)times[0] ) / 1e6 );
+		return hipSuccess;
+	}
+
+	static hipError_t hipModuleLoadData( hipModule_t* module, const void* image )
+	{
+		HostImageHeader header;
+		if( !image )
+			return hipErrorInvalidValue;
+		memcpy( &header, image, sizeof( header ) );
+		if( memcmp( header.m_magic, HOST_IMAGE_MAGIC, sizeof( header.m_magic ) ) != 0 )
+			return hipErrorInvalidImage;
+
+		// the library is loaded from a file.
+		std::unique_ptr<HostModule> m( new HostModule );
+		m->m_directory = hostTempDirectory();
+#if defined( _WIN32 )
+		const std::filesystem::path path = m->m_directory / "kernel.dll";
+#else
+		const std::filesystem::path path = m->m_directory / "kernel.so";
+#endif
+		std::error_code ec;
+		if( m->m_directory.empty() || !hostWriteFile( path, (const char*)image + sizeof( header ), header.m_size ) )
+		{
+			std::filesystem::remove_all( m->m_directory, ec );
+			return hipErrorOperatingSystem;
+		}
+#if defined( _WIN32 )
+		m->m_library = (void*)LoadLibraryA( path.string().c_str() );
+#else
+		m->m_library = dlopen( path.string().c_str(), RTLD_NOW | RTLD_LOCAL );
+		if( !m->m_library )
+			printf( "Orochi host: %s\n", dlerror() );
+		std::filesystem::remove_all( m->m_directory, ec );
+		m->m_directory.clear();
+#endif
+		if( !m->m_library )
+		{
+			std::filesystem::remove_all( m->m_directory, ec );
+			return hipErrorSharedObjectInitFailed;
+		}
+		*module = (hipModule_t)m.release();
+		return hipSuccess;
+	}
+
+	static hipError_t hipModuleLoadDataEx( hipModule_t* module, const void* image, unsigned int numOptions, hipJitOption* options, void** optionValues )
+	{
+		return hipModuleLoadData( module, image );
+	}
+
+	static hipError_t hipModuleUnload( hipModule_t module )
+	{
+		HostModule* m = (HostModule*)module;
+		if( !m )
+			return hipErrorInvalidHandle;
+		// the launches of its functions complete first.
+		hostSynchronize();
+#if defined( _WIN32 )
+		FreeLibrary( (HMODULE)m->m_library );
+		std::error_code ec;
+		std::filesystem::remove_all( m->m_directory, ec );
+#else
+		dlclose( m->m_library );
+#endif
+		delete m;
+		return hipSuccess;
+	}
+
+	static void* findSymbol( HostModule* m, const std::string& name )
+	{
+#if defined( _WIN32 )
+		return (void*)GetProcAddress( (HMODULE)m->m_library, name.c_str() );
+#else
+		return dlsym( m->m_library, name.c_str() );
+#endif
+	}
+
+	static hipError_t hipModuleGetFunction( hipFunction_t* function, hipModule_t module, const char* kname )
+	{
+		HostModule* m = (HostModule*)module;
+		if( !m || !kname )
+			return hipErrorInvalidValue;
+		std::lock_guard<std::mutex> lock( m->m_mutex );
+		std::unique_ptr<HostFunction>& f = m->m_functions[kname];
+		if( !f )
+		{
+			const HostKernel* kernel = (const HostKernel*)findSymbol( m, std::string( "__oroHostKernel_" ) + kname );
+			if( !kernel || kernel->m_version != HOST_KERNEL_VERSION )
+			{
+				m->m_functions.erase( kname );
+				return hipErrorNotFound;
+			}
+			f.reset( new HostFunction{ kernel, m } );
+		}
+		*function = (hipFunction_t)f.get();
+		return hipSuccess;
+	}
+
+	// the variables at global scope, by their name.
+	static hipError_t hipModuleGetGlobal( hipDeviceptr_t* dptr, size_t* bytes, hipModule_t hmod, const char* name )
+	{
+		HostModule* m = (HostModule*)hmod;
+		if( !m || !name )
+			return hipErrorInvalidValue;
+		void* symbol = findSymbol( m, name );
+		if( !symbol )
+			return hipErrorNotFound;
+		if( dptr )
+			*dptr = symbol;
+		if( bytes )
+		{
+			*bytes = 0;
+#if defined( RTLD_DL_SYMENT )
+			Dl_info info;
+			const ElfW( Sym )* entry = nullptr;
+			if( dladdr1( symbol, &info, (void**)&entry, RTLD_DL_SYMENT ) && entry )
+				*bytes = entry->st_size;
+#endif
+		}
+		return hipSuccess;
+	}
+
+	static hipError_t hipFuncGetAttribute( int* value, hipFunction_attribute attrib, hipFunction_t hfunc )
+	{
+		if( !hfunc )
+			return hipErrorInvalidHandle;
+		*value = ( attrib == HIP_FUNC_ATTRIBUTE_MAX_THREADS_PER_BLOCK ) ? HOST_MAX_THREADS_PER_BLOCK : 0;
+		return hipSuccess;
+	}
+
+	static hipError_t hipModuleOccupancyMaxActiveBlocksPerMultiprocessor( int* numBlocks, hipFunction_t f, int blockSize, size_t dynSharedMemPerBlk )
+	{
+		return ( *numBlocks = 1, hipSuccess );
+	}
+
+	static hipError_t hipModuleOccupancyMaxPotentialBlockSize( int* gridSize, int* blockSize, hipFunction_t f, size_t dynSharedMemPerBlk, int blockSizeLimit )
+	{
+		*gridSize = hostNumThreads();
+		*blockSize = ( blockSizeLimit > 0 ) ? std::min<int>( blockSizeLimit, HOST_MAX_THREADS_PER_BLOCK ) : HOST_MAX_THREADS_PER_BLOCK;
+		return hipSuccess;
+	}
+
+	// the arguments are packed when the kernel is launched, the blocks run on the pool when the stream reaches it.
+	static hipError_t hipModuleLaunchKernel( hipFunction_t f, unsigned int gridDimX, unsigned int gridDimY, unsigned int gridDimZ, unsigned int blockDimX, unsigned int blockDimY, unsigned int blockDimZ,
+											 unsigned int sharedMemBytes, hipStream_t stream, void** kernelParams, void** extra )
+	{
+		HostFunction* function = (HostFunction*)f;
+		if( !function )
+			return t_hostLastError = hipErrorInvalidHandle;
+		const uint64_t numThreads = (uint64_t)blockDimX * blockDimY * blockDimZ;
+		const uint64_t numBlocks = (uint64_t)gridDimX * gridDimY * gridDimZ;
+		if( numThreads == 0 || numThreads > HOST_MAX_THREADS_PER_BLOCK || numBlocks == 0 || numBlocks > UINT_MAX )
+			return t_hostLastError = hipErrorInvalidConfiguration;
+
+		const void* buffer = nullptr;
+		size_t bufferSize = 0;
+		for( int i = 0; extra && extra[i] != HIP_LAUNCH_PARAM_END && extra[i] != nullptr; i += 2 )
+		{
+			if( extra[i] == HIP_LAUNCH_PARAM_BUFFER_POINTER ) buffer = extra[i + 1];
+			if( extra[i] == HIP_LAUNCH_PARAM_BUFFER_SIZE ) bufferSize = *(size_t*)extra[i + 1];
+		}
+		const HostKernel* kernel = function->m_kernel;
+		struct Launch
+		{
+			HostLaunch m_launch;
+			std::vector<char> m_args;
+		};
+		std::shared_ptr<Launch> launch = std::make_shared<Launch>();
+		launch->m_launch = { { gridDimX, gridDimY, gridDimZ }, { blockDimX, blockDimY, blockDimZ }, sharedMemBytes, nullptr };
+		launch->m_args.resize( kernel->m_argsSize + kernel->m_argsAlignment );
+		void* args = launch->m_args.data() + ( kernel->m_argsAlignment - (uintptr_t)launch->m_args.data() % kernel->m_argsAlignment ) % kernel->m_argsAlignment;
+		if( ( !kernelParams && !buffer && kernel->m_argsSize > 1 ) || kernel->m_pack( args, kernelParams, buffer, bufferSize ) != 0 )
+			return t_hostLastError = hipErrorInvalidValue;
+		launch->m_launch.m_args = args;
+
+		hostStream( stream )->push( [launch, kernel, numBlocks]() {
+			hostPool().run( (unsigned int)numBlocks, [&]( unsigned int block ) { kernel->m_run( &launch->m_launch, block ); } );
+		} );
+		return hipSuccess;
+	}
+
+	static hiprtcResult hiprtcVersion( int* major, int* minor )
+	{
+		*major = HOST_VERSION;
+		*minor = 0;
+		return HIPRTC_SUCCESS;
+	}
+
+	static const char* hiprtcGetErrorString( hiprtcResult result )
+	{
+		switch( result )
+		{
+		case HIPRTC_SUCCESS: return "HIPRTC_SUCCESS";
+		case HIPRTC_ERROR_INVALID_INPUT: return "HIPRTC_ERROR_INVALID_INPUT";
+		case HIPRTC_ERROR_INVALID_PROGRAM: return "HIPRTC_ERROR_INVALID_PROGRAM";
+		case HIPRTC_ERROR_COMPILATION: return "HIPRTC_ERROR_COMPILATION";
+		case HIPRTC_ERROR_NAME_EXPRESSION_NOT_VALID: return "HIPRTC_ERROR_NAME_EXPRESSION_NOT_VALID";
+		default: return "HIPRTC_ERROR_INTERNAL_ERROR";
+		}
+	}
+
+	static hiprtcResult hiprtcCreateProgram( hiprtcProgram* prog, const char* src, const char* name, int numHeaders, const char** headers, const char** includeNames )
+	{
+		if( !prog || !src || numHeaders < 0 || ( numHeaders > 0 && ( !headers || !includeNames ) ) )
+			return HIPRTC_ERROR_INVALID_INPUT;
+		HostProgram* p = new HostProgram;
+		p->m_source = src;
+		for( int i = 0; i < numHeaders; i++ )
+			p->m_headers.emplace_back( includeNames[i], headers[i] );
+		*prog = (hiprtcProgram)p;
+		return HIPRTC_SUCCESS;
+	}
+
+	static hiprtcResult hiprtcDestroyProgram( hiprtcProgram* prog )
+	{
+		if( !prog )
+			return HIPRTC_ERROR_INVALID_INPUT;
+		delete (HostProgram*)*prog;
+		*prog = nullptr;
+		return HIPRTC_SUCCESS;
+	}
+
+	static hiprtcResult hiprtcAddNameExpression( hiprtcProgram prog, const char* name_expression )
+	{
+		HostProgram* p = (HostProgram*)prog;
+		if( !p || !name_expression )
+			return HIPRTC_ERROR_INVALID_INPUT;
+		// the kernels aren't mangled: the lowered name of &kernel is kernel.
+		std::string lowered = name_expression;
+		lowered.erase( std::remove_if( lowered.begin(), lowered.end(), []( char c ) { return c == '&' || isspace( (unsigned char)c ); } ), lowered.end() );
+		p->m_nameExpressions.push_back( name_expression );
+		p->m_loweredNames.push_back( lowered );
+		return HIPRTC_SUCCESS;
+	}
+
+	static hiprtcResult hiprtcGetLoweredName( hiprtcProgram prog, const char* name_expression, const char** lowered_name )
+	{
+		HostProgram* p = (HostProgram*)prog;
+		if( !p || !name_expression || !lowered_name )
+			return HIPRTC_ERROR_INVALID_INPUT;
+		for( size_t i = 0; i < p->m_nameExpressions.size(); i++ )
+		{
+			if( p->m_nameExpressions[i] == name_expression )
+			{
+				*lowered_name = p->m_loweredNames[i].c_str();
+				return HIPRTC_SUCCESS;
+			}
+		}
+		return HIPRTC_ERROR_NAME_EXPRESSION_NOT_VALID;
+	}
+
+	static hiprtcResult hiprtcCompileProgram( hiprtcProgram prog, int numOptions, const char** options )
+	{
+		HostProgram* p = (HostProgram*)prog;
+		if( !p )
+			return HIPRTC_ERROR_INVALID_PROGRAM;
+		p->m_log.clear();
+		p->m_code.clear();
+		const std::filesystem::path dir = hostTempDirectory();
+		if( dir.empty() )
+		{
+			p->m_log = "Orochi host: can't create a temporary directory\n";
+			return HIPRTC_ERROR_INTERNAL_ERROR;
+		}
+		const hiprtcResult e = hostCompile( *p, dir, hostCompilerOptions( numOptions, options ) );
+		std::error_code ec;
+		std::filesystem::remove_all( dir, ec );
+		return e;
+	}
+
+	static hiprtcResult hiprtcGetProgramLogSize( hiprtcProgram prog, size_t* logSizeRet )
+	{
+		if( !prog )
+			return HIPRTC_ERROR_INVALID_PROGRAM;
+		*logSizeRet = ( (HostProgram*)prog )->m_log.size() + 1;
+		return HIPRTC_SUCCESS;
+	}
+
+	static hiprtcResult hiprtcGetProgramLog( hiprtcProgram prog, char* log )
+	{
+		if( !prog )
+			return HIPRTC_ERROR_INVALID_PROGRAM;
+		const std::string& l = ( (HostProgram*)prog )->m_log;
+		memcpy( log, l.c_str(), l.size() + 1 );
+		return HIPRTC_SUCCESS;
+	}
+
+	static hiprtcResult hiprtcGetCodeSize( hiprtcProgram prog, size_t* codeSizeRet )
+	{
+		if( !prog )
+			return HIPRTC_ERROR_INVALID_PROGRAM;
+		*codeSizeRet = ( (HostProgram*)prog )->m_code.size();
+		return HIPRTC_SUCCESS;
+	}
+
+	static hiprtcResult hiprtcGetCode( hiprtcProgram prog, char* code )
+	{
+		if( !prog )
+			return HIPRTC_ERROR_INVALID_PROGRAM;
+		const std::vector<char>& c = ( (HostProgram*)prog )->m_code;
+		memcpy( code, c.data(), c.size() );
+		return HIPRTC_SUCCESS;
+	}
+
+	// the code is also the bitcode: the kernels aren't linked.
+	static hiprtcResult hiprtcGetBitcodeSize( hiprtcProgram prog, size_t* bitcode_size ) { return hiprtcGetCodeSize( prog, bitcode_size ); }
+	static hiprtcResult hiprtcGetBitcode( hiprtcProgram prog, char* bitcode ) { return hiprtcGetCode( prog, bitcode ); }
+};
+
+// calls the function of HostApi, if there is one. R is the result of the HIP function.
+template<typename R, typename F>
+inline auto hostCall( F f, int ) -> decltype( f( HostApi() ) )
+{
+	return f( HostApi() );
+}
+
+template<typename R, typename F>
+inline R hostCall( F, ... )
+{
+	if constexpr( std::is_same<R, hipError_t>::value )
+		return t_hostLastError = hipErrorNotSupported;
+	else if constexpr( std::is_same<R, hiprtcResult>::value )
+		return HIPRTC_ERROR_INTERNAL_ERROR;
+	else
+		return R();
+}
+} // namespace
+
+// the capture of the calls in a log ( see oroCaptureBegin and OrochiCapture.h ).
+// the results of the HIP, CUDA and host functions of the generated wrappers are given to captureArgs around the region ( see ORO_CAPTURE ),
+// which records the calls returning successfully while a capture runs.
+namespace
+{
+struct CaptureState
+{
+	FILE* m_file = nullptr;
+	oroCaptureData m_data = ORO_CAPTURE_DATA_NONE;
+	uint64_t m_begin = 0;
+	// the live allocations, by pointer: their size. they are tracked outside of the captures too after oroCaptureTrackAllocations, see captureTrack.
+	std::map<uint64_t, uint64_t> m_allocations;
+	// the hashes of the images in the log.
+	std::unordered_set<uint64_t> m_images;
+	// by function, see oroCaptureSetKernelArgSizes.
+	std::unordered_map<uint64_t, std::vector<uint64_t>> m_argSizes;
+	std::vector<uint64_t> m_body;
+};
+std::mutex s_captureMutex;
+// guarded by s_captureMutex.
+CaptureState s_capture;
+// set by oroCaptureTrackAllocations: the allocations are tracked between the captures, so the next one records them.
+std::atomic<bool> s_captureTracking( false );
+
+// the tags of the captured calls.
+struct CaptureMalloc {};
+struct CaptureFree {};
+struct CaptureMemcpy {};
+struct CaptureMemcpyHtoD {};
+struct CaptureMemcpyDtoH {};
+struct CaptureMemcpyDtoD {};
+struct CaptureMemset8 {};
+struct CaptureMemset32 {};
+struct CaptureModuleLoad {};
+struct CaptureModuleGetFunction {};
+struct CaptureModuleUnload {};
+struct CaptureLaunch {};
+struct CaptureStreamCreate {};
+struct CaptureStreamDestroy {};
+struct CaptureStreamSynchronize {};
+struct CaptureEventCreate {};
+struct CaptureEventDestroy {};
+struct CaptureEventRecord {};
+struct CaptureEventSynchronize {};
+struct CaptureStreamWaitEvent {};
+struct CaptureDeviceSynchronize {};
+
+template<typename T>
+inline uint64_t captureHandle( const T& v )
+{
+	static_assert( sizeof( T ) <= sizeof( uint64_t ), "not a handle" );
+	uint64_t h = 0;
+	memcpy( &h, &v, sizeof( T ) );
+	return h;
+}
+
+// the stream of the asynchronous calls, the last argument.
+inline uint64_t captureStream() { return 0; }
+template<typename S>
+inline uint64_t captureStream( S stream ) { return captureHandle( stream ); }
+
+inline void capturePut( uint64_t v ) { s_capture.m_body.push_back( v ); }
+
+void capturePutBytes( const void* data, uint64_t size )
+{
+	const size_t n = s_capture.m_body.size();
+	s_capture.m_body.resize( n + ( size + 7 ) / 8, 0 );
+	memcpy( &s_capture.m_body[n], data, size );
+}
+
+// the allocation containing the pointer, 0 if there is none.
+uint64_t captureFindAllocation( uint64_t ptr )
+{
+	auto it = s_capture.m_allocations.upper_bound( ptr );
+	if( it == s_capture.m_allocations.begin() ) 
+		return 0;
+	--it;
+	return ( ptr < it->first + it->second ) ? it->first : 0;
+}
+
+void capturePutRef( uint64_t ptr )
+{
+	const uint64_t allocation = captureFindAllocation( ptr );
+	capturePut( allocation );
+	capturePut( ptr - allocation );
+}
+
+void captureWrite( uint16_t op, uint16_t flags, uint64_t start )
+{
+	const uint64_t end = traceNow();
+	OroCapture::RecordHeader header = { op, flags, (uint32_t)( s_capture.m_body.size() * sizeof( uint64_t ) ), start - s_capture.m_begin, end - start };
+	fwrite( &header, sizeof( header ), 1, s_capture.m_file );
+	fwrite( s_capture.m_body.data(), sizeof( uint64_t ), s_capture.m_body.size(), s_capture.m_file );
+	s_capture.m_body.clear();
+}
+
+void captureHtoD( uint64_t start, uint64_t dst, const void* src, uint64_t size, uint64_t stream, bool async )
+{
+	capturePutRef( dst );
+	capturePut( size );
+	capturePut( stream );
+	capturePut( s_capture.m_data );
+	if( s_capture.m_data == ORO_CAPTURE_DATA_HASH ) 
+		capturePut( OroCapture::hash( src, size ) );
+	if( s_capture.m_data == ORO_CAPTURE_DATA_ALL ) 
+		capturePutBytes( src, size );
+	captureWrite( OroCapture::MEMCPY_HTOD, async ? OroCapture::FLAG_ASYNC : 0, start );
+}
+
+void captureDtoH( uint64_t start, const void* dst, uint64_t src, uint64_t size, uint64_t stream, bool async )
+{
+	capturePutRef( src );
+	capturePut( size );
+	capturePut( stream );
+	// the data of an asynchronous copy isn't there yet.
+	const oroCaptureData data = async ? ORO_CAPTURE_DATA_NONE : s_capture.m_data;
+	capturePut( data );
+	if( data != ORO_CAPTURE_DATA_NONE ) 
+		capturePut( OroCapture::hash( dst, size ) );
+	captureWrite( OroCapture::MEMCPY_DTOH, async ? OroCapture::FLAG_ASYNC : 0, start );
+}
+
+void captureDtoD( uint64_t start, uint64_t dst, uint64_t src, uint64_t size, uint64_t stream, bool async )
+{
+	capturePutRef( dst );
+	capturePutRef( src );
+	capturePut( size );
+	capturePut( stream );
+	captureWrite( OroCapture::MEMCPY_DTOD, async ? OroCapture::FLAG_ASYNC : 0, start );
+}
+
+void captureMemset( uint64_t start, uint64_t dst, uint64_t value, uint64_t count, uint64_t elementSize, uint64_t stream, bool async )
+{
+	capturePutRef( dst );
+	capturePut( value );
+	capturePut( count );
+	capturePut( elementSize );
+	capturePut( stream );
+	captureWrite( OroCapture::MEMSET, async ? OroCapture::FLAG_ASYNC : 0, start );
+}
+
+// the size of a code object given without size: an ELF ( HIP code object, cubin ), a CUDA fatbin, a program of the host backend, a clang offload bundle, or a PTX. 0 if unknown.
+uint64_t captureImageSize( const void* image )
+{
+	const unsigned char* p = (const unsigned char*)image;
+	auto read = [p]( uint64_t offset, int size ) -> uint64_t 
+	{
+		uint64_t v = 0;
+		memcpy( &v, p + offset, size );
+		return v;
+	};
+	if( memcmp( p, "\x7f" "ELF", 4 ) == 0 && p[4] == 2 )
+	{
+		const uint64_t phoff = read( 0x20, 8 ), shoff = read( 0x28, 8 );
+		const uint64_t phentsize = read( 0x36, 2 ), phnum = read( 0x38, 2 ), shentsize = read( 0x3a, 2 ), shnum = read( 0x3c, 2 );
+		uint64_t size = std::max( phoff + phentsize * phnum, shoff + shentsize * shnum );
+		for( uint64_t i = 0; i < shnum; i++ )
+		{
+			const uint64_t section = shoff + i * shentsize;
+			const uint32_t NOBITS = 8;
+			if( read( section + 0x04, 4 ) != NOBITS ) 
+				size = std::max( size, read( section + 0x18, 8 ) + read( section + 0x20, 8 ) );
+		}
+		return size;
+	}
+	if( read( 0, 4 ) == 0xba55ed50 ) 
+		return read( 6, 2 ) + read( 8, 8 );
+	if( memcmp( p, HOST_IMAGE_MAGIC, sizeof( HOST_IMAGE_MAGIC ) ) == 0 ) 
+		return sizeof( HostImageHeader ) + read( offsetof( HostImageHeader, m_size ), 8 );
+	const char BUNDLE[] = "__CLANG_OFFLOAD_BUNDLE__";
+	if( memcmp( p, BUNDLE, sizeof( BUNDLE ) - 1 ) == 0 )
+	{
+		uint64_t offset = sizeof( BUNDLE ) - 1;
+		const uint64_t n = read( offset, 8 );
+		offset += 8;
+		uint64_t size = offset;
+		for( uint64_t i = 0; i < n; i++ )
+		{
+			size = std::max( size, read( offset, 8 ) + read( offset + 8, 8 ) );
+			offset += 24 + read( offset + 16, 8 );
+		}
+		return std::max( size, offset );
+	}
+	for( int i = 0; i < 4; i++ )
+	{
+		if( !isprint( p[i] ) && !isspace( p[i] ) ) 
+			return 0;
+	}
+	return strlen( (const char*)image ) + 1;
+}
+
+void captureLaunch( uint64_t start, uint64_t f, const unsigned int* dims, uint64_t stream, void** kernelParams, void** extra )
+{
+	capturePut( f );
+	for( int i = 0; i < 7; i++ )
+		capturePut( dims[i] );
+	capturePut( stream );
+
+	std::vector<std::pair<const void*, uint64_t>> args;
+	uint16_t flags = OroCapture::FLAG_ASYNC;
+	bool known = true;
+	if( extra )
+	{
+		// the pairs HIP_LAUNCH_PARAM_BUFFER_POINTER, HIP_LAUNCH_PARAM_BUFFER_SIZE ( the same on CUDA ) until the end.
+		const void* buffer = nullptr;
+		uint64_t size = 0;
+		for( int i = 0; extra[i] != HIP_LAUNCH_PARAM_END && extra[i] != nullptr; i += 2 )
+		{
+			if( extra[i] == HIP_LAUNCH_PARAM_BUFFER_POINTER ) buffer = extra[i + 1];
+			if( extra[i] == HIP_LAUNCH_PARAM_BUFFER_SIZE ) size = *(size_t*)extra[i + 1];
+		}
+		args.push_back( { buffer, size } );
+		flags |= OroCapture::FLAG_EXTRA;
+	}
+	else if( kernelParams )
+	{
+		auto it = s_capture.m_argSizes.find( f );
+		known = ( it != s_capture.m_argSizes.end() );
+		if( known ) 
+		{
+			for( size_t i = 0; i < it->second.size(); i++ )
+				args.push_back( { kernelParams[i], it->second[i] } );
+		}
+	}
+	if( !known )
+	{
+		capturePut( OroCapture::UNKNOWN_ARGS );
+		captureWrite( OroCapture::LAUNCH, flags, start );
+		return;
+	}
+
+	capturePut( args.size() );
+	for( const auto& arg : args )
+	{
+		capturePut( arg.second );
+		capturePutBytes( arg.first, arg.second );
+	}
+	// the device pointers in the arguments, as references.
+	std::vector<uint64_t> relocations;
+	for( size_t i = 0; i < args.size(); i++ )
+	{
+		for( uint64_t offset = 0; offset + 8 <= args[i].second; offset += 8 )
+		{
+			uint64_t ptr;
+			memcpy( &ptr, (const char*)args[i].first + offset, 8 );
+			const uint64_t allocation = captureFindAllocation( ptr );
+			if( allocation == 0 ) 
+				continue;
+			relocations.insert( relocations.end(), { i, offset, allocation, ptr - allocation } );
+		}
+	}
+	capturePut( relocations.size() / 4 );
+	for( uint64_t v : relocations )
+		capturePut( v );
+	captureWrite( OroCapture::LAUNCH, flags, start );
+}
+
+template<typename P, typename S>
+void captureTrack( CaptureMalloc, P ptr, S size )
+{
+	s_capture.m_allocations[captureHandle( *ptr )] = size;
+}
+
+template<typename P>
+void captureTrack( CaptureFree, P ptr )
+{
+	s_capture.m_allocations.erase( captureHandle( ptr ) );
+}
+
+template<typename P, typename S>
+void captureRecord( CaptureMalloc, uint64_t start, P ptr, S size )
+{
+	captureTrack( CaptureMalloc(), ptr, size );
+	const uint64_t p = captureHandle( *ptr );
+	capturePut( p );
+	capturePut( size );
+	captureWrite( OroCapture::MALLOC, 0, start );
+}
 
+template<typename P>
+void captureRecord( CaptureFree, uint64_t start, P ptr )
+{
+	captureTrack( CaptureFree(), ptr );
+	const uint64_t p = captureHandle( ptr );
+	capturePut( p );
+	captureWrite( OroCapture::FREE, 0, start );
+}
 
-#include "nvidia_hip_runtime_api_oro.h"
-#include "nvidia_hiprtc_oro.h"
-#endif
+// oroMemcpy and oroMemcpyAsync, by the direction.
+template<typename D, typename S, typename N, typename K, typename... St>
+void captureRecord( CaptureMemcpy, uint64_t start, D dst, S src, N size, K kind, St... stream )
+{
+	const uint64_t d = captureHandle( dst ), s = captureHandle( src );
+	bool dstDevice = ( kind == 1 || kind == 3 );
+	bool srcDevice = ( kind == 2 || kind == 3 );
+	// hipMemcpyDefault: by the pointers.
+	if( kind == 4 )
+	{
+		dstDevice = captureFindAllocation( d ) != 0;
+		srcDevice = captureFindAllocation( s ) != 0;
+	}
+	const bool async = sizeof...( St ) != 0;
+	if( dstDevice && srcDevice ) 
+		captureDtoD( start, d, s, size, captureStream( stream... ), async );
+	else if( dstDevice ) 
+		captureHtoD( start, d, (const void*)src, size, captureStream( stream... ), async );
+	else if( srcDevice ) 
+		captureDtoH( start, (const void*)dst, s, size, captureStream( stream... ), async );
 }
 
+template<typename D, typename S, typename N, typename... St>
+void captureRecord( CaptureMemcpyHtoD, uint64_t start, D dst, S src, N size, St... stream )
+{
+	captureHtoD( start, captureHandle( dst ), (const void*)src, size, captureStream( stream... ), sizeof...( St ) != 0 );
+}
+
+template<typename D, typename S, typename N, typename... St>
+void captureRecord( CaptureMemcpyDtoH, uint64_t start, D dst, S src, N size, St... stream )
+{
+	captureDtoH( start, (const void*)dst, captureHandle( src ), size, captureStream( stream... ), sizeof...( St ) != 0 );
+}
 
+template<typename D, typename S, typename N, typename... St>
+void captureRecord( CaptureMemcpyDtoD, uint64_t start, D dst, S src, N size, St... stream )
+{
+	captureDtoD( start, captureHandle( dst ), captureHandle( src ), size, captureStream( stream... ), sizeof...( St ) != 0 );
+}
 
+template<typename D, typename V, typename N, typename... St>
+void captureRecord( CaptureMemset8, uint64_t start, D dst, V value, N count, St... stream )
+{
+	captureMemset( start, captureHandle( dst ), (unsigned char)value, count, 1, captureStream( stream... ), sizeof...( St ) != 0 );
+}
 
+template<typename D, typename V, typename N, typename... St>
+void captureRecord( CaptureMemset32, uint64_t start, D dst, V value, N count, St... stream )
+{
+	captureMemset( start, captureHandle( dst ), (uint32_t)value, count, 4, captureStream( stream... ), sizeof...( St ) != 0 );
+}
 
+// oroModuleLoadData and oroModuleLoadDataEx.
+template<typename M, typename... O>
+void captureRecord( CaptureModuleLoad, uint64_t start, M module, const void* image, O... options )
+{
+	const uint64_t size = captureImageSize( image );
+	const uint64_t key = OroCapture::hash( image, size );
+	const bool first = size != 0 && s_capture.m_images.insert( key ).second;
+	capturePut( captureHandle( *module ) );
+	capturePut( key );
+	capturePut( size );
+	if( first ) 
+		capturePutBytes( image, size );
+	captureWrite( OroCapture::MODULE_LOAD, first ? OroCapture::FLAG_IMAGE : 0, start );
+}
 
+template<typename F, typename M>
+void captureRecord( CaptureModuleGetFunction, uint64_t start, F function, M module, const char* name )
+{
+	capturePut( captureHandle( *function ) );
+	capturePut( captureHandle( module ) );
+	capturePut( strlen( name ) );
+	capturePutBytes( name, strlen( name ) );
+	captureWrite( OroCapture::MODULE_GET_FUNCTION, 0, start );
+}
 
+template<typename M>
+void captureRecord( CaptureModuleUnload, uint64_t start, M module )
+{
+	capturePut( captureHandle( module ) );
+	captureWrite( OroCapture::MODULE_UNLOAD, 0, start );
+}
 
-std::unordered_map<void*, oroCtx> s_oroCtxs;
-static std::mutex mtx;
-thread_local static oroApi s_api = ORO_API_HIP;
-static oroU32 s_loadedApis = 0;
+template<typename F, typename S>
+void captureRecord( CaptureLaunch, uint64_t start, F f, unsigned int gx, unsigned int gy, unsigned int gz, unsigned int bx, unsigned int by, unsigned int bz, unsigned int shared, S stream, void** kernelParams, void** extra )
+{
+	const unsigned int dims[] = { gx, gy, gz, bx, by, bz, shared };
+	captureLaunch( start, captureHandle( f ), dims, captureHandle( stream ), kernelParams, extra );
+}
 
-struct ioroCtx_t
+template<typename S, typename... Fl>
+void captureRecord( CaptureStreamCreate, uint64_t start, S stream, Fl... flags )
 {
-public:
+	capturePut( captureHandle( *stream ) );
+	capturePut( ( 0u | ... | (unsigned int)flags ) );
+	captureWrite( OroCapture::STREAM_CREATE, 0, start );
+}
 
-	ioroCtx_t()
-	{
-		m_ptr = nullptr;
-		m_storage = 0;
-	}
+template<typename S>
+void captureRecord( CaptureStreamDestroy, uint64_t start, S stream )
+{
+	capturePut( captureHandle( stream ) );
+	captureWrite( OroCapture::STREAM_DESTROY, 0, start );
+}
 
-	void* m_ptr;
-private:
-	oroU32 m_storage;
+template<typename S>
+void captureRecord( CaptureStreamSynchronize, uint64_t start, S stream )
+{
+	capturePut( captureHandle( stream ) );
+	captureWrite( OroCapture::STREAM_SYNCHRONIZE, 0, start );
+}
 
-public:
-	oroApi getApi() const { return (oroApi)m_storage; }
-	void setApi( oroApi api ) { m_storage = api; }
+template<typename E, typename... Fl>
+void captureRecord( CaptureEventCreate, uint64_t start, E event, Fl... flags )
+{
+	capturePut( captureHandle( *event ) );
+	capturePut( ( 0u | ... | (unsigned int)flags ) );
+	captureWrite( OroCapture::EVENT_CREATE, 0, start );
+}
+
+template<typename E>
+void captureRecord( CaptureEventDestroy, uint64_t start, E event )
+{
+	capturePut( captureHandle( event ) );
+	captureWrite( OroCapture::EVENT_DESTROY, 0, start );
+}
+
+template<typename E, typename S>
+void captureRecord( CaptureEventRecord, uint64_t start, E event, S stream )
+{
+	capturePut( captureHandle( event ) );
+	capturePut( captureHandle( stream ) );
+	captureWrite( OroCapture::EVENT_RECORD, OroCapture::FLAG_ASYNC, start );
+}
+
+template<typename E>
+void captureRecord( CaptureEventSynchronize, uint64_t start, E event )
+{
+	capturePut( captureHandle( event ) );
+	captureWrite( OroCapture::EVENT_SYNCHRONIZE, 0, start );
+}
+
+template<typename S, typename E, typename Fl>
+void captureRecord( CaptureStreamWaitEvent, uint64_t start, S stream, E event, Fl flags )
+{
+	capturePut( captureHandle( stream ) );
+	capturePut( captureHandle( event ) );
+	capturePut( flags );
+	captureWrite( OroCapture::STREAM_WAIT_EVENT, OroCapture::FLAG_ASYNC, start );
+}
+
+inline void captureRecord( CaptureDeviceSynchronize, uint64_t start ) 
+{ 
+	captureWrite( OroCapture::DEVICE_SYNCHRONIZE, 0, start ); 
+}
+
+// the arguments of a call, and the scope timing it.
+template<typename Op, typename... A>
+struct CaptureArgs
+{
+	TraceScope* m_trace;
+	std::tuple<A...> m_args;
 };
 
-struct ioroDevice
+template<typename Op, typename... A>
+inline CaptureArgs<Op, A...> captureArgs( TraceScope& trace, A... a )
 {
-private:
-	oroU32 m_api : 4;
-	oroU32 m_deviceIdx : 16;
+	return { &trace, std::tuple<A...>( a... ) };
+}
 
-public:
-	ioroDevice( int src = 0)
+// records the call if it succeeds during a capture. the result is given to it after the call, as name( a... ) << captureArgs<Op>( trace, a... ).
+// the allocations are tracked without capture too when asked, so a capture records the ones made before it. the tracer gets the arguments.
+template<typename R, typename Op, typename... A>
+inline R operator<<( R r, const CaptureArgs<Op, A...>& call )
+{
+	TraceScope& trace = *call.m_trace;
+	if( trace.m_trace ) 
+		std::apply( [&trace]( auto... a ) { trace.setArgs( a... ); }, call.m_args );
+	constexpr bool allocation = std::is_same<Op, CaptureMalloc>::value || std::is_same<Op, CaptureFree>::value;
+	if( r != 0 || !( s_capturing.load( std::memory_order_relaxed ) || ( allocation && s_captureTracking.load( std::memory_order_relaxed ) ) ) ) 
+		return r;
+	const uint64_t start = trace.m_start ? trace.m_start : traceNow();
+	std::lock_guard<std::mutex> lock( s_captureMutex );
+	if( s_capture.m_file ) 
+		std::apply( [start]( auto... a ) { captureRecord( Op(), start, a... ); }, call.m_args );
+	else if constexpr( allocation ) 
+		std::apply( []( auto... a ) { captureTrack( Op(), a... ); }, call.m_args );
+	return r;
+}
+} // namespace
+
+oroError oroCaptureBegin( const char* path, oroCaptureData data )
+{
+	std::lock_guard<std::mutex> lock( s_captureMutex );
+	if( s_capture.m_file )
 	{
-		((int*)this)[0] = src;
+		printf( "Orochi capture: already capturing\n" );
+		return oroErrorUnknown;
 	}
+	FILE* f = fopen( path, "wb" );
+	if( !f )
+	{
+		printf( "Orochi capture: can't write %s\n", path );
+		return oroErrorUnknown;
+	}
+	OroCapture::FileHeader header = {};
+	memcpy( header.magic, OroCapture::MAGIC, sizeof( header.magic ) );
+	header.version = OroCapture::VERSION;
+	header.api = getCurrentApi();
+	fwrite( &header, sizeof( header ), 1, f );
 
-	oroApi getApi() const { return (oroApi)m_api; }
-	void setApi(oroApi api) { m_api = api; }
-	int getDevice() const { return m_deviceIdx; }
-	void setDevice( int d ) { m_deviceIdx = d; }
+	s_capture.m_file = f;
+	s_capture.m_data = data;
+	s_capture.m_begin = traceNow();
+	s_capture.m_images.clear();
+
+	// the allocations made before, so the records using them are replayed. with ORO_CAPTURE_DATA_ALL, their content too.
+	// the copy isn't captured itself, s_capturing is still false.
+	std::vector<char> content;
+	for( const auto& a : s_capture.m_allocations )
+	{
+		capturePut( a.first );
+		capturePut( a.second );
+		captureWrite( OroCapture::MALLOC, 0, s_capture.m_begin );
+		if( data != ORO_CAPTURE_DATA_ALL ) 
+			continue;
+		content.resize( a.second );
+		if( oroMemcpyDtoH( content.data(), (oroDeviceptr)a.first, a.second ) == oroSuccess ) 
+			captureHtoD( s_capture.m_begin, a.first, content.data(), a.second, 0, false );
+		else
+			printf( "Orochi capture: can't read the allocation %llx made before the capture\n", (unsigned long long)a.first );
+	}
+	s_capturing = true;
+	return oroSuccess;
+}
+
+oroError oroCaptureEnd()
+{
+	std::lock_guard<std::mutex> lock( s_captureMutex );
+	if( !s_capture.m_file ) 
+		return oroErrorUnknown;
+	s_capturing = false;
+	const bool failed = ferror( s_capture.m_file ) != 0;
+	fclose( s_capture.m_file );
+	s_capture.m_file = nullptr;
+	// not tracked until the next capture, they would be stale.
+	if( !s_captureTracking ) 
+		s_capture.m_allocations.clear();
+	return failed ? oroErrorUnknown : oroSuccess;
+}
+
+bool oroCaptureEnabled() { return s_capturing.load( std::memory_order_relaxed ); }
+
+void oroCaptureTrackAllocations( bool enable )
+{
+	std::lock_guard<std::mutex> lock( s_captureMutex );
+	s_captureTracking = enable;
+	if( !enable && !s_capture.m_file ) 
+		s_capture.m_allocations.clear();
+}
+
+void oroCaptureSetKernelArgSizes( oroFunction f, int numArgs, const size_t* argSizes )
+{
+	std::lock_guard<std::mutex> lock( s_captureMutex );
+	s_capture.m_argSizes[captureHandle( f )].assign( argSizes, argSizes + numArgs );
+}
+
+// the storage of an oroDeviceSnapshot, which points in it.
+struct DeviceSnapshot
+{
+	oroDeviceSnapshot m_snapshot{};
+	oroU32 m_apis = 0;
+	std::vector<oroDevice> m_devices;
+	std::vector<oroDeviceProp> m_properties;
+	std::vector<std::string> m_archNames;
+	std::vector<const char*> m_archNamePtrs;
+	std::vector<unsigned char> m_peerAccess;
 };
+// the published snapshot. the replaced ones are kept in s_snapshots, as callers can hold pointers in them. guarded by mtx.
+static std::atomic<const DeviceSnapshot*> s_snapshot( nullptr );
+static std::vector<std::unique_ptr<DeviceSnapshot>> s_snapshots;
 
 inline 
 oroApi getRawDeviceIndex( int& deviceId ) 
 {
-	int n[2] = { 0, 0 };
-	oroGetDeviceCount( &n[0], ORO_API_HIP );
-	oroGetDeviceCount( &n[1], ORO_API_CUDADRIVER );
+	int n[3] = { 0, 0, 0 };
+	if( const DeviceSnapshot* snapshot = s_snapshot.load( std::memory_order_acquire ) )
+	{
+		n[0] = snapshot->m_snapshot.numHipDevices;
+		n[1] = snapshot->m_snapshot.numCudaDevices;
+		n[2] = snapshot->m_snapshot.numHostDevices;
+	}
+	else
+	{
+		oroGetDeviceCount( &n[0], ORO_API_HIP );
+		oroGetDeviceCount( &n[1], ORO_API_CUDADRIVER );
+		oroGetDeviceCount( &n[2], ORO_API_HOST );
+	}
 
-	if ( n[0] == 0 && n[1] == 0 )
+	if ( n[0] == 0 && n[1] == 0 && n[2] == 0 )
 		return (oroApi)0;
 
-	oroApi api = (deviceId < n[0]) ? (ORO_API_HIP) : (ORO_API_CUDADRIVER);
-	if( api & ORO_API_CUDADRIVER )
-		deviceId -= n[0];
-	return api;
+	if( deviceId < n[0] )
+		return ORO_API_HIP;
+	deviceId -= n[0];
+	if( deviceId < n[1] )
+		return ORO_API_CUDADRIVER;
+	deviceId -= n[1];
+	return ORO_API_HOST;
 }
 
 // description in the header
@@ -840,9 +3348,34 @@ int oroInitialize( oroApi api, oroU32 flags,
 	const char** customPaths_NvRTC
 	)
 {
-	s_api = api;
+	s_defaultApi = api;
 	int e = 0;
+	if( const char* trace = getenv( "ORO_TRACE" ) )
+	{
+		static std::once_flag traceOnce;
+		std::call_once( traceOnce, [trace]() {
+			oroTraceEnable( true );
+			if( strcmp( trace, "1" ) != 0 && trace[0] != '\0' )
+			{
+				s_traceExitPath = trace;
+				atexit( traceAtExit );
+			}
+		} );
+	}
+	if( const char* capture = getenv( "ORO_CAPTURE" ) )
+	{
+		static std::once_flag captureOnce;
+		std::call_once( captureOnce, [capture]() {
+			const char* data = getenv( "ORO_CAPTURE_DATA" );
+			oroCaptureData d = ORO_CAPTURE_DATA_NONE;
+			if( data && strcmp( data, "hash" ) == 0 ) d = ORO_CAPTURE_DATA_HASH;
+			if( data && strcmp( data, "all" ) == 0 ) d = ORO_CAPTURE_DATA_ALL;
+			if( oroCaptureBegin( capture, d ) == oroSuccess )
+				atexit( []() { oroCaptureEnd(); } );
+		} );
+	}
 	s_loadedApis = 0;
+	s_deferredApis = 0;
 
 	if( api & ORO_API_CUDA )
 	{
@@ -856,6 +3389,10 @@ int oroInitialize( oroApi api, oroU32 flags,
 		{
 			flag |= CU4ORO::CUEW_INIT_NVRTC;
 		}
+		if( flags & ORO_INIT_EAGER )
+		{
+			flag |= CU4ORO::CUEW_INIT_EAGER;
+		}
 		
 		int resultDriver, resultRtc;
 		CU4ORO::cuewInit( &resultDriver, &resultRtc, flag, customPaths_Cuda, customPaths_CudaRT, customPaths_NvRTC);
@@ -868,6 +3405,11 @@ int oroInitialize( oroApi api, oroU32 flags,
 		{
 			s_loadedApis |= ORO_API_CUDARTC;
 		}
+		if( resultRtc == CU4ORO::CUEW_DEFERRED )
+		{
+			s_loadedApis |= ORO_API_CUDARTC;
+			s_deferredApis |= ORO_API_CUDARTC;
+		}
 		#endif
 	}
 	if( api & ORO_API_HIP )
@@ -881,6 +3423,10 @@ int oroInitialize( oroApi api, oroU32 flags,
 		{
 			flag |= HIPEW_INIT_HIPRTC;
 		}
+		if( flags & ORO_INIT_EAGER )
+		{
+			flag |= HIPEW_INIT_EAGER;
+		}
 
 		int resultDriver, resultRtc;
 		hipewInit( &resultDriver, &resultRtc, flag, customPaths_Hip, customPaths_Hiprtc );
@@ -893,18 +3439,50 @@ int oroInitialize( oroApi api, oroU32 flags,
 		{
 			s_loadedApis |= ORO_API_HIPRTC;
 		}
+		if( resultRtc == HIPEW_DEFERRED )
+		{
+			s_loadedApis |= ORO_API_HIPRTC;
+			s_deferredApis |= ORO_API_HIPRTC;
+		}
+	}
+	// nothing to load: the host backend is in Orochi.
+	if( api & ORO_API_HOST )
+	{
+		s_loadedApis |= ORO_API_HOST;
 	}
 	if( s_loadedApis == 0 )
 		return ORO_ERROR_OPEN_FAILED;
 	return ORO_SUCCESS;
 }
+// the deferred runtime compilers which are not loaded yet ( status > 0 ), and the ones which failed to load ( status < 0 ).
+static oroU32 getDeferredApis( bool failed )
+{
+	oroU32 apis = 0;
+	if( s_deferredApis & ORO_API_HIPRTC )
+	{
+		const int status = hipewRtcStatus();
+		if( failed ? status < 0 : status == HIPEW_DEFERRED ) apis |= ORO_API_HIPRTC;
+	}
+#ifdef OROCHI_ENABLE_CUEW
+	if( s_deferredApis & ORO_API_CUDARTC )
+	{
+		const int status = CU4ORO::cuewNvrtcStatus();
+		if( failed ? status < 0 : status == CU4ORO::CUEW_DEFERRED ) apis |= ORO_API_CUDARTC;
+	}
+#endif
+	return apis;
+}
 oroApi oroLoadedAPI() 
 {
-	return (oroApi)s_loadedApis;
+	return (oroApi)( s_loadedApis & ~getDeferredApis( true ) );
+}
+oroApi oroDeferredAPI()
+{
+	return (oroApi)getDeferredApis( false );
 }
 oroApi oroGetCurAPI(oroU32 flags)
 {
-	return s_api;
+	return getCurrentApi();
 }
 
 void* oroGetRawCtx( oroCtx ctx ) 
@@ -920,12 +3498,25 @@ oroError oroCtxCreateFromRaw( oroCtx* ctxOut, oroApi api, void* ctxIn )
 	c->m_ptr = ctxIn;
 	c->setApi( api );
 	*ctxOut = c;
+	{
+		std::lock_guard<std::mutex> lock( mtx );
+		s_oroCtxs.emplace( ctxIn, c );
+	}
 	return oroSuccess;
 }
 
 oroError oroCtxCreateFromRawDestroy( oroCtx ctx ) 
 {
 	ioroCtx_t* c = (ioroCtx_t*)ctx;
+	{
+		std::lock_guard<std::mutex> lock( mtx );
+		auto it = s_oroCtxs.find( c->m_ptr );
+		if( it != s_oroCtxs.end() && it->second == c ) 
+			s_oroCtxs.erase( it );
+	}
+	s_ctxDestroyed.fetch_add( 1, std::memory_order_release );
+	if( s_ctx == c ) 
+		s_ctxKnown = false;
 	delete c;
 	return oroSuccess;
 }
@@ -997,12 +3588,31 @@ inline hipCtx_t* oroCtx2hip( oroCtx* a )
 
 
 
+// the host backend calls the HIP function of the same name in HostApi: the call of the wrapper is made on an object of HostApi.
+// the wrappers of the functions HostApi doesn't have return hipErrorNotSupported, see hostCall.
+#define __ORO_HOST_CALL( hipname ) \
+	hostCall<decltype( hip2oro( hipname ) )>( [&]( auto __oroHost ) -> decltype( hip2oro( __oroHost.hipname ) ) { return hip2oro( __oroHost.hipname ); }, 0 )
+
+// each call site registers once, see TraceScope.
 #ifdef OROCHI_ENABLE_CUEW
-#define __ORO_FUNCX( API, cuname, hipname ) if( API & ORO_API_CUDADRIVER ) return cu2oro( cuname ); if( API == ORO_API_HIP ) return hip2oro( hipname );
-#define __ORO_FUNC(cuname,hipname) if( s_api & ORO_API_CUDADRIVER ) return cu2oro(cuname); if( s_api == ORO_API_HIP ) return hip2oro(hipname);
+#define __ORO_FUNCX( API, cuname, hipname ) \
+	{ \
+		static const int __oroTraceId = traceRegister( __func__, #hipname ); \
+		TraceScope __oroTrace( __oroTraceId ); \
+		if( API & ORO_API_CUDADRIVER ) return __oroTrace.end( cu2oro( cuname ) ); \
+		if( API == ORO_API_HIP ) return __oroTrace.end( hip2oro( hipname ) ); \
+		if( API == ORO_API_HOST ) return __oroTrace.end( __ORO_HOST_CALL( hipname ) ); \
+	}
+#define __ORO_FUNC(cuname,hipname) __ORO_FUNCX( getCurrentApi(), cuname, hipname )
 #else
-#define __ORO_FUNCX( API, cuname, hipname )  if( API == ORO_API_HIP ) return hip2oro( hipname );
-#define __ORO_FUNC(cuname,hipname)  if( s_api == ORO_API_HIP ) return hip2oro(hipname);
+#define __ORO_FUNCX( API, cuname, hipname ) \
+	{ \
+		static const int __oroTraceId = traceRegister( __func__, #hipname ); \
+		TraceScope __oroTrace( __oroTraceId ); \
+		if( API == ORO_API_HIP ) return __oroTrace.end( hip2oro( hipname ) ); \
+		if( API == ORO_API_HOST ) return __oroTrace.end( __ORO_HOST_CALL( hipname ) ); \
+	}
+#define __ORO_FUNC(cuname,hipname)  __ORO_FUNCX( getCurrentApi(), cuname, hipname )
 #endif
 
 #define __ORO_FORCE_CAST(type,var)     *((type*)(&var))
@@ -1012,12 +3622,17 @@ inline hipCtx_t* oroCtx2hip( oroCtx* a )
 
 oroError OROAPI oroGetErrorString( oroError error, const char** pStr )
 {
-	if( s_api & ORO_API_CUDADRIVER ) 
+	if( getCurrentApi() & ORO_API_CUDADRIVER ) 
 	{
 		#ifdef OROCHI_ENABLE_CUEW
 		return cu2oro(CU4ORO::cuGetErrorString( (CU4ORO::CUresult)error, pStr ));
 		#endif
 	}
+	else if( getCurrentApi() == ORO_API_HOST )
+	{
+		*pStr = HostApi::hipGetErrorString( (hipError_t)error );
+		return oroSuccess;
+	}
 	else
 	{
 		*pStr = hipGetErrorString( (hipError_t)error );
@@ -1026,10 +3641,13 @@ oroError OROAPI oroGetErrorString( oroError error, const char** pStr )
 	return oroErrorUnknown;
 }
 
+static void buildDeviceSnapshot();
+
 oroError OROAPI oroInit(unsigned int Flags)
 {
 	oroU32 e0 = 0;
 	oroU32 e1 = 0;
+	oroU32 e2 = 0;
 	if( s_loadedApis & ORO_API_HIP )
 	{
 		e0 = hip2oro( hipInit( Flags ) );
@@ -1040,7 +3658,14 @@ oroError OROAPI oroInit(unsigned int Flags)
 		e1 = cu2oro( CU4ORO::cuInit( Flags ) );
 		#endif
 	}
-	return ( e0 == 0 || e1 == 0 ) ? oroSuccess : oroErrorUnknown;
+	if( s_loadedApis & ORO_API_HOST )
+	{
+		e2 = hip2oro( HostApi::hipInit( Flags ) );
+	}
+	if( e0 != 0 && e1 != 0 && e2 != 0 )
+		return oroErrorUnknown;
+	buildDeviceSnapshot();
+	return oroSuccess;
 }
 
 
@@ -1048,7 +3673,7 @@ oroError OROAPI oroGetDeviceCount(int* count, oroApi iapi)
 {
 	oroU32 api = 0;
 	if( iapi == ORO_API_AUTOMATIC )
-		api = (ORO_API_HIP|ORO_API_CUDADRIVER);
+		api = (ORO_API_HIP|ORO_API_CUDADRIVER|ORO_API_HOST);
 	else
 		api = iapi;
 
@@ -1071,6 +3696,13 @@ oroError OROAPI oroGetDeviceCount(int* count, oroApi iapi)
 			*count += c;
 		#endif
 	}
+	if( (api & s_loadedApis) & ORO_API_HOST )
+	{
+		int c = 0;
+		e = hip2oro(HostApi::hipGetDeviceCount(&c));
+		if( e == 0 )
+			*count += c;
+	}
 	return oroSuccess;
 }
 
@@ -1084,6 +3716,8 @@ oroError OROAPI oroGetDeviceProperties(oroDeviceProp_t* props, oroDevice dev)
 	*props = {};
 	if( api == ORO_API_HIP )
 		return hip2oro(hipGetDeviceProperties(props, deviceId));
+	if( api == ORO_API_HOST )
+		return hip2oro(HostApi::hipGetDeviceProperties(props, deviceId));
 	if( api & ORO_API_CUDADRIVER )
 	{
 		#ifdef OROCHI_ENABLE_CUEW
@@ -1094,6 +3728,141 @@ oroError OROAPI oroGetDeviceProperties(oroDeviceProp_t* props, oroDevice dev)
 }
 
 
+// queries the devices of the loaded APIs and publishes the snapshot, once per set of loaded APIs.
+static void buildDeviceSnapshot()
+{
+	const oroU32 apis = s_loadedApis & ( ORO_API_HIP | ORO_API_CUDADRIVER | ORO_API_HOST );
+	std::lock_guard<std::mutex> lock( mtx );
+	const DeviceSnapshot* current = s_snapshot.load( std::memory_order_relaxed );
+	if( current && current->m_apis == apis )
+		return;
+
+	std::unique_ptr<DeviceSnapshot> snapshot( new DeviceSnapshot );
+	snapshot->m_apis = apis;
+	oroDeviceSnapshot& s = snapshot->m_snapshot;
+	if( apis & ORO_API_HIP )
+	{
+		if( hipGetDeviceCount( &s.numHipDevices ) != hipSuccess ) s.numHipDevices = 0;
+		hipDriverGetVersion( &s.hipDriverVersion );
+		hipRuntimeGetVersion( &s.hipRuntimeVersion );
+	}
+	if( apis & ORO_API_CUDADRIVER )
+	{
+		#ifdef OROCHI_ENABLE_CUEW
+		if( CU4ORO::cuDeviceGetCount( &s.numCudaDevices ) != CU4ORO::CUDA_SUCCESS ) s.numCudaDevices = 0;
+		CU4ORO::hipDriverGetVersion_cu4oro( &s.cudaDriverVersion );
+		CU4ORO::hipRuntimeGetVersion_cu4oro( &s.cudaRuntimeVersion );
+		#endif
+	}
+	if( apis & ORO_API_HOST )
+	{
+		if( HostApi::hipGetDeviceCount( &s.numHostDevices ) != hipSuccess ) s.numHostDevices = 0;
+	}
+	const int n = s.numHipDevices + s.numCudaDevices + s.numHostDevices;
+	s.numDevices = n;
+
+	snapshot->m_devices.resize( n );
+	snapshot->m_properties.resize( n );
+	snapshot->m_archNames.resize( n );
+	snapshot->m_archNamePtrs.resize( n );
+	snapshot->m_peerAccess.assign( (size_t)n * n, 0 );
+	for( int i = 0; i < n; i++ )
+	{
+		ioroDevice d;
+		if( i < s.numHipDevices )
+		{
+			d.setApi( ORO_API_HIP );
+			d.setDevice( i );
+		}
+		else if( i < s.numHipDevices + s.numCudaDevices )
+		{
+			d.setApi( ORO_API_CUDADRIVER );
+			d.setDevice( i - s.numHipDevices );
+		}
+		else
+		{
+			d.setApi( ORO_API_HOST );
+			d.setDevice( i - s.numHipDevices - s.numCudaDevices );
+		}
+		snapshot->m_devices[i] = *(oroDevice*)&d;
+
+		oroDeviceProp& props = snapshot->m_properties[i];
+		oroGetDeviceProperties( &props, snapshot->m_devices[i] );
+		std::string arch = props.gcnArchName;
+		if( arch.empty() )
+			arch = std::string( props.name ) + ".sm_" + std::to_string( props.major ) + std::to_string( props.minor );
+		snapshot->m_archNames[i] = arch;
+		snapshot->m_archNamePtrs[i] = snapshot->m_archNames[i].c_str();
+	}
+	for( int i = 0; i < n; i++ )
+	{
+		for( int j = 0; j < n; j++ )
+		{
+			const bool hip = i < s.numHipDevices;
+			const int host = s.numHipDevices + s.numCudaDevices;
+			// the host device has no peer.
+			if( i == j || hip != ( j < s.numHipDevices ) || i >= host || j >= host )
+				continue;
+			int canAccess = 0;
+			if( hip )
+				hipDeviceCanAccessPeer( &canAccess, i, j );
+			else
+			{
+				#ifdef OROCHI_ENABLE_CUEW
+				CU4ORO::hipDeviceCanAccessPeer_cu4oro( &canAccess, i - s.numHipDevices, j - s.numHipDevices );
+				#endif
+			}
+			snapshot->m_peerAccess[(size_t)i * n + j] = canAccess != 0;
+		}
+	}
+	s.devices = snapshot->m_devices.data();
+	s.properties = snapshot->m_properties.data();
+	s.archNames = snapshot->m_archNamePtrs.data();
+	s.peerAccess = snapshot->m_peerAccess.data();
+
+	s_snapshot.store( snapshot.get(), std::memory_order_release );
+	s_snapshots.push_back( std::move( snapshot ) );
+}
+
+const oroDeviceSnapshot* oroGetDeviceSnapshot()
+{
+	const DeviceSnapshot* snapshot = s_snapshot.load( std::memory_order_acquire );
+	return snapshot ? &snapshot->m_snapshot : nullptr;
+}
+
+static int getSnapshotOrdinal( const oroDeviceSnapshot* s, oroDevice dev )
+{
+	if( !s ) 
+		return -1;
+	ioroDevice d( dev );
+	if( d.getApi() == ORO_API_HIP )
+		return d.getDevice() < s->numHipDevices ? d.getDevice() : -1;
+	if( d.getApi() & ORO_API_CUDADRIVER )
+		return d.getDevice() < s->numCudaDevices ? s->numHipDevices + d.getDevice() : -1;
+	if( d.getApi() == ORO_API_HOST )
+		return d.getDevice() < s->numHostDevices ? s->numHipDevices + s->numCudaDevices + d.getDevice() : -1;
+	return -1;
+}
+
+int oroDeviceGetOrdinal( oroDevice dev )
+{
+	return getSnapshotOrdinal( oroGetDeviceSnapshot(), dev );
+}
+
+const oroDeviceProp* oroDeviceGetSnapshotProperties( oroDevice dev )
+{
+	const oroDeviceSnapshot* s = oroGetDeviceSnapshot();
+	const int i = getSnapshotOrdinal( s, dev );
+	return ( i < 0 ) ? nullptr : &s->properties[i];
+}
+
+const char* oroDeviceGetArchName( oroDevice dev )
+{
+	const oroDeviceSnapshot* s = oroGetDeviceSnapshot();
+	const int i = getSnapshotOrdinal( s, dev );
+	return ( i < 0 ) ? nullptr : s->archNames[i];
+}
+
 oroError OROAPI oroDeviceGet(oroDevice* device, int ordinal )
 {
 	oroApi api = getRawDeviceIndex( ordinal );
@@ -1119,6 +3888,15 @@ oroError OROAPI oroDeviceGet(oroDevice* device, int ordinal )
 		return cu2oro(e);
 		#endif
 	}
+	if (api == ORO_API_HOST)
+	{
+		int t;
+		auto e = HostApi::hipDeviceGet(&t, ordinal);
+		d.setApi( api );
+		d.setDevice( t );
+		*(ioroDevice*)device = d;
+		return hip2oro(e);
+	}
 	return oroErrorUnknown;
 }
 
@@ -1145,6 +3923,7 @@ oroError OROAPI oroDeviceGetAttribute(int* pi, oroDeviceAttribute_t attrib, oroD
 
 oroError OROAPI oroCtxCreate(oroCtx* pctx, unsigned int flags, oroDevice dev)
 {
+	const uint32_t generation = s_ctxDestroyed.load( std::memory_order_acquire );
 	ioroDevice d( dev );
 	ioroCtx_t* ctxt = new ioroCtx_t;
 	ctxt->setApi( d.getApi() );
@@ -1164,24 +3943,46 @@ oroError OROAPI oroCtxCreate(oroCtx* pctx, unsigned int flags, oroDevice dev)
 		if ( e != hipSuccess )
 			return hip2oro(e);
 	}
-	std::lock_guard<std::mutex> lock( mtx );
-	s_oroCtxs[ctxt->m_ptr] = ctxt;
+	if( s_api == ORO_API_HOST ) 
+	{
+		hipError_t e = HostApi::hipCtxCreate( oroCtx2hip( pctx ), flags, d.getDevice() );
+		if ( e != hipSuccess )
+			return hip2oro(e);
+	}
+	{
+		std::lock_guard<std::mutex> lock( mtx );
+		s_oroCtxs[ctxt->m_ptr] = ctxt;
+	}
+	// the created context is current for the calling thread.
+	cacheCurrentCtx( ctxt, true, generation );
 	return oroSuccess;
 }
 
 oroError OROAPI oroCtxDestroy(oroCtx ctx)
 {
-	std::lock_guard<std::mutex> lock( mtx );
-	s_oroCtxs.erase( ctx->m_ptr );
+	{
+		std::lock_guard<std::mutex> lock( mtx );
+		s_oroCtxs.erase( ctx->m_ptr );
+	}
+	// the threads having it current find it stale: oroCtxGetCurrent asks the driver again, and doesn't find its wrapper anymore.
+	s_ctxDestroyed.fetch_add( 1, std::memory_order_release );
+	if( s_ctx == ctx ) 
+	{
+		s_ctx = nullptr;
+		s_ctxKnown = false;
+		s_api = (oroApi)0;
+	}
 
+	// the context may belong to an other API than the current one of this thread.
 	int e = 0;
-	if( s_api & ORO_API_CUDADRIVER )
+	if( ctx->getApi() & ORO_API_CUDADRIVER )
 	{
 		#ifdef OROCHI_ENABLE_CUEW
 		e = CU4ORO::cuCtxDestroy( *oroCtx2cu( &ctx ) );
 		#endif
 	}
-	if( s_api == ORO_API_HIP ) e = hipCtxDestroy( *oroCtx2hip( &ctx ) );
+	if( ctx->getApi() == ORO_API_HIP ) e = hipCtxDestroy( *oroCtx2hip( &ctx ) );
+	if( ctx->getApi() == ORO_API_HOST ) e = HostApi::hipCtxDestroy( *oroCtx2hip( &ctx ) );
 
 	if( e )
 		return oroErrorUnknown;
@@ -1194,39 +3995,76 @@ oroError OROAPI oroCtxDestroy(oroCtx ctx)
 
 oroError OROAPI oroCtxSetCurrent(oroCtx ctx)
 {
+	const uint32_t generation = s_ctxDestroyed.load( std::memory_order_acquire );
 	s_api = ctx->getApi();
-	__ORO_FUNC(
-		CU4ORO::hipCtxSetCurrent_cu4oro( *oroCtx2cu(&ctx) ),
-				hipCtxSetCurrent( *oroCtx2hip(&ctx) )  );
-	return oroErrorUnknown;
+	oroError e = oroErrorUnknown;
+	if( s_api & ORO_API_CUDADRIVER )
+	{
+		#ifdef OROCHI_ENABLE_CUEW
+		e = cu2oro( CU4ORO::hipCtxSetCurrent_cu4oro( *oroCtx2cu( &ctx ) ) );
+		#endif
+	}
+	if( s_api == ORO_API_HIP ) 
+		e = hip2oro( hipCtxSetCurrent( *oroCtx2hip( &ctx ) ) );
+	if( s_api == ORO_API_HOST ) 
+		e = hip2oro( HostApi::hipCtxSetCurrent( *oroCtx2hip( &ctx ) ) );
+
+	cacheCurrentCtx( ctx, e == oroSuccess, generation );
+	return e;
 }
 
 oroError OROAPI oroCtxGetCurrent(oroCtx* pctx)
 {
-	ioroCtx_t* ctxt = new ioroCtx_t;
+	const uint32_t generation = s_ctxDestroyed.load( std::memory_order_acquire );
+	if( s_ctxKnown && s_ctxGeneration == generation ) 
+	{
+		( *pctx ) = s_ctx;
+		return oroSuccess;
+	}
 
-	if( s_api & ORO_API_CUDADRIVER ) 
+	// the first call of a thread which didn't set a context: the driver gives the raw context, mapped to its wrapper.
+	ioroCtx_t ctxt;
+	ioroCtx_t* pctxt = &ctxt;
+	const oroApi api = getCurrentApi();
+
+	if( api & ORO_API_CUDADRIVER ) 
 	{
 		#ifdef OROCHI_ENABLE_CUEW
-		CU4ORO::CUresult e = CU4ORO::cuCtxGetCurrent( oroCtx2cu( &ctxt ) );
+		CU4ORO::CUresult e = CU4ORO::cuCtxGetCurrent( oroCtx2cu( &pctxt ) );
 		if ( e != CU4ORO::CUDA_SUCCESS )
 			return cu2oro(e);
 		#endif
 	}
-	if( s_api == ORO_API_HIP ) 
+	if( api == ORO_API_HIP ) 
+	{
+		hipError_t e = hipCtxGetCurrent( oroCtx2hip( &pctxt ) );
+		if ( e != hipSuccess )
+			return hip2oro(e);
+	}
+	if( api == ORO_API_HOST ) 
 	{
-		hipError_t e = hipCtxGetCurrent( oroCtx2hip( &ctxt ) );
+		hipError_t e = HostApi::hipCtxGetCurrent( oroCtx2hip( &pctxt ) );
 		if ( e != hipSuccess )
 			return hip2oro(e);
 	}
-	( *pctx ) = s_oroCtxs[ctxt->m_ptr];
-	delete ctxt;
+	oroCtx c = nullptr;
+	{
+		std::lock_guard<std::mutex> lock( mtx );
+		auto it = s_oroCtxs.find( ctxt.m_ptr );
+		if( it != s_oroCtxs.end() ) 
+			c = it->second;
+	}
+	// a context without wrapper is not cached, it can be adopted by oroCtxCreateFromRaw later.
+	cacheCurrentCtx( c, c != nullptr, generation );
+	if( c ) 
+		s_api = c->getApi();
+	( *pctx ) = c;
 	return oroSuccess;
 }
 
 oroError OROAPI oroCtxGetApiVersion(oroCtx ctx, int* version)
 {
-	__ORO_FUNC(
+	__ORO_FUNCX( ctx->getApi(),
 	CU4ORO::hipCtxGetApiVersion_cu4oro(*oroCtx2cu(&ctx),  version ),
 			hipCtxGetApiVersion(*oroCtx2hip(&ctx), version )  );
 	return oroErrorUnknown;
@@ -1237,15 +4075,18 @@ oroError OROAPI oroCtxGetApiVersion(oroCtx ctx, int* version)
 // function can't be automatically generated because returning a structure.
 oroChannelFormatDesc OROAPI oroCreateChannelDesc(int x, int y, int z, int w,  oroChannelFormatKind f)
 {
-	 if( s_api & ORO_API_CUDADRIVER )
+	 const oroApi api = getCurrentApi();
+	 if( api & ORO_API_CUDADRIVER )
 	 {
 		#ifdef OROCHI_ENABLE_CUEW
 		CU4ORO::hipChannelFormatDesc ret = CU4ORO::hipCreateChannelDesc_cu4oro(__ORO_FORCE_CAST(int,x), __ORO_FORCE_CAST(int,y), __ORO_FORCE_CAST(int,z), __ORO_FORCE_CAST(int,w), __ORO_FORCE_CAST(CU4ORO::hipChannelFormatKind,f));
 		return __ORO_FORCE_CAST(oroChannelFormatDesc, ret);
 		#endif
 	 }
-	 if( s_api == ORO_API_HIP ) 
+	 if( api == ORO_API_HIP ) 
 		 return hipCreateChannelDesc(x, y, z, w, f);
+	 if( api == ORO_API_HOST ) 
+		 return { x, y, z, w, f };
 
 	return oroChannelFormatDesc();
 }
@@ -1269,6 +4110,74 @@ orortcResult OROAPI orortcGetBitcodeSize(orortcProgram prog, size_t* bitcodeSize
 
 
 
+// the captured functions of the region, see captureArgs. a macro isn't expanded in its own replacement, so the replacement calls the function.
+// the call stays a call of name, so the CUDA wrappers call it as CU4ORO::name and the host ones as a function of HostApi.
+#define ORO_CAPTURE( op, name, ... ) name( __VA_ARGS__ ) << captureArgs<op>( __oroTrace, __VA_ARGS__ )
+#define hipMalloc( ... ) ORO_CAPTURE( CaptureMalloc, hipMalloc, __VA_ARGS__ )
+#define hipMalloc_cu4oro( ... ) ORO_CAPTURE( CaptureMalloc, hipMalloc_cu4oro, __VA_ARGS__ )
+#define hipFree( ... ) ORO_CAPTURE( CaptureFree, hipFree, __VA_ARGS__ )
+#define hipFree_cu4oro( ... ) ORO_CAPTURE( CaptureFree, hipFree_cu4oro, __VA_ARGS__ )
+#define hipMemcpy( ... ) ORO_CAPTURE( CaptureMemcpy, hipMemcpy, __VA_ARGS__ )
+#define hipMemcpy_cu4oro( ... ) ORO_CAPTURE( CaptureMemcpy, hipMemcpy_cu4oro, __VA_ARGS__ )
+#define hipMemcpyAsync( ... ) ORO_CAPTURE( CaptureMemcpy, hipMemcpyAsync, __VA_ARGS__ )
+#define hipMemcpyAsync_cu4oro( ... ) ORO_CAPTURE( CaptureMemcpy, hipMemcpyAsync_cu4oro, __VA_ARGS__ )
+#define hipMemcpyHtoD( ... ) ORO_CAPTURE( CaptureMemcpyHtoD, hipMemcpyHtoD, __VA_ARGS__ )
+#define hipMemcpyHtoD_cu4oro( ... ) ORO_CAPTURE( CaptureMemcpyHtoD, hipMemcpyHtoD_cu4oro, __VA_ARGS__ )
+#define hipMemcpyHtoDAsync( ... ) ORO_CAPTURE( CaptureMemcpyHtoD, hipMemcpyHtoDAsync, __VA_ARGS__ )
+#define hipMemcpyHtoDAsync_cu4oro( ... ) ORO_CAPTURE( CaptureMemcpyHtoD, hipMemcpyHtoDAsync_cu4oro, __VA_ARGS__ )
+#define hipMemcpyDtoH( ... ) ORO_CAPTURE( CaptureMemcpyDtoH, hipMemcpyDtoH, __VA_ARGS__ )
+#define hipMemcpyDtoH_cu4oro( ... ) ORO_CAPTURE( CaptureMemcpyDtoH, hipMemcpyDtoH_cu4oro, __VA_ARGS__ )
+#define hipMemcpyDtoHAsync( ... ) ORO_CAPTURE( CaptureMemcpyDtoH, hipMemcpyDtoHAsync, __VA_ARGS__ )
+#define hipMemcpyDtoHAsync_cu4oro( ... ) ORO_CAPTURE( CaptureMemcpyDtoH, hipMemcpyDtoHAsync_cu4oro, __VA_ARGS__ )
+#define hipMemcpyDtoD( ... ) ORO_CAPTURE( CaptureMemcpyDtoD, hipMemcpyDtoD, __VA_ARGS__ )
+#define hipMemcpyDtoD_cu4oro( ... ) ORO_CAPTURE( CaptureMemcpyDtoD, hipMemcpyDtoD_cu4oro, __VA_ARGS__ )
+#define hipMemcpyDtoDAsync( ... ) ORO_CAPTURE( CaptureMemcpyDtoD, hipMemcpyDtoDAsync, __VA_ARGS__ )
+#define hipMemcpyDtoDAsync_cu4oro( ... ) ORO_CAPTURE( CaptureMemcpyDtoD, hipMemcpyDtoDAsync_cu4oro, __VA_ARGS__ )
+#define hipMemset( ... ) ORO_CAPTURE( CaptureMemset8, hipMemset, __VA_ARGS__ )
+#define hipMemset_cu4oro( ... ) ORO_CAPTURE( CaptureMemset8, hipMemset_cu4oro, __VA_ARGS__ )
+#define hipMemsetAsync( ... ) ORO_CAPTURE( CaptureMemset8, hipMemsetAsync, __VA_ARGS__ )
+#define hipMemsetAsync_cu4oro( ... ) ORO_CAPTURE( CaptureMemset8, hipMemsetAsync_cu4oro, __VA_ARGS__ )
+#define hipMemsetD8( ... ) ORO_CAPTURE( CaptureMemset8, hipMemsetD8, __VA_ARGS__ )
+#define hipMemsetD8_cu4oro( ... ) ORO_CAPTURE( CaptureMemset8, hipMemsetD8_cu4oro, __VA_ARGS__ )
+#define hipMemsetD8Async( ... ) ORO_CAPTURE( CaptureMemset8, hipMemsetD8Async, __VA_ARGS__ )
+#define hipMemsetD8Async_cu4oro( ... ) ORO_CAPTURE( CaptureMemset8, hipMemsetD8Async_cu4oro, __VA_ARGS__ )
+#define hipMemsetD32( ... ) ORO_CAPTURE( CaptureMemset32, hipMemsetD32, __VA_ARGS__ )
+#define hipMemsetD32_cu4oro( ... ) ORO_CAPTURE( CaptureMemset32, hipMemsetD32_cu4oro, __VA_ARGS__ )
+#define hipMemsetD32Async( ... ) ORO_CAPTURE( CaptureMemset32, hipMemsetD32Async, __VA_ARGS__ )
+#define hipMemsetD32Async_cu4oro( ... ) ORO_CAPTURE( CaptureMemset32, hipMemsetD32Async_cu4oro, __VA_ARGS__ )
+#define hipModuleLoadData( ... ) ORO_CAPTURE( CaptureModuleLoad, hipModuleLoadData, __VA_ARGS__ )
+#define hipModuleLoadData_cu4oro( ... ) ORO_CAPTURE( CaptureModuleLoad, hipModuleLoadData_cu4oro, __VA_ARGS__ )
+#define hipModuleLoadDataEx( ... ) ORO_CAPTURE( CaptureModuleLoad, hipModuleLoadDataEx, __VA_ARGS__ )
+#define hipModuleLoadDataEx_cu4oro( ... ) ORO_CAPTURE( CaptureModuleLoad, hipModuleLoadDataEx_cu4oro, __VA_ARGS__ )
+#define hipModuleGetFunction( ... ) ORO_CAPTURE( CaptureModuleGetFunction, hipModuleGetFunction, __VA_ARGS__ )
+#define hipModuleGetFunction_cu4oro( ... ) ORO_CAPTURE( CaptureModuleGetFunction, hipModuleGetFunction_cu4oro, __VA_ARGS__ )
+#define hipModuleUnload( ... ) ORO_CAPTURE( CaptureModuleUnload, hipModuleUnload, __VA_ARGS__ )
+#define hipModuleUnload_cu4oro( ... ) ORO_CAPTURE( CaptureModuleUnload, hipModuleUnload_cu4oro, __VA_ARGS__ )
+#define hipModuleLaunchKernel( ... ) ORO_CAPTURE( CaptureLaunch, hipModuleLaunchKernel, __VA_ARGS__ )
+#define hipModuleLaunchKernel_cu4oro( ... ) ORO_CAPTURE( CaptureLaunch, hipModuleLaunchKernel_cu4oro, __VA_ARGS__ )
+#define hipStreamCreate( ... ) ORO_CAPTURE( CaptureStreamCreate, hipStreamCreate, __VA_ARGS__ )
+#define hipStreamCreate_cu4oro( ... ) ORO_CAPTURE( CaptureStreamCreate, hipStreamCreate_cu4oro, __VA_ARGS__ )
+#define hipStreamCreateWithFlags( ... ) ORO_CAPTURE( CaptureStreamCreate, hipStreamCreateWithFlags, __VA_ARGS__ )
+#define hipStreamCreateWithFlags_cu4oro( ... ) ORO_CAPTURE( CaptureStreamCreate, hipStreamCreateWithFlags_cu4oro, __VA_ARGS__ )
+#define hipStreamDestroy( ... ) ORO_CAPTURE( CaptureStreamDestroy, hipStreamDestroy, __VA_ARGS__ )
+#define hipStreamDestroy_cu4oro( ... ) ORO_CAPTURE( CaptureStreamDestroy, hipStreamDestroy_cu4oro, __VA_ARGS__ )
+#define hipStreamSynchronize( ... ) ORO_CAPTURE( CaptureStreamSynchronize, hipStreamSynchronize, __VA_ARGS__ )
+#define hipStreamSynchronize_cu4oro( ... ) ORO_CAPTURE( CaptureStreamSynchronize, hipStreamSynchronize_cu4oro, __VA_ARGS__ )
+#define hipEventCreate( ... ) ORO_CAPTURE( CaptureEventCreate, hipEventCreate, __VA_ARGS__ )
+#define hipEventCreate_cu4oro( ... ) ORO_CAPTURE( CaptureEventCreate, hipEventCreate_cu4oro, __VA_ARGS__ )
+#define hipEventCreateWithFlags( ... ) ORO_CAPTURE( CaptureEventCreate, hipEventCreateWithFlags, __VA_ARGS__ )
+#define hipEventCreateWithFlags_cu4oro( ... ) ORO_CAPTURE( CaptureEventCreate, hipEventCreateWithFlags_cu4oro, __VA_ARGS__ )
+#define hipEventDestroy( ... ) ORO_CAPTURE( CaptureEventDestroy, hipEventDestroy, __VA_ARGS__ )
+#define hipEventDestroy_cu4oro( ... ) ORO_CAPTURE( CaptureEventDestroy, hipEventDestroy_cu4oro, __VA_ARGS__ )
+#define hipEventRecord( ... ) ORO_CAPTURE( CaptureEventRecord, hipEventRecord, __VA_ARGS__ )
+#define hipEventRecord_cu4oro( ... ) ORO_CAPTURE( CaptureEventRecord, hipEventRecord_cu4oro, __VA_ARGS__ )
+#define hipEventSynchronize( ... ) ORO_CAPTURE( CaptureEventSynchronize, hipEventSynchronize, __VA_ARGS__ )
+#define hipEventSynchronize_cu4oro( ... ) ORO_CAPTURE( CaptureEventSynchronize, hipEventSynchronize_cu4oro, __VA_ARGS__ )
+#define hipStreamWaitEvent( ... ) ORO_CAPTURE( CaptureStreamWaitEvent, hipStreamWaitEvent, __VA_ARGS__ )
+#define hipStreamWaitEvent_cu4oro( ... ) ORO_CAPTURE( CaptureStreamWaitEvent, hipStreamWaitEvent_cu4oro, __VA_ARGS__ )
+#define hipDeviceSynchronize() hipDeviceSynchronize() << captureArgs<CaptureDeviceSynchronize>( __oroTrace )
+#define hipDeviceSynchronize_cu4oro() hipDeviceSynchronize_cu4oro() << captureArgs<CaptureDeviceSynchronize>( __oroTrace )
+
 #pragma region OROCHI_SUMMONER_REGION_orochi_cpp_switch
 
 /////
@@ -3830,3 +6739,69 @@ orortcResult OROAPI orortcLinkDestroy(orortcLinkState hip_link_state)
 ///// (region automatically generated by Orochi Summoner)
 #pragma endregion
 
+#undef ORO_CAPTURE
+#undef hipMalloc
+#undef hipMalloc_cu4oro
+#undef hipFree
+#undef hipFree_cu4oro
+#undef hipMemcpy
+#undef hipMemcpy_cu4oro
+#undef hipMemcpyAsync
+#undef hipMemcpyAsync_cu4oro
+#undef hipMemcpyHtoD
+#undef hipMemcpyHtoD_cu4oro
+#undef hipMemcpyHtoDAsync
+#undef hipMemcpyHtoDAsync_cu4oro
+#undef hipMemcpyDtoH
+#undef hipMemcpyDtoH_cu4oro
+#undef hipMemcpyDtoHAsync
+#undef hipMemcpyDtoHAsync_cu4oro
+#undef hipMemcpyDtoD
+#undef hipMemcpyDtoD_cu4oro
+#undef hipMemcpyDtoDAsync
+#undef hipMemcpyDtoDAsync_cu4oro
+#undef hipMemset
+#undef hipMemset_cu4oro
+#undef hipMemsetAsync
+#undef hipMemsetAsync_cu4oro
+#undef hipMemsetD8
+#undef hipMemsetD8_cu4oro
+#undef hipMemsetD8Async
+#undef hipMemsetD8Async_cu4oro
+#undef hipMemsetD32
+#undef hipMemsetD32_cu4oro
+#undef hipMemsetD32Async
+#undef hipMemsetD32Async_cu4oro
+#undef hipModuleLoadData
+#undef hipModuleLoadData_cu4oro
+#undef hipModuleLoadDataEx
+#undef hipModuleLoadDataEx_cu4oro
+#undef hipModuleGetFunction
+#undef hipModuleGetFunction_cu4oro
+#undef hipModuleUnload
+#undef hipModuleUnload_cu4oro
+#undef hipModuleLaunchKernel
+#undef hipModuleLaunchKernel_cu4oro
+#undef hipStreamCreate
+#undef hipStreamCreate_cu4oro
+#undef hipStreamCreateWithFlags
+#undef hipStreamCreateWithFlags_cu4oro
+#undef hipStreamDestroy
+#undef hipStreamDestroy_cu4oro
+#undef hipStreamSynchronize
+#undef hipStreamSynchronize_cu4oro
+#undef hipEventCreate
+#undef hipEventCreate_cu4oro
+#undef hipEventCreateWithFlags
+#undef hipEventCreateWithFlags_cu4oro
+#undef hipEventDestroy
+#undef hipEventDestroy_cu4oro
+#undef hipEventRecord
+#undef hipEventRecord_cu4oro
+#undef hipEventSynchronize
+#undef hipEventSynchronize_cu4oro
+#undef hipStreamWaitEvent
+#undef hipStreamWaitEvent_cu4oro
+#undef hipDeviceSynchronize
+#undef hipDeviceSynchronize_cu4oro
+
@@ -1167,6 +1167,8 @@ enum oroApi
 	ORO_API_CUDADRIVER = 1 << 3,
 	ORO_API_CUDARTC = 1 << 4,
 	ORO_API_CUDA = ORO_API_CUDADRIVER | ORO_API_CUDARTC,
+	// a device running on the CPU, without driver. the kernels are compiled by the C++ compiler of the system ( see oroInitialize ).
+	ORO_API_HOST = 1 << 5,
 };
 
 
@@ -1239,6 +1241,13 @@ enum {
 	ORO_ERROR_OLD_DRIVER = -3,
 };
 
+// flags of oroInitialize
+enum {
+	// resolve all the functions of the HIP/CUDA libraries in oroInitialize, to know right away which ones are missing.
+	// by default, each function is resolved the first time it's called, and the runtime compiler is loaded by the first call of an orortc function.
+	ORO_INIT_EAGER = 1 << 0,
+};
+
 
 //
 // Functions of Orochi that are not part of the Orochi Summoner auto-generated source code.
@@ -1254,6 +1263,11 @@ enum {
 //     customPaths_Hip[]    = {"amdhip64_6.dll", "amdhip64.dll", NULL};
 //     customPaths_Hiprtc[] = {"hiprtc0600.dll", "hiprtc0507.dll", NULL};
 //     Note that those lists are non-correlated, meaning Orochi can take for example the second element of customPaths_Hip and the first element of customPaths_Hiprtc.
+// ORO_API_HOST adds a device after the HIP and CUDA ones: its memory is host memory, its streams run their work in order on a thread each,
+// and the kernels given to orortc are compiled to a shared library by the C++ compiler of the environment variable ORO_HOST_CXX ( c++ by default ).
+// each block runs on a worker thread, its threads are fibers switching at __syncthreads and at the warp functions ( see OrochiHostKernel.h ).
+// the kernels must be at global scope and not templates, __shared__ variables are static ( not extern ), and the functions of the driver
+// which are not emulated return oroErrorNotSupported.
 int oroInitialize( oroApi api, oroU32 flags, 
 	const char** customPaths_Hip hipew__dparm(0),
 	const char** customPaths_Hiprtc hipew__dparm(0),
@@ -1262,7 +1276,11 @@ int oroInitialize( oroApi api, oroU32 flags,
 	const char** customPaths_NvRTC hipew__dparm(0)
 	);
 
+// the APIs available after oroInitialize. a runtime compiler ( ORO_API_HIPRTC, ORO_API_CUDARTC ) can be available but not loaded yet:
+// by default it's loaded by the first call of an orortc function, so the processes which only load binaries never map it.
+// oroDeferredAPI returns the ones not loaded yet. if the load fails, the API is removed from oroLoadedAPI.
 oroApi oroLoadedAPI();
+oroApi oroDeferredAPI();
 oroApi oroGetCurAPI( oroU32 flags );
 void* oroGetRawCtx( oroCtx ctx );
 oroError oroCtxCreateFromRaw( oroCtx* ctxOut, oroApi api, void* ctxIn );
@@ -1282,6 +1300,90 @@ oroError OROAPI oroCtxSetCurrent(oroCtx ctx) ;
 oroError OROAPI oroCtxGetCurrent(oroCtx* pctx) ;
 oroError OROAPI oroCtxGetApiVersion(oroCtx ctx, int* version);
 
+// the tracer of the oro* calls going through the generated wrappers, off by default. each call is timed with its result,
+// without lock: the threads record in their own ring buffer of the last ORO_TRACE_CAPACITY calls and their own statistics.
+// the buffer of a thread is reused by the next threads after it exits, at most 256 threads are recorded at once.
+// the environment variable ORO_TRACE enables it at oroInitialize. ORO_TRACE=1 only enables it, any other value is the path of
+// the Chrome trace ( chrome://tracing, Perfetto ) written at exit, after the statistics are printed. the calls the capture records
+// ( allocations, copies, modules, launches, streams and events ) are traced with the values of their arguments.
+enum
+{
+	ORO_TRACE_CAPACITY = 8192,
+	ORO_TRACE_NUM_BUCKETS = 32,
+};
+struct oroTraceStats
+{
+	const char* name;
+	uint64_t count;
+	uint64_t errors;
+	uint64_t totalNs;
+	uint64_t minNs;
+	uint64_t maxNs;
+	// histogram[i] is the number of calls which took less than 2^(i+1) ns ( and at least 2^i ns, but for the first ).
+	uint64_t histogram[ORO_TRACE_NUM_BUCKETS];
+};
+void oroTraceEnable( bool enable );
+bool oroTraceEnabled();
+// the statistics of the functions called, over all threads. returns the number of functions, fills up to maxStats.
+int oroTraceGetStats( oroTraceStats* stats, int maxStats );
+void oroTracePrintStats();
+// the calls in the ring buffers, as complete events ( "ph":"X" ) of a Chrome trace.
+oroError oroTraceWriteChromeTrace( const char* path );
+
+// the capture of the oro* calls in a log replayed by Test/Replay, on any backend ( the format is in OrochiCapture.h ).
+// the allocations, copies, memsets, modules, launches, streams and events are written in the order the calls return, with their timing.
+// the environment variable ORO_CAPTURE ( the path of the log ) begins it at oroInitialize, until exit. ORO_CAPTURE_DATA ( "none", "hash", "all" ) sets the data.
+// the pointers are only replayed if they are in the allocations of oroMalloc: the ones live when the capture begins are recorded first ( with their content for ORO_CAPTURE_DATA_ALL ),
+// if they were tracked ( see oroCaptureTrackAllocations ).
+enum oroCaptureData
+{
+	// only the size of the copies.
+	ORO_CAPTURE_DATA_NONE = 0,
+	// the hash of the copied data, to compare captures.
+	ORO_CAPTURE_DATA_HASH = 1,
+	// the data copied to the device and the hash of the one copied to the host: the replay checks it copies the same data to the host.
+	ORO_CAPTURE_DATA_ALL = 2,
+};
+oroError oroCaptureBegin( const char* path, oroCaptureData data = ORO_CAPTURE_DATA_NONE );
+oroError oroCaptureEnd();
+// true between oroCaptureBegin and oroCaptureEnd.
+bool oroCaptureEnabled();
+// track the allocations outside of the captures, so a capture begun later records the ones live. off by default: the allocations then take no lock.
+// call it before allocating, the allocations made before are unknown to the captures.
+void oroCaptureTrackAllocations( bool enable );
+// the sizes of the arguments of a function, so its launches given kernelParams are captured with their arguments.
+// the other launches given kernelParams are captured without arguments, and skipped by the replay.
+void oroCaptureSetKernelArgSizes( oroFunction f, int numArgs, const size_t* argSizes );
+
+// the devices seen by oroInit, queried once and immutable then, so looking them up doesn't go to the driver.
+// the ordinals are the ones of oroDeviceGet: the HIP devices, then the CUDA devices.
+struct oroDeviceSnapshot
+{
+	int numDevices;
+	int numHipDevices;
+	int numCudaDevices;
+	// ORO_API_HOST, after the CUDA devices.
+	int numHostDevices;
+	int hipDriverVersion;
+	int hipRuntimeVersion;
+	int cudaDriverVersion;
+	int cudaRuntimeVersion;
+	// by ordinal.
+	const oroDevice* devices;
+	const oroDeviceProp* properties;
+	// gcnArchName on HIP ( "gfx90a:sramecc+:xnack-" ), the name and SM on CUDA ( "NVIDIA GeForce RTX 3080.sm_86" ).
+	const char* const* archNames;
+	// numDevices x numDevices, peerAccess[i * numDevices + j] != 0 if device i can access device j. 0 between APIs.
+	const unsigned char* peerAccess;
+};
+// nullptr before oroInit. a snapshot stays valid until the process exits, an oroInit loading other APIs publishes a new one.
+const oroDeviceSnapshot* oroGetDeviceSnapshot();
+// the ordinal of the device in the snapshot, -1 if it isn't in it.
+int oroDeviceGetOrdinal( oroDevice dev );
+// the properties and the architecture of the device in the snapshot, nullptr if it isn't in it.
+const oroDeviceProp* oroDeviceGetSnapshotProperties( oroDevice dev );
+const char* oroDeviceGetArchName( oroDevice dev );
+
 
 oroChannelFormatDesc OROAPI oroCreateChannelDesc(int x, int y, int z, int w,  oroChannelFormatKind f);
 orortcResult OROAPI orortcGetBitcode(orortcProgram prog, char* bitcode);
@@ -0,0 +1,125 @@
+//
+// Copyright (c) 2021-2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+#include <stdint.h>
+
+// the format of the log written by oroCaptureBegin ( see Orochi.h ) and replayed by Test/Replay.
+// the file is a FileHeader, then the records of the calls in the order they returned: a RecordHeader and its body.
+// the values of the bodies are uint64_t in the byte order of the capturing machine, but the bytes of the data.
+//
+// the handles ( streams, events, modules, functions ) are the values they had in the captured process, the replay maps them to its own.
+// a device pointer is a reference: the pointer of its allocation ( as returned by oroMalloc ), then the offset in it.
+// the reference of a pointer outside of the allocations made during the capture is ( 0, pointer ), it can't be replayed.
+namespace OroCapture
+{
+const char MAGIC[8] = { 'O', 'R', 'O', 'C', 'A', 'P', 0, 0 };
+const uint32_t VERSION = 1;
+
+struct FileHeader
+{
+	char magic[8];
+	uint32_t version;
+	// oroApi of the captured process.
+	uint32_t api;
+};
+
+enum Op : uint16_t
+{
+	// ptr, size
+	MALLOC = 1,
+	// ptr
+	FREE,
+	// dst reference, size, stream, data mode ( oroCaptureData ), then the hash or the data ( padded to 8 bytes ).
+	MEMCPY_HTOD,
+	// src reference, size, stream, data mode, then the hash of the data read ( only for the synchronous copies ).
+	MEMCPY_DTOH,
+	// dst reference, src reference, size, stream
+	MEMCPY_DTOD,
+	// dst reference, value, count, element size ( 1 or 4 ), stream
+	MEMSET,
+	// module, hash of the image, size of the image, then the image ( padded to 8 bytes ) if FLAG_IMAGE.
+	// an image is in the log once, the next loads of the same image only have its hash. the size is 0 if the image format is unknown.
+	MODULE_LOAD,
+	// function, module, length of the name, then the name ( padded to 8 bytes ).
+	MODULE_GET_FUNCTION,
+	// module
+	MODULE_UNLOAD,
+	// function, grid x, y, z, block x, y, z, shared memory, stream, number of arguments ( ~0 if unknown ),
+	// then each argument: its size and its bytes ( padded to 8 bytes ), then the number of relocations,
+	// then each relocation: the argument, the offset in the argument and a reference, written as a pointer at that offset by the replay.
+	// the arguments are a single buffer given as HIP_LAUNCH_PARAM_BUFFER_POINTER if FLAG_EXTRA.
+	LAUNCH,
+	// stream, flags
+	STREAM_CREATE,
+	// stream
+	STREAM_DESTROY,
+	// stream
+	STREAM_SYNCHRONIZE,
+	// event, flags
+	EVENT_CREATE,
+	// event
+	EVENT_DESTROY,
+	// event, stream
+	EVENT_RECORD,
+	// event
+	EVENT_SYNCHRONIZE,
+	// stream, event, flags
+	STREAM_WAIT_EVENT,
+	// no body
+	DEVICE_SYNCHRONIZE,
+};
+
+enum Flags : uint16_t
+{
+	// the call took a stream.
+	FLAG_ASYNC = 1 << 0,
+	FLAG_IMAGE = 1 << 1,
+	FLAG_EXTRA = 1 << 2,
+};
+
+struct RecordHeader
+{
+	uint16_t op;
+	uint16_t flags;
+	// of the body, in bytes.
+	uint32_t size;
+	// since the beginning of the capture, in ns.
+	uint64_t time;
+	uint64_t duration;
+};
+
+const uint64_t UNKNOWN_ARGS = ~0ull;
+
+// FNV-1a, the hash of the copied data and of the images.
+inline uint64_t hash( const void* data, uint64_t size )
+{
+	uint64_t h = 14695981039346656037ull;
+	const unsigned char* p = (const unsigned char*)data;
+	for( uint64_t i = 0; i < size; i++ )
+	{
+		h ^= p[i];
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+} // namespace OroCapture
@@ -0,0 +1,705 @@
+//
+// Copyright (c) 2021-2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// the emulation layer of the kernels compiled for ORO_API_HOST, as a string: Orochi.cpp writes it next to the program and includes it first.
+// a block runs on one thread. its threads are fibers, which switch at __syncthreads and at the warp functions: a fiber waits there for the
+// other threads of its block, or of its warp. the __shared__ variables are thread_local statics, so the fibers of a block share them.
+// each kernel is exported as a Kernel named __oroHostKernel_<name> ( see ORO_HOST_KERNEL ), which must match HostKernel in Orochi.cpp.
+R"ORO_HOST(
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if defined( _WIN32 )
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#define ORO_HOST_EXPORT __declspec( dllexport )
+#else
+#include <ucontext.h>
+#define ORO_HOST_EXPORT __attribute__( ( visibility( "default" ) ) )
+#endif
+// swapcontext saves the signal mask with a system call at each switch: where the registers saved by the callee are known, the fibers switch
+// with oroHostSwitch instead.
+#if defined( __linux__ ) && ( defined( __x86_64__ ) || defined( __aarch64__ ) ) && !defined( ORO_HOST_UCONTEXT )
+#define ORO_HOST_FAST_SWITCH 1
+#endif
+
+#define __OROCHI_HOST__ 1
+#if !defined( ORO_HOST_STACK_SIZE )
+#define ORO_HOST_STACK_SIZE ( 128 * 1024 )
+#endif
+
+// Orochi preprocesses the program with ORO_HOST_FIND_KERNELS to find the kernels.
+#if defined( ORO_HOST_FIND_KERNELS )
+#define __global__ __attribute__( ( oro_kernel ) )
+#else
+#define __global__
+#endif
+#define __device__
+#define __host__
+#define __constant__
+#define __forceinline__ inline
+#define __noinline__
+#define __launch_bounds__( ... )
+#define __shared__ static thread_local
+#if defined( _MSC_VER ) && !defined( __clang__ )
+#define __restrict__ __restrict
+#endif
+
+#define ORO_HOST_VECTOR( T, name )                                                                     \
+	struct name##1                                                                                   \
+	{                                                                                                \
+		T x;                                                                                         \
+	};                                                                                               \
+	struct alignas( 2 * sizeof( T ) ) name##2                                                        \
+	{                                                                                                \
+		T x, y;                                                                                      \
+	};                                                                                               \
+	struct name##3                                                                                   \
+	{                                                                                                \
+		T x, y, z;                                                                                   \
+	};                                                                                               \
+	struct alignas( 4 * sizeof( T ) ) name##4                                                        \
+	{                                                                                                \
+		T x, y, z, w;                                                                                \
+	};                                                                                               \
+	inline name##1 make_##name##1( T x ) { return { x }; }                                           \
+	inline name##2 make_##name##2( T x, T y ) { return { x, y }; }                                   \
+	inline name##3 make_##name##3( T x, T y, T z ) { return { x, y, z }; }                           \
+	inline name##4 make_##name##4( T x, T y, T z, T w ) { return { x, y, z, w }; }
+
+ORO_HOST_VECTOR( signed char, char )
+ORO_HOST_VECTOR( unsigned char, uchar )
+ORO_HOST_VECTOR( short, short )
+ORO_HOST_VECTOR( unsigned short, ushort )
+ORO_HOST_VECTOR( int, int )
+ORO_HOST_VECTOR( unsigned int, uint )
+ORO_HOST_VECTOR( long long, longlong )
+ORO_HOST_VECTOR( unsigned long long, ulonglong )
+ORO_HOST_VECTOR( float, float )
+ORO_HOST_VECTOR( double, double )
+#undef ORO_HOST_VECTOR
+
+struct dim3
+{
+	unsigned int x, y, z;
+	constexpr dim3( unsigned int vx = 1, unsigned int vy = 1, unsigned int vz = 1 ) : x( vx ), y( vy ), z( vz ) {}
+};
+
+static constexpr int warpSize = 32;
+
+namespace oroHost
+{
+const unsigned int KERNEL_VERSION = 1;
+// the bytes of a thread in the values exchanged by the warp functions.
+const unsigned int EXCHANGE_SIZE = 16;
+
+struct Launch
+{
+	unsigned int grid[3];
+	unsigned int block[3];
+	unsigned int sharedMemBytes;
+	// the arguments, packed by Kernel::pack.
+	const void* args;
+};
+
+struct Kernel
+{
+	unsigned int version;
+	unsigned int argsAlignment;
+	size_t argsSize;
+	// packs the arguments given as kernelParams, or in a buffer ( HIP_LAUNCH_PARAM_BUFFER_POINTER ) if kernelParams is null. 0 on success.
+	int ( *pack )( void* args, void** kernelParams, const void* buffer, size_t bufferSize );
+	// runs a block on the calling thread.
+	void ( *run )( const Launch* launch, unsigned int block );
+};
+
+// saves the registers of the caller on its stack and its stack pointer in *from, then resumes the fiber whose stack pointer is to.
+extern "C" void oroHostSwitch( void** from, void* to );
+#if defined( ORO_HOST_FAST_SWITCH ) && defined( __x86_64__ )
+// the control words of the floating point units, then the registers saved by the callee, and the return address.
+asm( ".text\n"
+	 ".globl oroHostSwitch\n"
+	 ".hidden oroHostSwitch\n"
+	 ".type oroHostSwitch, @function\n"
+	 "oroHostSwitch:\n"
+	 "	pushq %rbp\n"
+	 "	pushq %rbx\n"
+	 "	pushq %r12\n"
+	 "	pushq %r13\n"
+	 "	pushq %r14\n"
+	 "	pushq %r15\n"
+	 "	subq $8, %rsp\n"
+	 "	stmxcsr (%rsp)\n"
+	 "	fnstcw 4(%rsp)\n"
+	 "	movq %rsp, (%rdi)\n"
+	 "	movq %rsi, %rsp\n"
+	 "	ldmxcsr (%rsp)\n"
+	 "	fldcw 4(%rsp)\n"
+	 "	addq $8, %rsp\n"
+	 "	popq %r15\n"
+	 "	popq %r14\n"
+	 "	popq %r13\n"
+	 "	popq %r12\n"
+	 "	popq %rbx\n"
+	 "	popq %rbp\n"
+	 "	ret\n"
+	 ".size oroHostSwitch, .-oroHostSwitch\n" );
+#elif defined( ORO_HOST_FAST_SWITCH ) && defined( __aarch64__ )
+// x19-x30, then d8-d15. x30 is the return address.
+asm( ".text\n"
+	 ".globl oroHostSwitch\n"
+	 ".hidden oroHostSwitch\n"
+	 ".type oroHostSwitch, %function\n"
+	 "oroHostSwitch:\n"
+	 "	sub sp, sp, #160\n"
+	 "	stp x19, x20, [sp, #0]\n"
+	 "	stp x21, x22, [sp, #16]\n"
+	 "	stp x23, x24, [sp, #32]\n"
+	 "	stp x25, x26, [sp, #48]\n"
+	 "	stp x27, x28, [sp, #64]\n"
+	 "	stp x29, x30, [sp, #80]\n"
+	 "	stp d8, d9, [sp, #96]\n"
+	 "	stp d10, d11, [sp, #112]\n"
+	 "	stp d12, d13, [sp, #128]\n"
+	 "	stp d14, d15, [sp, #144]\n"
+	 "	mov x2, sp\n"
+	 "	str x2, [x0]\n"
+	 "	mov sp, x1\n"
+	 "	ldp x19, x20, [sp, #0]\n"
+	 "	ldp x21, x22, [sp, #16]\n"
+	 "	ldp x23, x24, [sp, #32]\n"
+	 "	ldp x25, x26, [sp, #48]\n"
+	 "	ldp x27, x28, [sp, #64]\n"
+	 "	ldp x29, x30, [sp, #80]\n"
+	 "	ldp d8, d9, [sp, #96]\n"
+	 "	ldp d10, d11, [sp, #112]\n"
+	 "	ldp d12, d13, [sp, #128]\n"
+	 "	ldp d14, d15, [sp, #144]\n"
+	 "	add sp, sp, #160\n"
+	 "	ret\n"
+	 ".size oroHostSwitch, .-oroHostSwitch\n" );
+#endif
+
+struct Fiber
+{
+#if defined( _WIN32 )
+	void* m_fiber = nullptr;
+#elif defined( ORO_HOST_FAST_SWITCH )
+	void* m_sp = nullptr;
+	void* m_stack = nullptr;
+#else
+	ucontext_t m_context;
+	void* m_stack = nullptr;
+#endif
+	bool m_done = true;
+	// the fiber isn't resumed while *m_wait is m_waitFor, the generation of the barrier it reached.
+	const unsigned int* m_wait = nullptr;
+	unsigned int m_waitFor = 0;
+};
+
+// the threads of the block, or of a warp, which didn't return, and the ones waiting for the others.
+struct Barrier
+{
+	unsigned int m_expected = 0;
+	unsigned int m_arrived = 0;
+	unsigned int m_generation = 0;
+
+	void release()
+	{
+		m_arrived = 0;
+		m_generation++;
+	}
+};
+
+// the block running on the thread. the fibers are kept for the next blocks.
+struct Block
+{
+	std::vector<Fiber*> m_fibers;
+#if defined( _WIN32 ) || defined( ORO_HOST_FAST_SWITCH )
+	void* m_main = nullptr;
+#else
+	ucontext_t m_main;
+#endif
+	unsigned int m_size = 0;
+	unsigned int m_current = 0;
+	void ( *m_entry )( const void* ) = nullptr;
+	const void* m_args = nullptr;
+	std::vector<unsigned char> m_exchange;
+	// the threads between the two barriers of an exchange.
+	std::vector<unsigned char> m_exchanging;
+	Barrier m_block;
+	std::vector<Barrier> m_warps;
+
+	~Block()
+	{
+		for( Fiber* f : m_fibers )
+		{
+#if defined( _WIN32 )
+			DeleteFiber( f->m_fiber );
+#else
+			free( f->m_stack );
+#endif
+			delete f;
+		}
+	}
+};
+
+inline thread_local Block t_block;
+inline thread_local uint3 t_threadIdx;
+inline thread_local uint3 t_blockIdx;
+inline thread_local uint3 t_blockDim;
+inline thread_local uint3 t_gridDim;
+
+inline void switchToMain( Block& b )
+{
+#if defined( _WIN32 )
+	SwitchToFiber( b.m_main );
+#elif defined( ORO_HOST_FAST_SWITCH )
+	oroHostSwitch( &b.m_fibers[b.m_current]->m_sp, b.m_main );
+#else
+	swapcontext( &b.m_fibers[b.m_current]->m_context, &b.m_main );
+#endif
+}
+
+inline void switchToFiber( Block& b, Fiber* f )
+{
+#if defined( _WIN32 )
+	SwitchToFiber( f->m_fiber );
+#elif defined( ORO_HOST_FAST_SWITCH )
+	oroHostSwitch( &b.m_main, f->m_sp );
+#else
+	swapcontext( &b.m_main, &f->m_context );
+#endif
+}
+
+// waits for the other threads of the barrier, in the scheduler of the block.
+inline void arrive( Barrier& barrier )
+{
+	Block& b = t_block;
+	if( b.m_size <= 1 ) return;
+	if( ++barrier.m_arrived == barrier.m_expected )
+	{
+		// the last one goes on, the others are resumed in the next round.
+		barrier.release();
+		return;
+	}
+	Fiber* f = b.m_fibers[b.m_current];
+	f->m_wait = &barrier.m_generation;
+	f->m_waitFor = barrier.m_generation;
+	switchToMain( b );
+}
+
+inline Barrier& warpBarrier()
+{
+	Block& b = t_block;
+	return b.m_warps[b.m_current / warpSize];
+}
+
+// a thread which returned doesn't hold its barriers anymore.
+inline void leave( Barrier& barrier )
+{
+	barrier.m_expected--;
+	if( barrier.m_arrived && barrier.m_arrived == barrier.m_expected ) barrier.release();
+}
+
+// the body of the fibers: a thread of the block, then the thread of the same index in the next block.
+#if defined( _WIN32 )
+inline void CALLBACK fiberMain( void* )
+#else
+inline void fiberMain()
+#endif
+{
+	for( ;; )
+	{
+		Block& b = t_block;
+		b.m_entry( b.m_args );
+		b.m_fibers[b.m_current]->m_done = true;
+		switchToMain( b );
+	}
+}
+
+inline Fiber* createFiber()
+{
+	Fiber* f = new Fiber;
+#if defined( _WIN32 )
+	f->m_fiber = CreateFiber( ORO_HOST_STACK_SIZE, fiberMain, nullptr );
+#elif defined( ORO_HOST_FAST_SWITCH )
+	// the stack as left by oroHostSwitch, returning to fiberMain.
+	f->m_stack = malloc( ORO_HOST_STACK_SIZE );
+	uintptr_t* top = (uintptr_t*)( ( (uintptr_t)f->m_stack + ORO_HOST_STACK_SIZE ) & ~(uintptr_t)15 );
+#if defined( __x86_64__ )
+	// fiberMain starts as if it was called, with a null return address.
+	*--top = 0;
+	*--top = (uintptr_t)&fiberMain;
+	for( int i = 0; i < 6; i++ )
+		*--top = 0;
+	uint32_t control[2] = {};
+	asm volatile( "stmxcsr %0\n\tfnstcw %1" : "=m"( control[0] ), "=m"( control[1] ) );
+	*--top = control[0] | ( (uintptr_t)control[1] << 32 );
+#else
+	top -= 20;
+	memset( top, 0, 20 * sizeof( uintptr_t ) );
+	top[11] = (uintptr_t)&fiberMain;
+#endif
+	f->m_sp = top;
+#else
+	f->m_stack = malloc( ORO_HOST_STACK_SIZE );
+	getcontext( &f->m_context );
+	f->m_context.uc_stack.ss_sp = f->m_stack;
+	f->m_context.uc_stack.ss_size = ORO_HOST_STACK_SIZE;
+	f->m_context.uc_link = nullptr;
+	makecontext( &f->m_context, (void ( * )())fiberMain, 0 );
+#endif
+	return f;
+}
+
+inline void runBlock( void ( *entry )( const void* ), const void* args )
+{
+	Block& b = t_block;
+	const uint3 dim = t_blockDim;
+	b.m_entry = entry;
+	b.m_args = args;
+	b.m_size = dim.x * dim.y * dim.z;
+	if( b.m_exchange.size() < b.m_size * EXCHANGE_SIZE ) b.m_exchange.resize( b.m_size * EXCHANGE_SIZE );
+	b.m_exchanging.assign( b.m_size, 0 );
+	if( b.m_size == 1 )
+	{
+		b.m_current = 0;
+		t_threadIdx = { 0, 0, 0 };
+		entry( args );
+		return;
+	}
+
+#if defined( _WIN32 )
+	if( !b.m_main ) b.m_main = IsThreadAFiber() ? GetCurrentFiber() : ConvertThreadToFiber( nullptr );
+#endif
+	while( b.m_fibers.size() < b.m_size )
+		b.m_fibers.push_back( createFiber() );
+	for( unsigned int i = 0; i < b.m_size; i++ )
+	{
+		b.m_fibers[i]->m_done = false;
+		b.m_fibers[i]->m_wait = nullptr;
+	}
+	b.m_block.m_expected = b.m_size;
+	b.m_block.m_arrived = 0;
+	b.m_warps.resize( ( b.m_size + warpSize - 1 ) / warpSize );
+	for( unsigned int i = 0; i < b.m_warps.size(); i++ )
+	{
+		b.m_warps[i].m_expected = std::min( b.m_size - i * warpSize, (unsigned int)warpSize );
+		b.m_warps[i].m_arrived = 0;
+	}
+
+	unsigned int running = b.m_size;
+	while( running )
+	{
+		bool resumed = false;
+		for( unsigned int i = 0; i < b.m_size; i++ )
+		{
+			Fiber* f = b.m_fibers[i];
+			if( f->m_done || ( f->m_wait && *f->m_wait == f->m_waitFor ) ) continue;
+			resumed = true;
+			b.m_current = i;
+			t_threadIdx = { i % dim.x, i / dim.x % dim.y, i / ( dim.x * dim.y ) };
+			switchToFiber( b, f );
+			if( f->m_done )
+			{
+				running--;
+				leave( b.m_block );
+				leave( b.m_warps[i / warpSize] );
+			}
+		}
+		// the threads of a warp wait for lanes which are at a __syncthreads ( diverged ): the warp functions go on with the lanes there.
+		if( !resumed )
+			for( Barrier& w : b.m_warps )
+				if( w.m_arrived ) w.release();
+	}
+}
+)ORO_HOST"
+// split for the limit of msvc on the length of a literal.
+R"ORO_HOST(
+
+// each thread of the barrier gives a value, then gets the one given by the thread source( index ), or its own if that one isn't in the exchange.
+template<typename R, typename T, typename F>
+inline R exchange( Barrier& barrier, T value, F source )
+{
+	static_assert( sizeof( T ) <= EXCHANGE_SIZE && sizeof( R ) <= EXCHANGE_SIZE, "value too large for the warp functions" );
+	Block& b = t_block;
+	memcpy( &b.m_exchange[b.m_current * EXCHANGE_SIZE], &value, sizeof( T ) );
+	b.m_exchanging[b.m_current] = 1;
+	arrive( barrier );
+	const R r = source( b.m_current, value );
+	arrive( barrier );
+	b.m_exchanging[b.m_current] = 0;
+	return r;
+}
+
+template<typename T>
+inline T valueOf( unsigned int thread, T self )
+{
+	Block& b = t_block;
+	if( thread >= b.m_size || !b.m_exchanging[thread] ) return self;
+	T v;
+	memcpy( &v, &b.m_exchange[thread * EXCHANGE_SIZE], sizeof( T ) );
+	return v;
+}
+
+template<typename T>
+inline T shuffle( T var, int width, int ( *lane )( int self, int delta, int width ), int delta )
+{
+	return exchange<T>( warpBarrier(), var, [width, lane, delta]( unsigned int thread, T self ) {
+		const unsigned int base = thread & ~( (unsigned int)width - 1 );
+		const int src = lane( (int)( thread - base ), delta, width );
+		return ( src < 0 ) ? self : valueOf( base + src, self );
+	} );
+}
+
+inline unsigned long long ballot( int predicate )
+{
+	return exchange<unsigned long long>( warpBarrier(), predicate != 0, []( unsigned int thread, bool ) {
+		const unsigned int base = thread & ~( (unsigned int)warpSize - 1 );
+		unsigned long long mask = 0;
+		for( unsigned int i = 0; i < (unsigned int)warpSize; i++ )
+			if( valueOf( base + i, false ) ) mask |= 1ull << i;
+		return mask;
+	} );
+}
+
+inline int blockCount( int predicate )
+{
+	return exchange<int>( t_block.m_block, predicate != 0, []( unsigned int, bool ) {
+		int n = 0;
+		for( unsigned int i = 0; i < t_block.m_size; i++ )
+			n += valueOf( i, false ) ? 1 : 0;
+		return n;
+	} );
+}
+
+template<typename T>
+inline std::atomic<T>& atomicRef( T* p )
+{
+	return *reinterpret_cast<std::atomic<T>*>( p );
+}
+
+// replaces the value by op( value ) and returns the previous one.
+template<typename T, typename F>
+inline T atomicUpdate( T* p, F op )
+{
+	std::atomic<T>& a = atomicRef( p );
+	T old = a.load();
+	while( !a.compare_exchange_weak( old, op( old ) ) )
+		;
+	return old;
+}
+
+template<auto K>
+struct Entry;
+
+template<typename... A, void ( *K )( A... )>
+struct Entry<K>
+{
+	using Args = std::tuple<std::decay_t<A>...>;
+
+	static void invoke( const void* args ) { std::apply( K, *(const Args*)args ); }
+
+	template<size_t... I>
+	static void construct( void* args, void** params, std::index_sequence<I...> )
+	{
+		new( args ) Args( *(const std::decay_t<A>*)params[I]... );
+	}
+
+	static int pack( void* args, void** kernelParams, const void* buffer, size_t bufferSize )
+	{
+		void* params[sizeof...( A ) + 1];
+		if( !kernelParams )
+		{
+			// the arguments are laid out like the members of a structure.
+			size_t offset = 0;
+			size_t i = 0;
+			( ( offset = ( offset + alignof( std::decay_t<A> ) - 1 ) / alignof( std::decay_t<A> ) * alignof( std::decay_t<A> ), params[i++] = (char*)buffer + offset, offset += sizeof( std::decay_t<A> ) ), ... );
+			if( offset > bufferSize ) return -1;
+			kernelParams = params;
+		}
+		construct( args, kernelParams, std::index_sequence_for<A...>() );
+		return 0;
+	}
+
+	static void run( const Launch* launch, unsigned int block )
+	{
+		t_gridDim = { launch->grid[0], launch->grid[1], launch->grid[2] };
+		t_blockDim = { launch->block[0], launch->block[1], launch->block[2] };
+		t_blockIdx = { block % launch->grid[0], block / launch->grid[0] % launch->grid[1], block / ( launch->grid[0] * launch->grid[1] ) };
+		runBlock( invoke, launch->args );
+	}
+};
+} // namespace oroHost
+
+#define ORO_HOST_KERNEL( name )                                                                                                                             \
+	extern "C" ORO_HOST_EXPORT const oroHost::Kernel __oroHostKernel_##name = { oroHost::KERNEL_VERSION, alignof( oroHost::Entry<&name>::Args ), sizeof( oroHost::Entry<&name>::Args ), \
+																				 &oroHost::Entry<&name>::pack, &oroHost::Entry<&name>::run };
+
+#define threadIdx oroHost::t_threadIdx
+#define blockIdx oroHost::t_blockIdx
+#define blockDim oroHost::t_blockDim
+#define gridDim oroHost::t_gridDim
+
+inline void __syncthreads() { oroHost::arrive( oroHost::t_block.m_block ); }
+inline int __syncthreads_count( int predicate ) { return oroHost::blockCount( predicate ); }
+inline int __syncthreads_and( int predicate ) { return oroHost::blockCount( predicate ) == (int)oroHost::t_block.m_size; }
+inline int __syncthreads_or( int predicate ) { return oroHost::blockCount( predicate ) != 0; }
+inline void __syncwarp( unsigned long long = ~0ull ) { oroHost::arrive( oroHost::warpBarrier() ); }
+inline void __threadfence() { std::atomic_thread_fence( std::memory_order_seq_cst ); }
+inline void __threadfence_block() { std::atomic_thread_fence( std::memory_order_seq_cst ); }
+inline void __threadfence_system() { std::atomic_thread_fence( std::memory_order_seq_cst ); }
+inline unsigned int __lane_id() { return oroHost::t_block.m_current % warpSize; }
+
+template<typename T>
+inline T __shfl( T var, int srcLane, int width = warpSize )
+{
+	return oroHost::shuffle( var, width, []( int, int src, int w ) { return src & ( w - 1 ); }, srcLane );
+}
+template<typename T>
+inline T __shfl_up( T var, unsigned int delta, int width = warpSize )
+{
+	return oroHost::shuffle( var, width, []( int self, int d, int ) { return self - d; }, (int)delta );
+}
+template<typename T>
+inline T __shfl_down( T var, unsigned int delta, int width = warpSize )
+{
+	return oroHost::shuffle( var, width, []( int self, int d, int w ) { return ( self + d < w ) ? self + d : -1; }, (int)delta );
+}
+template<typename T>
+inline T __shfl_xor( T var, int laneMask, int width = warpSize )
+{
+	return oroHost::shuffle( var, width, []( int self, int m, int w ) { return ( self ^ m ) & ( w - 1 ); }, laneMask );
+}
+template<typename T>
+inline T __shfl_sync( unsigned long long, T var, int srcLane, int width = warpSize ) { return __shfl( var, srcLane, width ); }
+template<typename T>
+inline T __shfl_up_sync( unsigned long long, T var, unsigned int delta, int width = warpSize ) { return __shfl_up( var, delta, width ); }
+template<typename T>
+inline T __shfl_down_sync( unsigned long long, T var, unsigned int delta, int width = warpSize ) { return __shfl_down( var, delta, width ); }
+template<typename T>
+inline T __shfl_xor_sync( unsigned long long, T var, int laneMask, int width = warpSize ) { return __shfl_xor( var, laneMask, width ); }
+inline unsigned long long __ballot( int predicate ) { return oroHost::ballot( predicate ); }
+inline unsigned int __ballot_sync( unsigned long long, int predicate ) { return (unsigned int)oroHost::ballot( predicate ); }
+inline int __any( int predicate ) { return oroHost::ballot( predicate ) != 0; }
+inline int __any_sync( unsigned long long, int predicate ) { return __any( predicate ); }
+inline int __all( int predicate ) { return oroHost::ballot( !predicate ) == 0; }
+inline int __all_sync( unsigned long long, int predicate ) { return __all( predicate ); }
+inline unsigned long long __activemask() { return oroHost::ballot( 1 ); }
+
+inline int __popc( unsigned int x ) { return __builtin_popcount( x ); }
+inline int __popcll( unsigned long long x ) { return __builtin_popcountll( x ); }
+inline int __clz( int x ) { return x ? __builtin_clz( (unsigned int)x ) : 32; }
+inline int __clzll( long long x ) { return x ? __builtin_clzll( (unsigned long long)x ) : 64; }
+inline int __ffs( int x ) { return __builtin_ffs( x ); }
+inline int __ffsll( long long x ) { return __builtin_ffsll( x ); }
+inline unsigned int __brev( unsigned int x )
+{
+	unsigned int r = 0;
+	for( int i = 0; i < 32; i++, x >>= 1 )
+		r = ( r << 1 ) | ( x & 1 );
+	return r;
+}
+inline int __mul24( int x, int y ) { return ( x << 8 >> 8 ) * ( y << 8 >> 8 ); }
+inline unsigned int __umul24( unsigned int x, unsigned int y ) { return ( x & 0xffffff ) * ( y & 0xffffff ); }
+inline int __mulhi( int x, int y ) { return (int)( ( (long long)x * y ) >> 32 ); }
+inline unsigned int __umulhi( unsigned int x, unsigned int y ) { return (unsigned int)( ( (unsigned long long)x * y ) >> 32 ); }
+inline float __fdividef( float x, float y ) { return x / y; }
+inline float __saturatef( float x ) { return x < 0.0f ? 0.0f : ( x > 1.0f ? 1.0f : x ); }
+inline float __expf( float x ) { return expf( x ); }
+inline float __logf( float x ) { return logf( x ); }
+inline float __sinf( float x ) { return sinf( x ); }
+inline float __cosf( float x ) { return cosf( x ); }
+inline float __powf( float x, float y ) { return powf( x, y ); }
+inline float rsqrtf( float x ) { return 1.0f / sqrtf( x ); }
+inline double rsqrt( double x ) { return 1.0 / sqrt( x ); }
+template<typename A, typename B>
+inline std::common_type_t<A, B> min( A a, B b ) { return ( b < a ) ? b : a; }
+template<typename A, typename B>
+inline std::common_type_t<A, B> max( A a, B b ) { return ( a < b ) ? b : a; }
+template<typename T>
+inline T __ldg( const T* p ) { return *p; }
+inline long long clock64() { return std::chrono::steady_clock::now().time_since_epoch().count(); }
+inline long long wall_clock64() { return clock64(); }
+inline void __trap() { abort(); }
+
+template<typename T, typename V>
+inline T atomicAdd( T* p, V v )
+{
+	if constexpr( std::is_floating_point<T>::value )
+		return oroHost::atomicUpdate( p, [v]( T old ) { return old + (T)v; } );
+	else
+		return oroHost::atomicRef( p ).fetch_add( (T)v );
+}
+template<typename T, typename V>
+inline T atomicSub( T* p, V v )
+{
+	return oroHost::atomicUpdate( p, [v]( T old ) { return old - (T)v; } );
+}
+template<typename T, typename V>
+inline T atomicExch( T* p, V v ) { return oroHost::atomicRef( p ).exchange( (T)v ); }
+template<typename T, typename V>
+inline T atomicMin( T* p, V v )
+{
+	return oroHost::atomicUpdate( p, [v]( T old ) { return ( (T)v < old ) ? (T)v : old; } );
+}
+template<typename T, typename V>
+inline T atomicMax( T* p, V v )
+{
+	return oroHost::atomicUpdate( p, [v]( T old ) { return ( old < (T)v ) ? (T)v : old; } );
+}
+template<typename T, typename V>
+inline T atomicAnd( T* p, V v ) { return oroHost::atomicRef( p ).fetch_and( (T)v ); }
+template<typename T, typename V>
+inline T atomicOr( T* p, V v ) { return oroHost::atomicRef( p ).fetch_or( (T)v ); }
+template<typename T, typename V>
+inline T atomicXor( T* p, V v ) { return oroHost::atomicRef( p ).fetch_xor( (T)v ); }
+template<typename T, typename C, typename V>
+inline T atomicCAS( T* p, C compare, V v )
+{
+	T old = (T)compare;
+	oroHost::atomicRef( p ).compare_exchange_strong( old, (T)v );
+	return old;
+}
+inline unsigned int atomicInc( unsigned int* p, unsigned int v )
+{
+	return oroHost::atomicUpdate( p, [v]( unsigned int old ) { return ( old >= v ) ? 0 : old + 1; } );
+}
+inline unsigned int atomicDec( unsigned int* p, unsigned int v )
+{
+	return oroHost::atomicUpdate( p, [v]( unsigned int old ) { return ( old == 0 || old > v ) ? v : old - 1; } );
+}
+)ORO_HOST"
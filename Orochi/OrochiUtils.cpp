@@ -21,19 +21,32 @@
 //
 
 #include <Orochi/OrochiUtils.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <codecvt>
+#include <cstddef>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string.h>
 #include <string>
+#include <thread>
+#include <unordered_set>
 
 #if defined( _WIN32 )
 #define NOMINMAX
 #include <Windows.h>
 #else
 #include <errno.h>
+#include <fcntl.h>
 #include <locale>
+#include <sys/file.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 inline std::wstring utf8_to_wstring( const std::string& str )
@@ -131,6 +144,124 @@ class FileStat
 #endif
 };
 
+// read only mapping of a whole file. the file stays writable by the others ( touchCacheFile updates the header of a mapped entry ), and can be replaced.
+class MappedFile
+{
+  public:
+	MappedFile( const char* filePath )
+	{
+#if defined( _WIN32 )
+		std::wstring filePathW = utf8_to_wstring( filePath );
+		m_file = CreateFileW( filePathW.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0 );
+		if( m_file == INVALID_HANDLE_VALUE ) return;
+
+		LARGE_INTEGER size;
+		if( GetFileSizeEx( m_file, &size ) == 0 || size.QuadPart == 0 ) return;
+
+		m_mapping = CreateFileMappingW( m_file, 0, PAGE_READONLY, 0, 0, 0 );
+		if( m_mapping == 0 ) return;
+
+		m_data = static_cast<const char*>( MapViewOfFile( m_mapping, FILE_MAP_READ, 0, 0, 0 ) );
+		if( m_data ) m_size = static_cast<size_t>( size.QuadPart );
+#else
+		const int fd = open( filePath, O_RDONLY );
+		if( fd == -1 ) return;
+
+		struct stat fileStat;
+		if( fstat( fd, &fileStat ) == 0 && fileStat.st_size > 0 )
+		{
+			void* p = mmap( nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+			if( p != MAP_FAILED )
+			{
+				m_data = static_cast<const char*>( p );
+				m_size = fileStat.st_size;
+			}
+		}
+		// the mapping stays valid after closing the descriptor
+		close( fd );
+#endif
+	}
+	~MappedFile()
+	{
+#if defined( _WIN32 )
+		if( m_data ) UnmapViewOfFile( m_data );
+		if( m_mapping ) CloseHandle( m_mapping );
+		if( m_file != INVALID_HANDLE_VALUE ) CloseHandle( m_file );
+#else
+		if( m_data ) munmap( const_cast<char*>( m_data ), m_size );
+#endif
+	}
+	MappedFile( const MappedFile& ) = delete;
+	MappedFile& operator=( const MappedFile& ) = delete;
+
+	bool found() const { return m_data != nullptr; }
+	const char* data() const { return m_data; }
+	size_t size() const { return m_size; }
+
+  private:
+#if defined( _WIN32 )
+	HANDLE m_file = INVALID_HANDLE_VALUE;
+	HANDLE m_mapping = 0;
+#endif
+	const char* m_data = nullptr;
+	size_t m_size = 0;
+};
+
+// exclusive advisory lock on a file, held until destruction. used to serialize work between processes ( and threads ).
+// if the file can't be locked ( read only file system... ), locked() is false and the work is just not serialized.
+class FileLock
+{
+  public:
+	FileLock( const char* filePath )
+	{
+#if defined( _WIN32 )
+		std::wstring filePathW = utf8_to_wstring( filePath );
+		m_file = CreateFileW( filePathW.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0 );
+		if( m_file == INVALID_HANDLE_VALUE ) return;
+		OVERLAPPED overlapped = {};
+		m_locked = LockFileEx( m_file, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped ) != 0;
+#else
+		// flock ( unlike fcntl locks ) is per open file, so it also serializes the threads of the same process.
+		m_fd = open( filePath, O_RDWR | O_CREAT, 0664 );
+		if( m_fd == -1 ) return;
+		int e;
+		do
+		{
+			e = flock( m_fd, LOCK_EX );
+		} while( e == -1 && errno == EINTR );
+		m_locked = ( e == 0 );
+#endif
+	}
+	~FileLock()
+	{
+#if defined( _WIN32 )
+		if( m_file == INVALID_HANDLE_VALUE ) return;
+		if( m_locked )
+		{
+			OVERLAPPED overlapped = {};
+			UnlockFileEx( m_file, 0, MAXDWORD, MAXDWORD, &overlapped );
+		}
+		CloseHandle( m_file );
+#else
+		if( m_fd == -1 ) return;
+		if( m_locked ) flock( m_fd, LOCK_UN );
+		close( m_fd );
+#endif
+	}
+	FileLock( const FileLock& ) = delete;
+	FileLock& operator=( const FileLock& ) = delete;
+
+	bool locked() const { return m_locked; }
+
+  private:
+#if defined( _WIN32 )
+	HANDLE m_file = INVALID_HANDLE_VALUE;
+#else
+	int m_fd = -1;
+#endif
+	bool m_locked = false;
+};
+
 struct OrochiUtilsImpl
 {
 	static bool readSourceCode( const std::string& path, std::string& sourceCode, std::vector<std::string>* includes )
@@ -146,17 +277,12 @@ struct OrochiUtilsImpl
 			{
 				sourceCode.clear();
 				std::string line;
-				char buf[512];
 				while( std::getline( f, line ) )
 				{
-					if( strstr( line.c_str(), "#include" ) != 0 )
+					std::string includeName;
+					if( parseInclude( line, includeName ) )
 					{
-						const char* a = strstr( line.c_str(), "<" );
-						const char* b = strstr( line.c_str(), ">" );
-						int n = b - a - 1;
-						memcpy( buf, a + 1, n );
-						buf[n] = '\0';
-						includes->push_back( buf );
+						includes->push_back( includeName );
 						sourceCode += line + '\n';
 					}
 					else
@@ -176,92 +302,249 @@ struct OrochiUtilsImpl
 		return false;
 	}
 
-	static void getCacheFileName( oroDevice device, const char* moduleName, const char* functionName, const char* options, std::string& binFileName, const std::string& cacheDirectory )
+	// returns true if the line is an #include directive, and the included name ( either <name> or "name" ).
+	static bool parseInclude( const std::string& line, std::string& includeName )
 	{
-		auto hashBin = []( const char* s, const size_t size )
-		{
-			unsigned int hash = 0;
+		size_t p = line.find_first_not_of( " \t" );
+		if( p == std::string::npos || line[p] != '#' ) return false;
+		p = line.find_first_not_of( " \t", p + 1 );
+		if( p == std::string::npos || line.compare( p, 7, "include" ) != 0 ) return false;
+		p = line.find_first_of( "<\"", p + 7 );
+		if( p == std::string::npos ) return false;
+		const size_t e = line.find( line[p] == '<' ? '>' : '"', p + 1 );
+		if( e == std::string::npos ) return false;
+		includeName = line.substr( p + 1, e - p - 1 );
+		return true;
+	}
 
-			for( unsigned int i = 0; i < size; ++i )
-			{
-				hash += *s++;
-				hash += ( hash << 10 );
-				hash ^= ( hash >> 6 );
-			}
+	struct Hash128
+	{
+		uint64_t m_h[2];
 
-			hash += ( hash << 3 );
-			hash ^= ( hash >> 11 );
-			hash += ( hash << 15 );
+		std::string toString() const
+		{
+			char buf[33];
+			snprintf( buf, sizeof( buf ), "%016llx%016llx", (unsigned long long)m_h[0], (unsigned long long)m_h[1] );
+			return buf;
+		}
+	};
 
-			return hash;
+	// MurmurHash3_x64_128 ( public domain, Austin Appleby )
+	static Hash128 hash128( const void* key, const size_t size, const uint64_t seed = 0 )
+	{
+		auto rotl = []( uint64_t x, int r ) { return ( x << r ) | ( x >> ( 64 - r ) ); };
+		auto fmix = []( uint64_t k )
+		{
+			k ^= k >> 33;
+			k *= 0xff51afd7ed558ccdull;
+			k ^= k >> 33;
+			k *= 0xc4ceb9fe1a85ec53ull;
+			k ^= k >> 33;
+			return k;
 		};
+		constexpr uint64_t c1 = 0x87c37b91114253d5ull;
+		constexpr uint64_t c2 = 0x4cf5ad432745937full;
+
+		const uint8_t* data = static_cast<const uint8_t*>( key );
+		const size_t nBlocks = size / 16;
+		uint64_t h1 = seed;
+		uint64_t h2 = seed;
 
-		auto hashString = [&]( const char* ss, const size_t size, char buf[9] )
+		for( size_t i = 0; i < nBlocks; i++ )
 		{
-			const unsigned int hash = hashBin( ss, size );
+			uint64_t k1, k2;
+			memcpy( &k1, data + i * 16, 8 );
+			memcpy( &k2, data + i * 16 + 8, 8 );
+
+			k1 *= c1;
+			k1 = rotl( k1, 31 );
+			k1 *= c2;
+			h1 ^= k1;
+			h1 = rotl( h1, 27 );
+			h1 += h2;
+			h1 = h1 * 5 + 0x52dce729;
+
+			k2 *= c2;
+			k2 = rotl( k2, 33 );
+			k2 *= c1;
+			h2 ^= k2;
+			h2 = rotl( h2, 31 );
+			h2 += h1;
+			h2 = h2 * 5 + 0x38495ab5;
+		}
 
-			sprintf( buf, "%08x", hash );
-		};
+		const uint8_t* tail = data + nBlocks * 16;
+		const size_t nTail = size & 15;
+		uint64_t k1 = 0;
+		uint64_t k2 = 0;
+		for( size_t i = nTail; i > 8; i-- )
+			k2 ^= uint64_t( tail[i - 1] ) << ( ( i - 9 ) * 8 );
+		for( size_t i = std::min<size_t>( nTail, 8 ); i > 0; i-- )
+			k1 ^= uint64_t( tail[i - 1] ) << ( ( i - 1 ) * 8 );
+		if( nTail > 8 )
+		{
+			k2 *= c2;
+			k2 = rotl( k2, 33 );
+			k2 *= c1;
+			h2 ^= k2;
+		}
+		if( nTail > 0 )
+		{
+			k1 *= c1;
+			k1 = rotl( k1, 31 );
+			k1 *= c2;
+			h1 ^= k1;
+		}
+
+		h1 ^= size;
+		h2 ^= size;
+		h1 += h2;
+		h2 += h1;
+		h1 = fmix( h1 );
+		h2 = fmix( h2 );
+		h1 += h2;
+		h2 += h1;
+		return { { h1, h2 } };
+	}
 
-		auto strip = []( const char* name, const char* pattern )
+	// append a length prefixed field, so that the concatenation of the fields is not ambiguous
+	static void appendKey( std::string& key, const std::string& field )
+	{
+		const uint64_t n = field.size();
+		key.append( reinterpret_cast<const char*>( &n ), sizeof( n ) );
+		key += field;
+	}
+
+	// remove what doesn't change the generated code ( include directories, as the content of the headers is hashed ). the remaining options
+	// keep their order, which matters to the compiler ( "-DA=1 -DA=2", "-UX -DX" ). an option and its value given as 2 separated strings ( "-D" "X" ) are merged first.
+	static std::vector<std::string> canonicalizeOptions( const std::vector<const char*>& opts, std::vector<std::string>* includeDirs )
+	{
+		std::vector<std::string> canonical;
+		for( size_t i = 0; i < opts.size(); i++ )
 		{
-			size_t const patlen = strlen( pattern );
-			size_t patcnt = 0;
-			const char* oriptr;
-			const char* patloc;
-			// find how many times the pattern occurs in the original string
-			for( oriptr = name; ( patloc = strstr( oriptr, pattern ) ); oriptr = patloc + patlen )
+			std::string o = opts[i] ? opts[i] : "";
+			const size_t first = o.find_first_not_of( " \t" );
+			const size_t last = o.find_last_not_of( " \t" );
+			o = ( first == std::string::npos ) ? std::string() : o.substr( first, last - first + 1 );
+			if( o.empty() ) continue;
+
+			if( ( o == "-I" || o == "-D" || o == "-U" || o == "-include" ) && i + 1 < opts.size() && opts[i + 1] )
+				o += opts[++i];
+
+			std::string dir;
+			if( o.compare( 0, 2, "-I" ) == 0 )
+				dir = o.substr( 2 );
+			else if( o.compare( 0, 15, "--include-path=" ) == 0 )
+				dir = o.substr( 15 );
+			else
 			{
-				patcnt++;
+				canonical.push_back( o );
+				continue;
 			}
-			return oriptr;
-		};
 
-		oroDeviceProp props;
-		oroGetDeviceProperties( &props, device );
+			if( includeDirs && !dir.empty() ) includeDirs->push_back( dir );
+		}
+		return canonical;
+	}
 
-		int v = 0;
-		oroDriverGetVersion( &v );
-		std::string deviceName = props.name;
-		std::string driverVersion = std::to_string( v );
-		char optionHash[9] = "0x0";
+	// a header given to the compiler, with the name used in the #include directive.
+	struct IncludeHeader
+	{
+		std::string name;
+		std::shared_ptr<const std::string> content;
+	};
 
-		if( moduleName && options )
+	// look up an included file on the disk, from the directory of the file including it then the include directories.
+	// returns false if it's not found ( system headers ).
+	static bool findInclude( const std::string& includeName, const std::filesystem::path& sourceDir, const std::vector<std::string>& includeDirs, std::filesystem::path& foundOut )
+	{
+		std::error_code ec;
+		if( !sourceDir.empty() && std::filesystem::is_regular_file( sourceDir / includeName, ec ) )
 		{
-			std::string tmp = moduleName;
-			tmp += options;
+			foundOut = ( sourceDir / includeName ).lexically_normal();
+			return true;
+		}
+		for( const std::string& dir : includeDirs )
+		{
+			if( std::filesystem::is_regular_file( std::filesystem::path( dir ) / includeName, ec ) )
+			{
+				foundOut = ( std::filesystem::path( dir ) / includeName ).lexically_normal();
+				return true;
+			}
+		}
+		return false;
+	}
 
-			hashString( tmp.c_str(), strlen( tmp.c_str() ), optionHash );
+	// the cache key is a hash of everything the binary depends on:
+	// the source, the content of the included headers, the compile options, the architecture and the runtime version.
+	// so the same build hits the cache regardless of where the source lives, and any change of a header misses it.
+	// headers are the whole include graph of the source ( see IncludeRegistry::resolve ), so making the key doesn't touch the disk.
+	// the architecture is left out of the material, so keys for several architectures can be made from the same material ( see getCacheKey ).
+	static std::string getCacheKeyMaterial( const char* code, const std::vector<const char*>& opts, const std::vector<IncludeHeader>& headers )
+	{
+		int rtcMajor = 0;
+		int rtcMinor = 0;
+		orortcVersion( &rtcMajor, &rtcMinor );
+		int runtimeVersion = 0;
+		const oroDeviceSnapshot* snapshot = oroGetDeviceSnapshot();
+		if( snapshot && oroGetCurAPI( 0 ) != ORO_API_HOST )
+			runtimeVersion = ( oroGetCurAPI( 0 ) & ORO_API_CUDADRIVER ) ? snapshot->cudaRuntimeVersion : snapshot->hipRuntimeVersion;
+		else
+			oroRuntimeGetVersion( &runtimeVersion );
+
+		std::string key;
+		appendKey( key, std::to_string( oroGetCurAPI( 0 ) ) + "." + std::to_string( 8 * sizeof( void* ) ) );
+		appendKey( key, std::to_string( rtcMajor ) + "." + std::to_string( rtcMinor ) + "." + std::to_string( runtimeVersion ) );
+		// the host backend builds with the C++ compiler of the environment ( see oroInitialize ).
+		if( oroGetCurAPI( 0 ) == ORO_API_HOST )
+		{
+			const char* cxx = getenv( "ORO_HOST_CXX" );
+			const char* flags = getenv( "ORO_HOST_CXXFLAGS" );
+			appendKey( key, std::string( cxx ? cxx : "" ) + " " + ( flags ? flags : "" ) );
 		}
 
-		char moduleHash[9] = "0x0";
-		const char* strippedModuleName = strip( moduleName, "\\" );
-		strippedModuleName = strip( strippedModuleName, "/" );
-		hashString( strippedModuleName, strlen( strippedModuleName ), moduleHash );
+		for( const std::string& o : canonicalizeOptions( opts, nullptr ) )
+			appendKey( key, o );
 
-		using namespace std::string_literals;
+		appendKey( key, code ? code : "" );
 
-		deviceName = deviceName.substr( 0, deviceName.find( ":" ) );
-		binFileName = cacheDirectory + "/"s + moduleHash + "-"s + optionHash + ".v."s + deviceName + "."s + driverVersion + "_"s + std::to_string( 8 * sizeof( void* ) ) + ".bin"s;
-		return;
+		for( const IncludeHeader& header : headers )
+		{
+			appendKey( key, header.name );
+			appendKey( key, *header.content );
+		}
+		return key;
 	}
-	static bool isFileUpToDate( const char* binaryFileName, const char* srcFileName )
-	{
-		FileStat b( binaryFileName );
 
-		if( !b.found() ) return false;
+	static Hash128 getCacheKey( const std::string& keyMaterial, const std::string& arch )
+	{
+		std::string key;
+		appendKey( key, arch );
+		key += keyMaterial;
+		return hash128( key.data(), key.size() );
+	}
 
-		FileStat s( srcFileName );
+	// gcnArchName on HIP ( with its features, like "gfx90a:sramecc+:xnack-" ), the device name and SM on CUDA.
+	static std::string getArchName( oroDevice device )
+	{
+		if( const char* arch = oroDeviceGetArchName( device ) )
+			return arch;
 
-		if( !s.found() )
-		{
-			//	todo. compare with exe time
-			return true;
-		}
+		oroDeviceProp props;
+		::memset( &props, 0, sizeof( props ) );
+		oroGetDeviceProperties( &props, device );
 
-		if( s.getTime() < b.getTime() ) return true;
+		std::string arch = props.gcnArchName;
+		if( arch.empty() )
+			arch = std::string( props.name ) + ".sm_" + std::to_string( props.major ) + std::to_string( props.minor );
+		return arch;
+	}
 
-		return false;
+	static std::string getCacheFileName( const char* path, const Hash128& key, const std::string& cacheDirectory )
+	{
+		std::string moduleName = path ? std::filesystem::path( path ).stem().string() : "module";
+		if( moduleName.empty() ) moduleName = "module";
+		return cacheDirectory + "/" + moduleName + "-" + key.toString() + ".bin";
 	}
 
 	static bool createDirectory( const char* cacheDirName )
@@ -285,114 +568,300 @@ struct OrochiUtilsImpl
 		return true;
 #endif
 	}
-	static std::string getCheckSumFileName( const std::string& binaryName )
+	// a cache entry is a single file: this header, then the binary at payloadOffset.
+	// the binary is aligned to a page so the mapped file can be given as is to oroModuleLoadData.
+	struct CacheFileHeader
+	{
+		static constexpr uint32_t MAGIC = 0x434f524f; // "OROC"
+		static constexpr uint32_t VERSION = 3;
+		static constexpr uint64_t PAYLOAD_ALIGNMENT = 4096;
+		// the last access time is only rewritten when it's older than this, so hits don't write to the disk every time.
+		static constexpr uint64_t LAST_ACCESS_GRANULARITY = 60;
+
+		uint32_t m_magic;
+		uint32_t m_version;
+		Hash128 m_key;
+		uint64_t m_payloadOffset;
+		uint64_t m_payloadSize;
+		uint64_t m_checksum;
+		uint64_t m_lastAccess;		 // seconds since epoch, used for the LRU eviction
+		uint64_t m_loweredNamesSize; // the lowered names of the name expressions, '\0' separated, stored between the header and the payload
+	};
+
+	static uint64_t checksum( const void* data, size_t size ) { return hash128( data, size ).m_h[0]; }
+
+	static double elapsedMs( std::chrono::steady_clock::time_point start ) { return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count(); }
+
+	static uint64_t now() { return std::chrono::duration_cast<std::chrono::seconds>( std::chrono::system_clock::now().time_since_epoch() ).count(); }
+
+	static FILE* openFile( const std::string& fileName, const char* mode )
+	{
+#if defined( _WIN32 )
+		std::wstring fileNameW = utf8_to_wstring( fileName );
+		std::wstring modeW = utf8_to_wstring( mode );
+		return _wfopen( fileNameW.c_str(), modeW.c_str() );
+#else
+		return fopen( fileName.c_str(), mode );
+#endif
+	}
+
+	static bool readCacheFileHeader( const std::string& cacheName, CacheFileHeader& header )
 	{
-		const std::string dst = binaryName + ".check";
-		return dst;
+		FILE* file = openFile( cacheName, "rb" );
+		if( !file ) return false;
+		const bool success = fread( &header, sizeof( CacheFileHeader ), 1, file ) == 1;
+		fclose( file );
+		return success && header.m_magic == CacheFileHeader::MAGIC && header.m_version == CacheFileHeader::VERSION;
 	}
-	static inline long long checksum( const char* data, long long size )
+
+	// record the access in the header of the entry, the payload and its checksum are untouched.
+	static void touchCacheFile( const std::string& cacheName )
 	{
-		unsigned int hash = 0;
+		FILE* file = openFile( cacheName, "r+b" );
+		if( !file ) return;
+		const uint64_t t = now();
+		if( fseek( file, offsetof( CacheFileHeader, m_lastAccess ), SEEK_SET ) == 0 ) fwrite( &t, sizeof( uint64_t ), 1, file );
+		fclose( file );
+	}
 
-		for( unsigned int i = 0; i < size; ++i )
+	// returns a pointer to the binary inside the mapped file, or nullptr if the entry is missing, from an other version or corrupted.
+	// if the file exists but can't be used, staleReasonOut tells why.
+	static const char* getCacheFileBinary( const MappedFile& file, const Hash128& key, size_t* binarySizeOut = nullptr, uint64_t* lastAccessOut = nullptr, std::vector<std::string>* loweredNamesOut = nullptr, const char** staleReasonOut = nullptr )
+	{
+		auto stale = [staleReasonOut]( const char* reason ) -> const char*
 		{
-			hash += *data++;
-			hash += ( hash << 10 );
-			hash ^= ( hash >> 6 );
-		}
+			if( staleReasonOut ) *staleReasonOut = reason;
+			return nullptr;
+		};
+
+		if( !file.found() ) return nullptr;
+		if( file.size() < sizeof( CacheFileHeader ) ) return stale( "truncated" );
 
-		hash += ( hash << 3 );
-		hash ^= ( hash >> 11 );
-		hash += ( hash << 15 );
+		CacheFileHeader header;
+		memcpy( &header, file.data(), sizeof( CacheFileHeader ) );
+		if( header.m_magic != CacheFileHeader::MAGIC || header.m_version != CacheFileHeader::VERSION ) return stale( "version" );
+		if( header.m_key.m_h[0] != key.m_h[0] || header.m_key.m_h[1] != key.m_h[1] ) return stale( "key" );
+		if( lastAccessOut ) *lastAccessOut = header.m_lastAccess;
+		if( header.m_payloadOffset < sizeof( CacheFileHeader ) || header.m_payloadOffset > file.size() || header.m_payloadSize > file.size() - header.m_payloadOffset ) return stale( "truncated" );
+		if( header.m_loweredNamesSize > header.m_payloadOffset - sizeof( CacheFileHeader ) ) return stale( "truncated" );
 
-		return hash;
+		const char* binary = file.data() + header.m_payloadOffset;
+		const uint64_t s = checksum( binary, header.m_payloadSize );
+		if( s != header.m_checksum )
+		{
+			printf( "checksum doesn't match %llx : %llx\n", (unsigned long long)s, (unsigned long long)header.m_checksum );
+			return stale( "checksum" );
+		}
+		if( binarySizeOut ) *binarySizeOut = header.m_payloadSize;
+		if( loweredNamesOut )
+		{
+			loweredNamesOut->clear();
+			const char* names = file.data() + sizeof( CacheFileHeader );
+			for( size_t i = 0; i < header.m_loweredNamesSize; i += loweredNamesOut->back().size() + 1 )
+				loweredNamesOut->emplace_back( names + i, strnlen( names + i, header.m_loweredNamesSize - i ) );
+		}
+		return binary;
 	}
 
-	static int loadCacheFileToBinary( const std::string& cacheName, std::vector<char>& binaryOut )
+	// the entry is written to a temporary file first and then renamed, so a reader never sees a partially written entry.
+	static bool cacheBinaryToFile( const char* binary, size_t binarySize, const Hash128& key, const std::string& cacheName, const std::vector<std::string>& loweredNames = {} )
 	{
-		long long checksumValue = 0;
-		{
-			const std::string csFileName = getCheckSumFileName( cacheName );
+		std::string names;
+		for( const std::string& name : loweredNames )
+			names.append( name.c_str(), name.size() + 1 );
+
+		CacheFileHeader header;
+		::memset( &header, 0, sizeof( CacheFileHeader ) );
+		header.m_magic = CacheFileHeader::MAGIC;
+		header.m_version = CacheFileHeader::VERSION;
+		header.m_key = key;
+		header.m_loweredNamesSize = names.size();
+		header.m_payloadOffset = ( sizeof( CacheFileHeader ) + names.size() + CacheFileHeader::PAYLOAD_ALIGNMENT - 1 ) / CacheFileHeader::PAYLOAD_ALIGNMENT * CacheFileHeader::PAYLOAD_ALIGNMENT;
+		header.m_payloadSize = binarySize;
+		header.m_checksum = checksum( binary, binarySize );
+		header.m_lastAccess = now();
+
+		static std::atomic<uint32_t> s_tmpIndex{ 0 };
 #if defined( _WIN32 )
-			std::wstring csFileNameW = utf8_to_wstring( csFileName );
-			FILE* csfile = _wfopen( csFileNameW.c_str(), L"rb" );
+		const unsigned long pid = GetCurrentProcessId();
 #else
-			FILE* csfile = fopen( csFileName.c_str(), "rb" );
+		const unsigned long pid = getpid();
 #endif
-			if( csfile )
-			{
-				fread( &checksumValue, sizeof( long long ), 1, csfile );
-				fclose( csfile );
-			}
-		}
+		const std::string tmpName = cacheName + ".tmp" + std::to_string( pid ) + "_" + std::to_string( s_tmpIndex++ );
 
-		if( checksumValue == 0 ) return 0;
+		FILE* file = openFile( tmpName, "wb" );
+		if( !file ) return false;
 
-#if defined( _WIN32 )
-		std::wstring binaryFileNameW = utf8_to_wstring( cacheName );
-		FILE* file = _wfopen( binaryFileNameW.c_str(), L"rb" );
-#else
-		FILE* file = fopen( cacheName.c_str(), "rb" );
-#endif
-		if( file )
+		const std::vector<char> padding( header.m_payloadOffset - sizeof( CacheFileHeader ) - names.size(), 0 );
+		bool success = fwrite( &header, sizeof( CacheFileHeader ), 1, file ) == 1;
+		success = success && fwrite( names.data(), 1, names.size(), file ) == names.size();
+		success = success && fwrite( padding.data(), 1, padding.size(), file ) == padding.size();
+		success = success && fwrite( binary, 1, binarySize, file ) == binarySize;
+		success = ( fclose( file ) == 0 ) && success;
+
+		std::error_code ec;
+		if( success )
+		{
+			std::filesystem::rename( std::filesystem::u8path( tmpName ), std::filesystem::u8path( cacheName ), ec );
+			success = !ec;
+		}
+		if( !success )
 		{
-			fseek( file, 0L, SEEK_END );
-			size_t binarySize = ftell( file );
-			rewind( file );
+			std::filesystem::remove( std::filesystem::u8path( tmpName ), ec );
+			return false;
+		}
+#ifdef _DEBUG
+		printf( "Cached file created %s\n", cacheName.c_str() );
+#endif
+		return true;
+	}
+
+	static std::string getLockFileName( const std::string& cacheName ) { return cacheName + ".lock"; }
+
+	struct CacheEntry
+	{
+		std::filesystem::path path;
+		uint64_t size;
+		uint64_t lastAccess;
+	};
+
+	// the age after which a temporary file is left by a writer which crashed, and a lock file without entry is unused.
+	static constexpr int64_t STALE_FILE_SECONDS = 3600;
 
-			binaryOut.resize( binarySize );
-			size_t dummy = fread( const_cast<char*>( binaryOut.data() ), sizeof( char ), binarySize, file );
-			fclose( file );
+	// a temporary file ( see cacheBinaryToFile ) or a lock file whose entry doesn't exist, older than STALE_FILE_SECONDS.
+	// removing a lock file an other process still waits for only lets 2 processes build the same entry, which is written atomically.
+	static bool isStaleCacheFile( const std::filesystem::directory_entry& file )
+	{
+		const std::string name = file.path().filename().u8string();
+		const bool tmp = name.find( ".bin.tmp" ) != std::string::npos;
+		const bool lock = file.path().extension() == ".lock";
+		if( !tmp && !lock ) return false;
+
+		std::error_code ec;
+		const auto age = std::filesystem::file_time_type::clock::now() - file.last_write_time( ec );
+		if( ec || std::chrono::duration_cast<std::chrono::seconds>( age ).count() < STALE_FILE_SECONDS ) return false;
+		if( lock )
+		{
+			std::filesystem::path entry = file.path();
+			entry.replace_extension();
+			return !std::filesystem::exists( entry, ec ) && !ec;
+		}
+		return true;
+	}
 
-			long long s = checksum( binaryOut.data(), binarySize );
-			if( s != checksumValue )
+	// the entries of the cache directory. an entry without a valid header ( older version ) uses its modification time.
+	// with removeStale, the stale temporary and lock files are removed on the way, so they don't pile up in the directory.
+	static std::vector<CacheEntry> getCacheEntries( const std::string& cacheDirectory, bool removeStale = false )
+	{
+		std::vector<CacheEntry> entries;
+		std::error_code ec;
+		for( std::filesystem::directory_iterator it( std::filesystem::u8path( cacheDirectory ), ec ), end; !ec && it != end; it.increment( ec ) )
+		{
+			if( !it->is_regular_file( ec ) ) continue;
+			if( removeStale && isStaleCacheFile( *it ) )
 			{
-				printf( "checksum doesn't match %llx : %llx\n", s, checksumValue );
-				return 0;
+				std::error_code removeEc;
+				std::filesystem::remove( it->path(), removeEc );
+				continue;
 			}
+			if( it->path().extension() != ".bin" ) continue;
+
+			CacheEntry entry;
+			entry.path = it->path();
+			entry.size = it->file_size( ec );
+			if( ec ) continue;
+
+			CacheFileHeader header;
+			if( readCacheFileHeader( entry.path.u8string(), header ) )
+				entry.lastAccess = header.m_lastAccess;
+			else
+				entry.lastAccess = std::chrono::duration_cast<std::chrono::seconds>( it->last_write_time( ec ).time_since_epoch() ).count();
+			entries.push_back( entry );
 		}
-		return 0;
+		return entries;
 	}
 
-	static int cacheBinaryToFile( std::vector<char> binary, const std::string& cacheName )
+	// called after writing the entry keep: remove the least recently used entries until the directory fits in the budget ( 0 means no limit ). keep is never removed.
+	// the directory is only scanned when the size known by this process goes over the budget. the lock files of the entries stay, an other process may hold them,
+	// the stale temporary and lock files are removed by the scan ( see isStaleCacheFile ).
+	// returns the number of removed entries.
+	static size_t enforceCacheBudget( OrochiUtils& utils, const std::string& keep )
 	{
-		const size_t binarySize = binary.size();
+		const uint64_t maxBytes = utils.m_cacheMaxBytes;
+		const size_t maxEntries = utils.m_cacheMaxEntries;
+		if( maxBytes == 0 && maxEntries == 0 ) return 0;
+
+		std::lock_guard<std::mutex> lock( utils.m_cacheUsageMutex );
+		OrochiUtils::CacheUsage& usage = utils.m_cacheUsage;
+		if( usage.directory == utils.m_cacheDirectory )
 		{
-#ifdef WIN32
-			std::wstring binaryFileNameW = utf8_to_wstring( cacheName );
-			FILE* file = _wfopen( binaryFileNameW.c_str(), L"wb" );
-#else
-			FILE* file = fopen( cacheName.c_str(), "wb" );
-#endif
+			std::error_code ec;
+			usage.bytes += std::filesystem::file_size( std::filesystem::u8path( keep ), ec );
+			usage.entries++;
+			if( !( maxBytes && usage.bytes > maxBytes ) && !( maxEntries && usage.entries > maxEntries ) ) return 0;
+		}
 
-			if( file )
-			{
-#ifdef _DEBUG
-				printf( "Cached file created %s\n", cacheName.c_str() );
-#endif
-				fwrite( binary.data(), sizeof( char ), binarySize, file );
-				fclose( file );
-			}
+		std::vector<CacheEntry> entries = getCacheEntries( utils.m_cacheDirectory, true );
+		uint64_t totalBytes = 0;
+		for( const CacheEntry& entry : entries )
+			totalBytes += entry.size;
+
+		usage.directory = utils.m_cacheDirectory;
+		usage.bytes = totalBytes;
+		usage.entries = entries.size();
+		auto overBudget = [&]() { return ( maxBytes && totalBytes > maxBytes ) || ( maxEntries && entries.size() > maxEntries ); };
+		if( !overBudget() ) return 0;
+
+		std::sort( entries.begin(), entries.end(), []( const CacheEntry& a, const CacheEntry& b ) { return a.lastAccess > b.lastAccess; } );
+
+		std::error_code ec;
+		const std::filesystem::path keepPath = std::filesystem::u8path( keep );
+		size_t removed = 0;
+		for( size_t i = entries.size(); i > 0 && overBudget(); i-- )
+		{
+			const CacheEntry entry = entries[i - 1];
+			if( std::filesystem::equivalent( entry.path, keepPath, ec ) ) continue;
+			entries.erase( entries.begin() + ( i - 1 ) );
+			if( !std::filesystem::remove( entry.path, ec ) ) continue;
+			totalBytes -= entry.size;
+			removed++;
 		}
+		usage.bytes = totalBytes;
+		usage.entries = entries.size();
+		return removed;
+	}
 
-		long long s = checksum( const_cast<char*>( binary.data() ), binarySize );
-		const std::string filename = getCheckSumFileName( cacheName );
+	// the entry of the cache directory for key, or the output of build stored as a new entry.
+	// like the code objects ( see OrochiUtils::getFunctions ), a missing entry is built by only one process at a time.
+	static bool getCacheEntry( OrochiUtils& utils, const std::string& cacheFile, const Hash128& key, const std::function<bool( std::vector<char>& )>& build, std::vector<char>& binaryOut )
+	{
+		auto mapped = std::make_unique<MappedFile>( cacheFile.c_str() );
+		size_t size = 0;
+		uint64_t lastAccess = 0;
+		const char* binary = getCacheFileBinary( *mapped, key, &size, &lastAccess );
 
+		std::unique_ptr<FileLock> lock;
+		if( !binary )
 		{
-#ifdef WIN32
-			std::wstring filenameW = utf8_to_wstring( filename );
-			FILE* file = _wfopen( filenameW.c_str(), L"wb" );
-#else
-			FILE* file = fopen( filename.c_str(), "wb" );
-#endif
+			createDirectory( utils.m_cacheDirectory.c_str() );
+			lock = std::make_unique<FileLock>( getLockFileName( cacheFile ).c_str() );
+			mapped = std::make_unique<MappedFile>( cacheFile.c_str() );
+			binary = getCacheFileBinary( *mapped, key, &size, &lastAccess );
+		}
 
-			if( file )
-			{
-				fwrite( &s, sizeof( long long ), 1, file );
-				fclose( file );
-			}
+		if( binary )
+		{
+			utils.m_cacheHits++;
+			if( now() > lastAccess + CacheFileHeader::LAST_ACCESS_GRANULARITY ) touchCacheFile( cacheFile );
+			binaryOut.assign( binary, binary + size );
+			return true;
 		}
-		return 0;
+
+		utils.m_cacheMisses++;
+		if( !build( binaryOut ) || binaryOut.empty() ) return false;
+		if( cacheBinaryToFile( binaryOut.data(), binaryOut.size(), key, cacheFile ) )
+			utils.m_cacheEvictions += enforceCacheBudget( utils, cacheFile );
+		return true;
 	}
 
 	static std::string getCacheName( const std::string& path, const std::string& kernelname, std::vector<const char*>* opts ) noexcept
@@ -411,88 +880,356 @@ struct OrochiUtilsImpl
 	}
 
 	static std::string getCacheName( const std::string& path, const std::string& kernelname ) noexcept { return path + kernelname; }
-};
 
-void OrochiUtils::unloadKernelCache() 
-{
-	for ( auto& instance : m_kernelMap ) 
+	static oroCtx getCurrentContext()
 	{
-		oroError e = oroModuleUnload( instance.second.module );
-		OROASSERT( e == oroSuccess, 0 );
+		oroCtx ctx = nullptr;
+		oroCtxGetCurrent( &ctx );
+		return ctx;
 	}
-	m_kernelMap.clear();
-	return;
-}
 
-OrochiUtils::~OrochiUtils() 
-{
-	// it's safer to not call unloadKernelCache automatically in the destructor ( better to have a leak than manipulating bad pointers )
-	// Just inform the developer.
-	if ( m_kernelMap.size() > 0 )
-		printf("Warning: OrochiUtils::unloadKernelCache should be called for good practice.\n");
-}
+	// the modules, and so the functions, belong to the context current on the calling thread.
+	// the contexts created outside of Orochi ( the primary context after oroSetDevice ) are unknown to oroCtxGetCurrent, so they are told apart by their device.
+	static std::string getContextKey( oroCtx ctx )
+	{
+		if( ctx ) return std::to_string( reinterpret_cast<uintptr_t>( ctx ) );
+		int device = -1;
+		oroCtxGetDevice( &device );
+		return "device" + std::to_string( device );
+	}
 
-// setup a base option list used in OrochiUtils 
-void SetupCompileOptions(
-	oroDevice device, 
-	const std::vector<const char*>* optsIn, 
-	std::string* optionalArchitectureTarget, // if this string is given, it must stay alive until it's used into orortcCompileProgram. ( otherwise its "c_str()" becomes an invalid pointer )
-	std::vector<const char*>& opts
-	)
+	static std::string getKernelKey( const std::string& path, const std::string& kernelname, std::vector<const char*>* opts, const std::string& contextKey ) { return getCacheName( path, kernelname, opts ) + '@' + contextKey; }
+};
+
+// the content of the headers, given to the compiler through numHeaders/headers/includeNames instead of being searched in the include directories.
+// headers are either registered by their include name ( registerInclude ), or read from the disk the first time a kernel includes them.
+class OrochiUtils::IncludeRegistry
 {
-	opts.push_back( "-std=c++17" );
+  public:
+	using Header = OrochiUtilsImpl::IncludeHeader;
 
-	if( optionalArchitectureTarget && oroGetCurAPI( 0 ) == ORO_API_HIP )
+	void add( const std::string& includeName, const std::string& content )
+	{
+		std::unique_lock<std::shared_mutex> lock( m_mutex );
+		m_registered[includeName] = std::make_shared<const std::string>( content );
+	}
+
+	// the content of a source file, only read once. nullptr if not found.
+	std::shared_ptr<const std::string> getSource( const std::string& path )
 	{
-		oroDeviceProp props;
-		::memset(&props,0,sizeof(props));
-		oroGetDeviceProperties( &props, device );
-		if ( props.gcnArchName && props.gcnArchName[0] != '\0' )
 		{
-			*optionalArchitectureTarget = "--gpu-architecture=";
-			*optionalArchitectureTarget += props.gcnArchName;
-			opts.push_back( optionalArchitectureTarget->c_str() );
+			std::shared_lock<std::shared_mutex> lock( m_mutex );
+			auto it = m_sources.find( path );
+			if( it != m_sources.end() ) return it->second;
 		}
+
+		std::string source;
+		if( !OrochiUtilsImpl::readSourceCode( path, source, nullptr ) ) return nullptr;
+
+		std::unique_lock<std::shared_mutex> lock( m_mutex );
+		return m_sources.emplace( path, std::make_shared<const std::string>( std::move( source ) ) ).first->second;
 	}
 
-	if( optsIn )
+	// forget what was read from the disk, so the files are read again by the next compilations. the registered headers are kept.
+	void clearFiles()
 	{
-		for( int i = 0; i < optsIn->size(); i++ )
-			opts.push_back( ( *optsIn )[i] );
+		std::unique_lock<std::shared_mutex> lock( m_mutex );
+		m_sources.clear();
+		m_files.clear();
 	}
-}
-
-// base program compilation, used in several components of OrochiUtils
-// returns 0 if success.
-// if fails, returns a non-zero value
-int CreateAndCompileProgram(const char* code, const char* programName, std::vector<const char*>& opts, const char* nameExpression, 
-							int numHeaders, const char** headers, const char** includeNames,
-							orortcProgram* prog)
-{
-	orortcResult e;
-	e = orortcCreateProgram( prog, code, programName, numHeaders, headers, includeNames );
 
-	if ( nameExpression )
-		e = orortcAddNameExpression( *prog, nameExpression );
-
-	e = orortcCompileProgram( *prog, static_cast<int>( opts.size() ), opts.data() );
-	if( e != ORORTC_SUCCESS )
+	// every header reachable from source, in include order.
+	// an include name is looked up in the given headers, then in the registered ones, then on the disk. the names found nowhere are left to the compiler.
+	std::vector<Header> resolve( const std::string& source, const char* path, const std::vector<std::string>& includeDirs, int numHeaders, const char** headers, const char** includeNames )
 	{
-		std::cout << "ERROR: orortcCompileProgram failed with log:\n";
-		size_t logSize = 0;
-		orortcGetProgramLogSize( *prog, &logSize );
-		if( logSize )
+		std::unordered_map<std::string, std::shared_ptr<const std::string>> given;
+		for( int i = 0; i < numHeaders; i++ )
 		{
-			std::string log( logSize, '\0' );
-			orortcGetProgramLog( *prog, &log[0] );
-			std::cout << log << '\n';
-		}
-		else
-		{
-			std::cout << "<NO LOG>\n";
+			if( headers && headers[i] && includeNames && includeNames[i] ) given.emplace( includeNames[i], std::make_shared<const std::string>( headers[i] ) );
 		}
 
-		// Even if orortcCompileProgram failed, let's return 'success' because there's a known issue where this function returns ORORTC_ERROR_COMPILATION even though the program might have been compiled correctly.
+		std::string dirsKey;
+		for( const std::string& dir : includeDirs )
+			OrochiUtilsImpl::appendKey( dirsKey, dir );
+
+		std::vector<Header> resolved;
+		std::unordered_set<std::string> visited;
+		const std::filesystem::path sourceDir = path ? std::filesystem::path( path ).parent_path() : std::filesystem::path();
+		resolve( source, sourceDir, includeDirs, dirsKey, given, visited, resolved );
+		return resolved;
+	}
+
+  private:
+	struct File
+	{
+		std::shared_ptr<const std::string> content; // nullptr if not found on the disk
+		std::filesystem::path dir;
+	};
+
+	void resolve( const std::string& source, const std::filesystem::path& sourceDir, const std::vector<std::string>& includeDirs, const std::string& dirsKey, const std::unordered_map<std::string, std::shared_ptr<const std::string>>& given,
+				  std::unordered_set<std::string>& visited, std::vector<Header>& resolved )
+	{
+		size_t pos = 0;
+		while( pos < source.size() )
+		{
+			size_t end = source.find( '\n', pos );
+			if( end == std::string::npos ) end = source.size();
+			const std::string line = source.substr( pos, end - pos );
+			pos = end + 1;
+
+			std::string includeName;
+			if( !OrochiUtilsImpl::parseInclude( line, includeName ) ) continue;
+
+			// the compiler matches the headers by name, so a name is resolved only once per source.
+			if( !visited.insert( includeName ).second ) continue;
+
+			// the includes of an in-memory header are searched where the header would be on the disk.
+			std::filesystem::path dir = ( sourceDir / includeName ).parent_path();
+			std::shared_ptr<const std::string> content;
+			auto it = given.find( includeName );
+			if( it != given.end() )
+				content = it->second;
+			else
+				content = findRegistered( includeName );
+
+			if( !content )
+			{
+				const File file = findFile( includeName, sourceDir, includeDirs, dirsKey );
+				content = file.content;
+				dir = file.dir;
+			}
+			if( !content ) continue;
+
+			resolved.push_back( { includeName, content } );
+			resolve( *content, dir, includeDirs, dirsKey, given, visited, resolved );
+		}
+	}
+
+	std::shared_ptr<const std::string> findRegistered( const std::string& includeName )
+	{
+		std::shared_lock<std::shared_mutex> lock( m_mutex );
+		auto it = m_registered.find( includeName );
+		return ( it != m_registered.end() ) ? it->second : nullptr;
+	}
+
+	// the lookups are remembered, including the misses, so the disk is only searched the first time.
+	File findFile( const std::string& includeName, const std::filesystem::path& sourceDir, const std::vector<std::string>& includeDirs, const std::string& dirsKey )
+	{
+		std::string key = dirsKey;
+		OrochiUtilsImpl::appendKey( key, sourceDir.string() );
+		OrochiUtilsImpl::appendKey( key, includeName );
+		{
+			std::shared_lock<std::shared_mutex> lock( m_mutex );
+			auto it = m_files.find( key );
+			if( it != m_files.end() ) return it->second;
+		}
+
+		File file;
+		std::filesystem::path found;
+		std::string content;
+		if( OrochiUtilsImpl::findInclude( includeName, sourceDir, includeDirs, found ) && OrochiUtilsImpl::readSourceCode( found.string(), content, nullptr ) )
+		{
+			file.content = std::make_shared<const std::string>( std::move( content ) );
+			file.dir = found.parent_path();
+		}
+
+		std::unique_lock<std::shared_mutex> lock( m_mutex );
+		return m_files.emplace( key, file ).first->second;
+	}
+
+	std::shared_mutex m_mutex;
+	std::unordered_map<std::string, std::shared_ptr<const std::string>> m_registered; // by include name
+	std::unordered_map<std::string, File> m_files;									   // by include directories, including directory and include name
+	std::unordered_map<std::string, std::shared_ptr<const std::string>> m_sources;	   // by path
+};
+
+void OrochiUtils::unloadKernelCache() 
+{
+	std::unique_lock<std::shared_mutex> lock( m_kernelMapMutex );
+
+	// each module is unloaded in the context it was loaded in.
+	const oroCtx current = OrochiUtilsImpl::getCurrentContext();
+	auto unload = [current]( oroModule module, oroCtx context )
+	{
+		if( context && context != current ) oroCtxSetCurrent( context );
+		oroError e = oroModuleUnload( module );
+		OROASSERT( e == oroSuccess, 0 );
+		if( context && context != current && current ) oroCtxSetCurrent( current );
+	};
+
+	// several functions can share the same module ( see getFunctions ), so make sure each module is unloaded only once.
+	std::unordered_set<oroModule> modules;
+	for ( auto& instance : m_kernelMap ) 
+	{
+		// the functions from precompiled binaries don't own their module, see getPrecompiledModule.
+		if( !instance.second.module || !modules.insert( instance.second.module ).second ) continue;
+		unload( instance.second.module, instance.second.context );
+	}
+	m_kernelMap.clear();
+
+	std::lock_guard<std::mutex> binaryLock( m_binaryModulesMutex );
+	for( auto& instance : m_binaryModules )
+		unload( instance.second.module, instance.second.context );
+	m_binaryModules.clear();
+	m_binaryFiles.clear();
+
+	m_includeRegistry->clearFiles();
+
+	// the variants are in m_kernelMap, so they were just unloaded.
+	std::lock_guard<std::mutex> specializationLock( m_specializationsMutex );
+	for( auto& specialization : m_specializations )
+	{
+		specialization.second.variants.clear();
+		specialization.second.stableCalls = 0;
+	}
+	return;
+}
+
+void OrochiUtils::registerInclude( const std::string& includeName, const std::string& content ) { m_includeRegistry->add( includeName, content ); }
+
+void OrochiUtils::registerIncludes( int numHeaders, const char** headers, const char** includeNames )
+{
+	for( int i = 0; i < numHeaders; i++ )
+	{
+		if( headers[i] && includeNames[i] ) m_includeRegistry->add( includeNames[i], headers[i] );
+	}
+}
+
+// fixed set of threads running the tasks in the order they are pushed.
+class OrochiUtils::WorkerPool
+{
+  public:
+	explicit WorkerPool( unsigned int numThreads )
+	{
+		for( unsigned int i = 0; i < numThreads; i++ )
+			m_threads.emplace_back( [this]() { run(); } );
+	}
+
+	// the tasks already pushed are all executed before the threads exit
+	~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			m_stop = true;
+		}
+		m_condition.notify_all();
+		for( std::thread& t : m_threads )
+			t.join();
+	}
+
+	void push( std::function<void()> task )
+	{
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			m_tasks.push_back( std::move( task ) );
+		}
+		m_condition.notify_one();
+	}
+
+  private:
+	void run()
+	{
+		while( true )
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock( m_mutex );
+				m_condition.wait( lock, [this]() { return m_stop || !m_tasks.empty(); } );
+				if( m_tasks.empty() ) return;
+				task = std::move( m_tasks.front() );
+				m_tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::deque<std::function<void()>> m_tasks;
+	bool m_stop = false;
+	std::vector<std::thread> m_threads;
+};
+
+OrochiUtils::OrochiUtils() : m_includeRegistry( std::make_unique<IncludeRegistry>() ) {}
+
+OrochiUtils::~OrochiUtils() 
+{
+	m_workerPool.reset();
+
+	if( !m_telemetryFile.empty() ) writeTelemetry( m_telemetryFile );
+
+	// it's safer to not call unloadKernelCache automatically in the destructor ( better to have a leak than manipulating bad pointers )
+	// Just inform the developer.
+	if ( m_kernelMap.size() > 0 )
+		printf("Warning: OrochiUtils::unloadKernelCache should be called for good practice.\n");
+}
+
+// setup a base option list used in OrochiUtils 
+void SetupCompileOptions(
+	oroDevice device, 
+	const std::vector<const char*>* optsIn, 
+	std::string* optionalArchitectureTarget, // if this string is given, it must stay alive until it's used into orortcCompileProgram. ( otherwise its "c_str()" becomes an invalid pointer )
+	std::vector<const char*>& opts
+	)
+{
+	opts.push_back( "-std=c++17" );
+
+	if( optionalArchitectureTarget && oroGetCurAPI( 0 ) == ORO_API_HIP )
+	{
+		const char* arch = oroDeviceGetArchName( device );
+		oroDeviceProp props;
+		if( !arch )
+		{
+			::memset(&props,0,sizeof(props));
+			oroGetDeviceProperties( &props, device );
+			arch = props.gcnArchName;
+		}
+		if ( arch[0] != '\0' )
+		{
+			*optionalArchitectureTarget = "--gpu-architecture=";
+			*optionalArchitectureTarget += arch;
+			opts.push_back( optionalArchitectureTarget->c_str() );
+		}
+	}
+
+	if( optsIn )
+	{
+		for( int i = 0; i < optsIn->size(); i++ )
+			opts.push_back( ( *optsIn )[i] );
+	}
+}
+
+// base program compilation, used in several components of OrochiUtils
+// returns 0 if success.
+// if fails, returns a non-zero value
+int CreateAndCompileProgram(const char* code, const char* programName, std::vector<const char*>& opts, const std::vector<const char*>& nameExpressions, 
+							int numHeaders, const char** headers, const char** includeNames,
+							orortcProgram* prog)
+{
+	orortcResult e;
+	e = orortcCreateProgram( prog, code, programName, numHeaders, headers, includeNames );
+
+	for( const char* nameExpression : nameExpressions )
+		e = orortcAddNameExpression( *prog, nameExpression );
+
+	e = orortcCompileProgram( *prog, static_cast<int>( opts.size() ), opts.data() );
+	if( e != ORORTC_SUCCESS )
+	{
+		std::cout << "ERROR: orortcCompileProgram failed with log:\n";
+		size_t logSize = 0;
+		orortcGetProgramLogSize( *prog, &logSize );
+		if( logSize )
+		{
+			std::string log( logSize, '\0' );
+			orortcGetProgramLog( *prog, &log[0] );
+			std::cout << log << '\n';
+		}
+		else
+		{
+			std::cout << "<NO LOG>\n";
+		}
+
+		// Even if orortcCompileProgram failed, let's return 'success' because there's a known issue where this function returns ORORTC_ERROR_COMPILATION even though the program might have been compiled correctly.
 		//    ( example with Orochi Unit Test:  TEST_F( OroTestBase, link )   )
 		// The failure check is done at a higher level in functions like 'orortcGetBitcodeSize', so we won't miss any actual errors.
 		return 0;
@@ -500,6 +1237,184 @@ int CreateAndCompileProgram(const char* code, const char* programName, std::vect
 	return 0; // success code
 }
 
+// A cache bundle is a single read-only file holding many cache entries, built offline:
+// a header, the index of the entries, then the binaries, each aligned to a page.
+struct CacheBundleHeader
+{
+	static constexpr uint32_t MAGIC = 0x424f524f; // "OROB"
+	static constexpr uint32_t VERSION = 1;
+
+	uint32_t m_magic;
+	uint32_t m_version;
+	uint64_t m_numEntries;
+	// followed by m_numEntries CacheBundleIndex
+};
+
+struct CacheBundleIndex
+{
+	OrochiUtilsImpl::Hash128 m_key;
+	uint64_t m_offset;
+	uint64_t m_size;
+	uint64_t m_checksum;
+};
+
+class OrochiUtils::CacheBundle
+{
+  public:
+	CacheBundle( const std::string& path ) : m_file( path.c_str() ) {}
+
+	bool parse()
+	{
+		if( !m_file.found() || m_file.size() < sizeof( CacheBundleHeader ) ) return false;
+
+		CacheBundleHeader header;
+		memcpy( &header, m_file.data(), sizeof( CacheBundleHeader ) );
+		if( header.m_magic != CacheBundleHeader::MAGIC || header.m_version != CacheBundleHeader::VERSION ) return false;
+		if( header.m_numEntries > ( m_file.size() - sizeof( CacheBundleHeader ) ) / sizeof( CacheBundleIndex ) ) return false;
+
+		for( uint64_t i = 0; i < header.m_numEntries; i++ )
+		{
+			CacheBundleIndex index;
+			memcpy( &index, m_file.data() + sizeof( CacheBundleHeader ) + i * sizeof( CacheBundleIndex ), sizeof( CacheBundleIndex ) );
+			if( index.m_offset > m_file.size() || index.m_size > m_file.size() - index.m_offset ) return false;
+			m_entries[index.m_key.toString()] = index;
+		}
+		return true;
+	}
+
+	// the entries are checked only once they are used
+	const char* find( const std::string& key, size_t* sizeOut )
+	{
+		auto it = m_entries.find( key );
+		if( it == m_entries.end() ) return nullptr;
+
+		const char* binary = m_file.data() + it->second.m_offset;
+		if( OrochiUtilsImpl::checksum( binary, it->second.m_size ) != it->second.m_checksum )
+		{
+			printf( "WARNING: corrupted cache bundle entry %s\n", it->first.c_str() );
+			return nullptr;
+		}
+		if( sizeOut ) *sizeOut = it->second.m_size;
+		return binary;
+	}
+
+	static bool write( const std::string& path, const std::vector<std::pair<std::string, std::vector<char>>>& entries )
+	{
+		std::vector<CacheBundleIndex> indices;
+		uint64_t offset = sizeof( CacheBundleHeader ) + entries.size() * sizeof( CacheBundleIndex );
+		for( const auto& entry : entries )
+		{
+			CacheBundleIndex index;
+			::memset( &index, 0, sizeof( CacheBundleIndex ) );
+			if( entry.first.size() != 32 || sscanf( entry.first.c_str(), "%16llx%16llx", (unsigned long long*)&index.m_key.m_h[0], (unsigned long long*)&index.m_key.m_h[1] ) != 2 ) return false;
+			offset = ( offset + OrochiUtilsImpl::CacheFileHeader::PAYLOAD_ALIGNMENT - 1 ) / OrochiUtilsImpl::CacheFileHeader::PAYLOAD_ALIGNMENT * OrochiUtilsImpl::CacheFileHeader::PAYLOAD_ALIGNMENT;
+			index.m_offset = offset;
+			index.m_size = entry.second.size();
+			index.m_checksum = OrochiUtilsImpl::checksum( entry.second.data(), entry.second.size() );
+			indices.push_back( index );
+			offset += entry.second.size();
+		}
+
+		const std::string tmpName = path + ".tmp";
+		FILE* file = OrochiUtilsImpl::openFile( tmpName, "wb" );
+		if( !file ) return false;
+
+		CacheBundleHeader header;
+		::memset( &header, 0, sizeof( CacheBundleHeader ) );
+		header.m_magic = CacheBundleHeader::MAGIC;
+		header.m_version = CacheBundleHeader::VERSION;
+		header.m_numEntries = entries.size();
+
+		bool success = fwrite( &header, sizeof( CacheBundleHeader ), 1, file ) == 1;
+		success = success && fwrite( indices.data(), sizeof( CacheBundleIndex ), indices.size(), file ) == indices.size();
+		uint64_t written = sizeof( CacheBundleHeader ) + indices.size() * sizeof( CacheBundleIndex );
+		for( size_t i = 0; success && i < entries.size(); i++ )
+		{
+			const std::vector<char> padding( indices[i].m_offset - written, 0 );
+			success = success && fwrite( padding.data(), 1, padding.size(), file ) == padding.size();
+			success = success && fwrite( entries[i].second.data(), 1, entries[i].second.size(), file ) == entries[i].second.size();
+			written = indices[i].m_offset + entries[i].second.size();
+		}
+		success = ( fclose( file ) == 0 ) && success;
+
+		std::error_code ec;
+		if( success )
+		{
+			std::filesystem::rename( std::filesystem::u8path( tmpName ), std::filesystem::u8path( path ), ec );
+			success = !ec;
+		}
+		if( !success ) std::filesystem::remove( std::filesystem::u8path( tmpName ), ec );
+		return success;
+	}
+
+  private:
+	MappedFile m_file;
+	std::unordered_map<std::string, CacheBundleIndex> m_entries;
+};
+
+bool OrochiUtils::mountCacheBundle( const std::string& path )
+{
+	auto bundle = std::make_unique<CacheBundle>( path );
+	if( !bundle->parse() )
+	{
+		printf( "WARNING: mountCacheBundle of file %s failed.\n", path.c_str() );
+		return false;
+	}
+
+	std::unique_lock<std::shared_mutex> lock( m_cacheBundlesMutex );
+	m_cacheBundles.push_back( std::move( bundle ) );
+	return true;
+}
+
+const char* OrochiUtils::findInCacheBundles( const std::string& key, size_t* sizeOut )
+{
+	std::shared_lock<std::shared_mutex> lock( m_cacheBundlesMutex );
+	for( auto& bundle : m_cacheBundles )
+	{
+		if( const char* binary = bundle->find( key, sizeOut ) ) return binary;
+	}
+	return nullptr;
+}
+
+bool OrochiUtils::compileForCacheBundle( const char* code, const char* path, std::vector<const char*>* optsIn, const char* arch, int numHeaders, const char** headers, const char** includeNames, std::string& keyOut, std::vector<char>& binaryOut )
+{
+	// the key doesn't include the architecture option, exactly like at runtime where the compiler targets the current device.
+	std::vector<const char*> opts;
+	SetupCompileOptions( 0, optsIn, nullptr, opts );
+
+	// the headers are resolved like at runtime, so the key is the same.
+	std::vector<std::string> includeDirs;
+	OrochiUtilsImpl::canonicalizeOptions( opts, &includeDirs );
+	IncludeRegistry registry;
+	const std::vector<IncludeRegistry::Header> includes = registry.resolve( code ? code : "", path, includeDirs, numHeaders, headers, includeNames );
+	std::vector<const char*> includeContents;
+	std::vector<const char*> includeNamesAll;
+	for( const IncludeRegistry::Header& header : includes )
+	{
+		includeContents.push_back( header.content->c_str() );
+		includeNamesAll.push_back( header.name.c_str() );
+	}
+	keyOut = OrochiUtilsImpl::getCacheKey( OrochiUtilsImpl::getCacheKeyMaterial( code, opts, includes ), arch ).toString();
+
+	const std::string archOption = std::string( "--gpu-architecture=" ) + arch;
+	opts.push_back( archOption.c_str() );
+
+	orortcProgram prog = nullptr;
+	CreateAndCompileProgram( code, path, opts, {}, static_cast<int>( includes.size() ), includeContents.data(), includeNamesAll.data(), &prog );
+
+	size_t codeSize = 0;
+	orortcResult e = orortcGetCodeSize( prog, &codeSize );
+	if( e == ORORTC_SUCCESS && codeSize )
+	{
+		binaryOut.resize( codeSize );
+		e = orortcGetCode( prog, binaryOut.data() );
+	}
+	orortcDestroyProgram( &prog );
+	return e == ORORTC_SUCCESS && codeSize;
+}
+
+bool OrochiUtils::writeCacheBundle( const std::string& path, const std::vector<std::pair<std::string, std::vector<char>>>& entries ) { return CacheBundle::write( path, entries ); }
+
 bool OrochiUtils::readSourceCode( const std::string& path, std::string& sourceCode, std::vector<std::string>* includes ) 
 {
 	return OrochiUtilsImpl::readSourceCode( path, sourceCode, includes ); 
@@ -508,158 +1423,815 @@ bool OrochiUtils::readSourceCode( const std::string& path, std::string& sourceCo
 // returns nullptr if failed
 oroFunction OrochiUtils::getFunctionFromFile( oroDevice device, const char* path, const char* funcName, std::vector<const char*>* optsIn )
 {
-	std::lock_guard<std::recursive_mutex> lock( m_mutex );
+	const std::vector<oroFunction> functions = getFunctionsFromFile( device, path, { funcName }, optsIn );
+	return functions.empty() ? nullptr : functions[0];
+}
+
+oroFunction OrochiUtils::getFunctionFromString( oroDevice device, const char* source, const char* path, const char* funcName, std::vector<const char*>* optsIn, int numHeaders, const char** headers, const char** includeNames )
+{
+	const std::vector<oroFunction> functions = getFunctionsFromString( device, source, path, { funcName }, optsIn, numHeaders, headers, includeNames );
+	return functions.empty() ? nullptr : functions[0];
+}
+
+std::vector<oroFunction> OrochiUtils::getFunctionsFromFile( oroDevice device, const char* path, const std::vector<const char*>& funcNames, std::vector<const char*>* optsIn )
+{
+	auto compile = [&]( oroModule* module ) -> std::vector<oroFunction>
+	{
+		const auto readStart = std::chrono::steady_clock::now();
+		const std::shared_ptr<const std::string> source = m_includeRegistry->getSource( path );
+		if( !source )
+		{
+			printf( "WARNING: getFunctionsFromFile of file %s failed.\n", path );
+			return {};
+		}
+		return compileFunctions( device, source->c_str(), path, funcNames, optsIn, 0, nullptr, nullptr, module, false, OrochiUtilsImpl::elapsedMs( readStart ) );
+	};
+	return getCachedFunctions( path, funcNames, optsIn, compile );
+}
+
+std::vector<oroFunction> OrochiUtils::getFunctionsFromString( oroDevice device, const char* source, const char* path, const std::vector<const char*>& funcNames, std::vector<const char*>* optsIn, int numHeaders, const char** headers, const char** includeNames )
+{
+	return getCachedFunctions( path, funcNames, optsIn, [&]( oroModule* module ) { return getFunctions( device, source, path, funcNames, optsIn, numHeaders, headers, includeNames, module ); } );
+}
+
+oroFunction OrochiUtils::getTemplatedFunction( oroDevice device, const char* source, const char* path, const char* nameExpression, std::vector<const char*>* optsIn, int numHeaders, const char** headers, const char** includeNames )
+{
+	const std::vector<oroFunction> functions = getTemplatedFunctions( device, source, path, { nameExpression }, optsIn, numHeaders, headers, includeNames );
+	return functions.empty() ? nullptr : functions[0];
+}
+
+std::vector<oroFunction> OrochiUtils::getTemplatedFunctions( oroDevice device, const char* source, const char* path, const std::vector<const char*>& nameExpressions, std::vector<const char*>* optsIn, int numHeaders, const char** headers, const char** includeNames )
+{
+	return getCachedFunctions( path, nameExpressions, optsIn, [&]( oroModule* module ) { return compileFunctions( device, source, path, nameExpressions, optsIn, numHeaders, headers, includeNames, module, true, 0.0 ); } );
+}
+
+std::vector<oroFunction> OrochiUtils::getTemplatedFunctionsFromFile( oroDevice device, const char* path, const std::vector<const char*>& nameExpressions, std::vector<const char*>* optsIn )
+{
+	auto compile = [&]( oroModule* module ) -> std::vector<oroFunction>
+	{
+		const auto readStart = std::chrono::steady_clock::now();
+		const std::shared_ptr<const std::string> source = m_includeRegistry->getSource( path );
+		if( !source )
+		{
+			printf( "WARNING: getTemplatedFunctionsFromFile of file %s failed.\n", path );
+			return {};
+		}
+		return compileFunctions( device, source->c_str(), path, nameExpressions, optsIn, 0, nullptr, nullptr, module, true, OrochiUtilsImpl::elapsedMs( readStart ) );
+	};
+	return getCachedFunctions( path, nameExpressions, optsIn, compile );
+}
+
+std::vector<oroFunction> OrochiUtils::getCachedFunctions( const char* path, const std::vector<const char*>& funcNames, std::vector<const char*>* optsIn, const std::function<std::vector<oroFunction>( oroModule* )>& compile )
+{
+	std::vector<oroFunction> functions;
+
+	// the functions are loaded once per context: an other context of the same architecture loads the binary from the cache.
+	const oroCtx context = OrochiUtilsImpl::getCurrentContext();
+	const std::string contextKey = OrochiUtilsImpl::getContextKey( context );
 
-	const std::string cacheName = OrochiUtilsImpl::getCacheName( path, funcName, optsIn );
-	if( m_kernelMap.find( cacheName.c_str() ) != m_kernelMap.end() )
+	// fast path: a hit only takes the lock in shared mode
 	{
-		return m_kernelMap[cacheName].function;
+		std::shared_lock<std::shared_mutex> lock( m_kernelMapMutex );
+		if( findFunctionsInCache( path, funcNames, optsIn, contextKey, functions ) ) return functions;
 	}
 
-	std::string source;
-	if( !OrochiUtilsImpl::readSourceCode( path, source, 0 ) ) 
+	std::string requestKey = OrochiUtilsImpl::getKernelKey( path, "", optsIn, contextKey );
+	for( const char* funcName : funcNames )
 	{
-		printf("WARNING: getFunctionFromFile of file %s failed.\n", path);
-		return 0;
+		requestKey += '\n';
+		requestKey += funcName;
 	}
 
+	// if the same request is already being compiled by an other thread, wait for it instead of compiling it twice.
+	std::promise<std::vector<oroFunction>> promise;
+	std::shared_future<std::vector<oroFunction>> inFlight;
+	{
+		std::unique_lock<std::shared_mutex> lock( m_kernelMapMutex );
+		if( findFunctionsInCache( path, funcNames, optsIn, contextKey, functions ) ) return functions;
+
+		auto it = m_inFlight.find( requestKey );
+		if( it != m_inFlight.end() )
+			inFlight = it->second;
+		else
+			m_inFlight[requestKey] = promise.get_future().share();
+	}
+	if( inFlight.valid() ) return inFlight.get();
+
+	// if the compilation throws, the request is removed and the threads waiting for it get an empty result ( failed ), so the next request compiles again.
+	struct InFlightGuard
+	{
+		OrochiUtils& utils;
+		const std::string& requestKey;
+		std::promise<std::vector<oroFunction>>& promise;
+		bool done = false;
+		~InFlightGuard()
+		{
+			if( done ) return;
+			{
+				std::unique_lock<std::shared_mutex> lock( utils.m_kernelMapMutex );
+				utils.m_inFlight.erase( requestKey );
+			}
+			promise.set_value( {} );
+		}
+	} guard{ *this, requestKey, promise };
+
+	// no lock is held during the compilation, so other kernels can be looked up or compiled in parallel.
 	oroModule module = nullptr;
-	oroFunction f = getFunction( device, source.c_str(), path, funcName, optsIn, 0, nullptr, nullptr, &module );
+	functions = compile( &module );
 
-	if ( f )
 	{
-		m_kernelMap[cacheName].function = f;
-		m_kernelMap[cacheName].module = module;
+		std::unique_lock<std::shared_mutex> lock( m_kernelMapMutex );
+		addFunctionsToCache( path, funcNames, optsIn, context, contextKey, module, functions );
+		m_inFlight.erase( requestKey );
 	}
+	guard.done = true;
+	promise.set_value( functions );
+	return functions;
+}
 
-	return f;
+bool OrochiUtils::findFunctionsInCache( const char* path, const std::vector<const char*>& funcNames, std::vector<const char*>* optsIn, const std::string& contextKey, std::vector<oroFunction>& functionsOut )
+{
+	functionsOut.clear();
+	for( const char* funcName : funcNames )
+	{
+		auto it = m_kernelMap.find( OrochiUtilsImpl::getKernelKey( path, funcName, optsIn, contextKey ) );
+		if( it == m_kernelMap.end() )
+		{
+			functionsOut.clear();
+			return false;
+		}
+		functionsOut.push_back( it->second.function );
+	}
+	return true;
 }
 
-oroFunction OrochiUtils::getFunctionFromString( oroDevice device, const char* source, const char* path, const char* funcName, std::vector<const char*>* optsIn, int numHeaders, const char** headers, const char** includeNames )
+void OrochiUtils::addFunctionsToCache( const char* path, const std::vector<const char*>& funcNames, std::vector<const char*>* optsIn, oroCtx context, const std::string& contextKey, oroModule module, std::vector<oroFunction>& functions )
 {
-	std::lock_guard<std::recursive_mutex> lock( m_mutex );
+	if( functions.empty() ) return;
 
-	const std::string cacheName = OrochiUtilsImpl::getCacheName( path, funcName, optsIn );
-	if( m_kernelMap.find( cacheName.c_str() ) != m_kernelMap.end() )
+	bool moduleUsed = false;
+	for( size_t i = 0; i < funcNames.size(); i++ )
 	{
-		return m_kernelMap[cacheName].function;
+		const std::string cacheName = OrochiUtilsImpl::getKernelKey( path, funcNames[i], optsIn, contextKey );
+		auto it = m_kernelMap.find( cacheName );
+		if( it != m_kernelMap.end() )
+		{
+			// keep the function that was already returned to the user, so the handles stay stable.
+			functions[i] = it->second.function;
+			continue;
+		}
+		m_kernelMap[cacheName] = { functions[i], module, context };
+		moduleUsed = true;
 	}
 
-	oroModule module;
+	// every function was added meanwhile by an other request, so nothing references this module.
+	if( !moduleUsed && module ) oroModuleUnload( module );
+}
 
-	oroFunction f = getFunction( device, source, path, funcName, optsIn, numHeaders, headers, includeNames, &module );
+oroFunction OrochiUtils::getFunctionFromPrecompiledBinary( const std::string& path, const std::string& funcName )
+{
+	const std::vector<oroFunction> functions = getFunctionsFromPrecompiledBinary( path, { funcName.c_str() } );
+	return functions.empty() ? nullptr : functions[0];
+}
 
-	if ( f )
+std::vector<oroFunction> OrochiUtils::getFunctionsFromPrecompiledBinary( const std::string& path, const std::vector<const char*>& funcNames )
+{
+	auto load = [&]( oroModule* module ) -> std::vector<oroFunction>
 	{
-		m_kernelMap[cacheName].function = f;
-		m_kernelMap[cacheName].module = module;
-	}
-	
-	return f;
+		// the module is owned by m_binaryModules, not by the functions.
+		*module = nullptr;
+		const auto loadStart = std::chrono::steady_clock::now();
+		oroModule binaryModule = getPrecompiledModule( path );
+		if( !binaryModule ) return {};
+
+		std::vector<oroFunction> functions( funcNames.size() );
+		for( size_t i = 0; i < funcNames.size(); i++ )
+		{
+			oroError e = oroModuleGetFunction( &functions[i], binaryModule, funcNames[i] );
+			if( e != oroSuccess )
+			{
+				printf( "WARNING: function %s not found in %s.\n", funcNames[i], path.c_str() );
+				return {};
+			}
+		}
+
+		KernelTelemetry telemetry{};
+		telemetry.path = path;
+		telemetry.cacheResult = "precompiled";
+		telemetry.loadMs = OrochiUtilsImpl::elapsedMs( loadStart );
+		{
+			std::lock_guard<std::mutex> lock( m_binaryModulesMutex );
+			auto file = m_binaryFiles.find( path );
+			if( file != m_binaryFiles.end() ) telemetry.binarySize = static_cast<size_t>( file->second.size );
+		}
+		addTelemetry( telemetry, funcNames, functions );
+		return functions;
+	};
+
+	// the functions are cached by path and version of the file, so a binary replaced on disk is loaded again.
+	std::error_code ec;
+	const std::filesystem::path filePath = std::filesystem::u8path( path );
+	const auto time = std::filesystem::last_write_time( filePath, ec ).time_since_epoch().count();
+	const uintmax_t size = ec ? 0 : std::filesystem::file_size( filePath, ec );
+	const std::string cacheKey = path + '@' + std::to_string( time ) + ':' + std::to_string( size );
+	return getCachedFunctions( cacheKey.c_str(), funcNames, nullptr, load );
 }
 
-oroFunction OrochiUtils::getFunctionFromPrecompiledBinary( const std::string& path, const std::string& funcName )
+oroModule OrochiUtils::getPrecompiledModule( const std::string& path )
 {
-	std::lock_guard<std::recursive_mutex> lock( m_mutex );
+	std::lock_guard<std::mutex> lock( m_binaryModulesMutex );
+
+	const std::string contextKey = OrochiUtilsImpl::getContextKey( OrochiUtilsImpl::getCurrentContext() );
+
+	std::error_code ec;
+	const std::filesystem::path filePath = std::filesystem::u8path( path );
+	const std::filesystem::file_time_type time = std::filesystem::last_write_time( filePath, ec );
+	const uintmax_t size = ec ? 0 : std::filesystem::file_size( filePath, ec );
+	if( ec )
+	{
+		printf( "OrochiUtils::getFunctionFromPrecompiledBinary FAILED to open file: %s\n", path.c_str() );
+		return nullptr;
+	}
 
-	const std::string cacheName = OrochiUtilsImpl::getCacheName( path, funcName );
-	if( m_kernelMap.find( cacheName.c_str() ) != m_kernelMap.end() )
+	// the content is only hashed again if the file changed since the last call.
+	auto file = m_binaryFiles.find( path );
+	if( file != m_binaryFiles.end() && file->second.time == time && file->second.size == size )
 	{
-		return m_kernelMap[cacheName].function;
+		auto it = m_binaryModules.find( file->second.contentHash + '@' + contextKey );
+		if( it != m_binaryModules.end() ) return it->second.module;
 	}
 
-	std::ifstream instream( path, std::ios::in | std::ios::binary );
-	if ( !instream || !instream.is_open() )
+	MappedFile mapped( path.c_str() );
+	if( !mapped.found() )
 	{
-		printf("OrochiUtils::getFunctionFromPrecompiledBinary FAILED to open file: %s\n", path.c_str());
+		printf( "OrochiUtils::getFunctionFromPrecompiledBinary FAILED to open file: %s\n", path.c_str() );
 		return nullptr;
 	}
 
-	std::vector<char> binary( ( std::istreambuf_iterator<char>( instream ) ), std::istreambuf_iterator<char>() );
+	// identical binaries ( even from different paths ) are loaded only once.
+	const std::string contentHash = OrochiUtilsImpl::hash128( mapped.data(), mapped.size() ).toString();
+	m_binaryFiles[path] = { time, size, contentHash };
+	return getBinaryModule( contentHash, mapped.data(), path );
+}
+
+oroModule OrochiUtils::getBinaryModule( const std::string& contentHash, const void* binary, const std::string& name )
+{
+	// a module is loaded once per context, the content hash being shared by all of them.
+	const oroCtx context = OrochiUtilsImpl::getCurrentContext();
+	const std::string contextKey = OrochiUtilsImpl::getContextKey( context );
+
+	auto it = m_binaryModules.find( contentHash + '@' + contextKey );
+	if( it != m_binaryModules.end() ) return it->second.module;
 
 	oroModule module = nullptr;
-	oroFunction functionOut{};
-	oroError e = oroModuleLoadData( &module, binary.data() );
-	if ( e != oroSuccess )
+	oroError e = oroModuleLoadData( &module, binary );
+	if( e != oroSuccess )
 	{
 		// add some verbose info to help debugging missing file
-		printf("oroModuleLoadData FAILED (error = %d) loading file: %s\n", e, path.c_str());
+		printf( "oroModuleLoadData FAILED (error = %d) loading file: %s\n", e, name.c_str() );
 		return nullptr;
 	}
-	OROASSERT( e == oroSuccess, 0 );
+	m_binaryModules[contentHash + '@' + contextKey] = { module, context };
+	return module;
+}
 
-	e = oroModuleGetFunction( &functionOut, module, funcName.c_str() );
-	OROASSERT( e == oroSuccess, 0 );
+const OrochiUtils::EmbeddedBinary* OrochiUtils::findEmbeddedBinary( oroDevice device, const EmbeddedBinary* binaries, int numBinaries )
+{
+	oroDeviceProp props;
+	if( const oroDeviceProp* snapshot = oroDeviceGetSnapshotProperties( device ) )
+		props = *snapshot;
+	else if( oroGetDeviceProperties( &props, device ) != oroSuccess ) 
+		return nullptr;
+
+	// the binaries are built without the features of the architecture ( "gfx90a", not "gfx90a:sramecc+:xnack-" ).
+	std::string arch = props.gcnArchName;
+	arch = arch.empty() ? "sm_" + std::to_string( props.major ) + std::to_string( props.minor ) : arch.substr( 0, arch.find( ':' ) );
+
+	for( int i = 0; i < numBinaries; i++ )
+	{
+		if( arch == binaries[i].arch ) return &binaries[i];
+	}
+	return nullptr;
+}
+
+std::vector<oroFunction> OrochiUtils::getFunctionsFromBinary( const std::string& name, const void* binary, size_t size, const std::vector<const char*>& funcNames )
+{
+	auto load = [&]( oroModule* module ) -> std::vector<oroFunction>
+	{
+		// the module is owned by m_binaryModules, not by the functions.
+		*module = nullptr;
+		const auto loadStart = std::chrono::steady_clock::now();
+		oroModule binaryModule = nullptr;
+		{
+			std::lock_guard<std::mutex> lock( m_binaryModulesMutex );
+			binaryModule = getBinaryModule( OrochiUtilsImpl::hash128( binary, size ).toString(), binary, name );
+		}
+		if( !binaryModule ) return {};
+
+		std::vector<oroFunction> functions( funcNames.size() );
+		for( size_t i = 0; i < funcNames.size(); i++ )
+		{
+			oroError e = oroModuleGetFunction( &functions[i], binaryModule, funcNames[i] );
+			if( e != oroSuccess )
+			{
+				printf( "WARNING: function %s not found in %s.\n", funcNames[i], name.c_str() );
+				return {};
+			}
+		}
+
+		KernelTelemetry telemetry{};
+		telemetry.path = name;
+		telemetry.cacheResult = "embedded";
+		telemetry.loadMs = OrochiUtilsImpl::elapsedMs( loadStart );
+		telemetry.binarySize = size;
+		addTelemetry( telemetry, funcNames, functions );
+		return functions;
+	};
+
+	return getCachedFunctions( name.c_str(), funcNames, nullptr, load );
+}
+
+void OrochiUtils::addTelemetry( const KernelTelemetry& telemetry, const std::vector<const char*>& funcNames, const std::vector<oroFunction>& functions )
+{
+	std::vector<KernelTelemetry> records;
+	for( size_t i = 0; i < funcNames.size(); i++ )
+	{
+		KernelTelemetry record = telemetry;
+		record.function = funcNames[i];
+		if( i < functions.size() )
+		{
+			oroFuncGetAttribute( &record.numRegs, ORO_FUNC_ATTRIBUTE_NUM_REGS, functions[i] );
+			oroFuncGetAttribute( &record.sharedSizeBytes, ORO_FUNC_ATTRIBUTE_SHARED_SIZE_BYTES, functions[i] );
+		}
+		records.push_back( std::move( record ) );
+	}
+
+	std::lock_guard<std::mutex> lock( m_telemetryMutex );
+	m_telemetry.insert( m_telemetry.end(), records.begin(), records.end() );
+}
+
+std::vector<OrochiUtils::KernelTelemetry> OrochiUtils::getTelemetry() const
+{
+	std::lock_guard<std::mutex> lock( m_telemetryMutex );
+	return m_telemetry;
+}
+
+bool OrochiUtils::writeTelemetry( const std::string& jsonPath ) const
+{
+	auto escape = []( const std::string& str )
+	{
+		std::string escaped;
+		for( const char c : str )
+		{
+			if( c == '"' || c == '\\' )
+			{
+				escaped += '\\';
+				escaped += c;
+			}
+			else if( static_cast<unsigned char>( c ) < 0x20 )
+			{
+				char buf[8];
+				snprintf( buf, sizeof( buf ), "\\u%04x", c );
+				escaped += buf;
+			}
+			else
+			{
+				escaped += c;
+			}
+		}
+		return escaped;
+	};
+
+	FILE* file = OrochiUtilsImpl::openFile( jsonPath, "w" );
+	if( !file )
+	{
+		printf( "WARNING: failed to write the telemetry to %s\n", jsonPath.c_str() );
+		return false;
+	}
+
+	const std::vector<KernelTelemetry> telemetry = getTelemetry();
+	fprintf( file, "[\n" );
+	for( size_t i = 0; i < telemetry.size(); i++ )
+	{
+		const KernelTelemetry& t = telemetry[i];
+		fprintf( file, "  { \"path\": \"%s\", \"function\": \"%s\", \"cacheKey\": \"%s\", \"cacheResult\": \"%s\", ", escape( t.path ).c_str(), escape( t.function ).c_str(), t.cacheKey.c_str(), escape( t.cacheResult ).c_str() );
+		fprintf( file, "\"readMs\": %.3f, \"compileMs\": %.3f, \"loadMs\": %.3f, \"binarySize\": %zu, \"numRegs\": %d, \"sharedSizeBytes\": %d }%s\n", t.readMs, t.compileMs, t.loadMs, t.binarySize, t.numRegs, t.sharedSizeBytes,
+				 ( i + 1 < telemetry.size() ) ? "," : "" );
+	}
+	fprintf( file, "]\n" );
+	return fclose( file ) == 0;
+}
+
+OrochiUtils::CacheStats OrochiUtils::getCacheStats() const
+{
+	CacheStats stats{};
+	for( const OrochiUtilsImpl::CacheEntry& entry : OrochiUtilsImpl::getCacheEntries( m_cacheDirectory ) )
+	{
+		stats.entries++;
+		stats.bytes += entry.size;
+	}
+	stats.hits = m_cacheHits;
+	stats.misses = m_cacheMisses;
+	stats.evictions = m_cacheEvictions;
+	return stats;
+}
+
+std::vector<std::shared_future<std::vector<oroFunction>>> OrochiUtils::compileAsync( oroDevice device, const std::vector<CompileRequest>& requests, std::function<void()> onCompletion )
+{
+	std::call_once( m_workerPoolCreated,
+					[this]()
+					{
+						const unsigned int numThreads = m_numCompileThreads ? m_numCompileThreads : std::max( 1u, std::thread::hardware_concurrency() );
+						m_workerPool = std::make_unique<WorkerPool>( numThreads );
+					} );
+
+	// the API and the context are per thread, so the workers run with the ones of the caller.
+	// a context created outside of Orochi ( the primary context after oroSetDevice ) is unknown to oroCtxGetCurrent, so the workers select its device instead.
+	oroCtx ctx = nullptr;
+	oroCtxGetCurrent( &ctx );
+	int ctxDevice = -1;
+	if( !ctx && oroGetDevice( &ctxDevice ) != oroSuccess ) ctxDevice = -1;
+
+	std::vector<std::shared_future<std::vector<oroFunction>>> futures;
+	auto remaining = std::make_shared<std::atomic<size_t>>( requests.size() );
+	if( requests.empty() && onCompletion ) onCompletion();
+
+	for( const CompileRequest& request : requests )
+	{
+		auto promise = std::make_shared<std::promise<std::vector<oroFunction>>>();
+		futures.push_back( promise->get_future().share() );
+
+		m_workerPool->push(
+			[this, device, ctx, ctxDevice, request, promise, remaining, onCompletion]()
+			{
+				if( ctx )
+					oroCtxSetCurrent( ctx );
+				else if( ctxDevice >= 0 )
+					oroSetDevice( ctxDevice );
+
+				std::vector<const char*> funcNames;
+				for( const std::string& name : request.funcNames )
+					funcNames.push_back( name.c_str() );
+				std::vector<const char*> opts;
+				for( const std::string& o : request.options )
+					opts.push_back( o.c_str() );
+
+				std::vector<oroFunction> functions;
+				if( request.source.empty() )
+				{
+					functions = getFunctionsFromFile( device, request.path.c_str(), funcNames, &opts );
+				}
+				else
+				{
+					std::vector<const char*> headers;
+					std::vector<const char*> includeNames;
+					for( size_t i = 0; i < request.headers.size() && i < request.includeNames.size(); i++ )
+					{
+						headers.push_back( request.headers[i].c_str() );
+						includeNames.push_back( request.includeNames[i].c_str() );
+					}
+					functions = getFunctionsFromString( device, request.source.c_str(), request.path.c_str(), funcNames, &opts, static_cast<int>( headers.size() ), headers.data(), includeNames.data() );
+				}
+
+				promise->set_value( std::move( functions ) );
+				if( remaining->fetch_sub( 1 ) == 1 && onCompletion ) onCompletion();
+			} );
+	}
+	return futures;
+}
+
+std::shared_future<std::vector<oroFunction>> OrochiUtils::getFunctionsAsync( oroDevice device, const char* path, const std::vector<const char*>& funcNames, std::vector<const char*>* opts )
+{
+	CompileRequest request;
+	request.path = path;
+	request.funcNames.assign( funcNames.begin(), funcNames.end() );
+	if( opts ) request.options.assign( opts->begin(), opts->end() );
+	return compileAsync( device, { request } ).front();
+}
+
+oroFunction OrochiUtils::getSpecializedFunction( oroDevice device, const char* path, const char* funcName, std::vector<const char*>* opts, const std::vector<std::pair<const char*, int64_t>>& values )
+{
+	std::vector<std::string> defines;
+	std::string valuesKey;
+	for( const auto& value : values )
+	{
+		defines.push_back( std::string( "-D" ) + value.first + "=" + std::to_string( value.second ) );
+		valuesKey += defines.back() + ' ';
+	}
 
-	m_kernelMap[cacheName].function = functionOut;
-	m_kernelMap[cacheName].module = module;
+	std::shared_future<std::vector<oroFunction>> variant;
+	{
+		std::lock_guard<std::mutex> lock( m_specializationsMutex );
+		const bool enabled = m_specializationOptOuts.find( OrochiUtilsImpl::getCacheName( path, funcName, opts ) ) == m_specializationOptOuts.end();
+		Specialization& specialization = m_specializations[OrochiUtilsImpl::getKernelKey( path, funcName, opts, OrochiUtilsImpl::getContextKey( OrochiUtilsImpl::getCurrentContext() ) )];
+		if( enabled && m_specializationThreshold && !values.empty() )
+		{
+			auto it = specialization.variants.find( valuesKey );
+			if( it != specialization.variants.end() )
+			{
+				variant = it->second;
+			}
+			else
+			{
+				specialization.stableCalls = ( specialization.values == valuesKey ) ? specialization.stableCalls + 1 : 1;
+				specialization.values = valuesKey;
+				if( specialization.stableCalls >= m_specializationThreshold )
+				{
+					CompileRequest request;
+					request.path = path;
+					request.funcNames = { funcName };
+					if( opts ) request.options.assign( opts->begin(), opts->end() );
+					request.options.insert( request.options.end(), defines.begin(), defines.end() );
+					specialization.variants[valuesKey] = compileAsync( device, { request } ).front();
+				}
+			}
+		}
+	}
+
+	// the generic kernel is used until the variant is compiled, and if its compilation failed.
+	if( variant.valid() && variant.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready && !variant.get().empty() ) return variant.get()[0];
+	return getFunctionFromFile( device, path, funcName, opts );
+}
+
+void OrochiUtils::setSpecializationEnabled( const char* path, const char* funcName, std::vector<const char*>* opts, bool enabled )
+{
+	std::lock_guard<std::mutex> lock( m_specializationsMutex );
+	if( enabled )
+		m_specializationOptOuts.erase( OrochiUtilsImpl::getCacheName( path, funcName, opts ) );
+	else
+		m_specializationOptOuts.insert( OrochiUtilsImpl::getCacheName( path, funcName, opts ) );
+}
+
+bool OrochiUtils::getCachedData( oroDevice device, const char* code, const char* path, std::vector<const char*>* optsIn, std::vector<char>& dst )
+{
+	std::vector<const char*> opts;
+	SetupCompileOptions( device, optsIn, nullptr, opts );
+
+	// getData searches the include directories itself, the resolved headers only make the key.
+	std::vector<std::string> includeDirs;
+	OrochiUtilsImpl::canonicalizeOptions( opts, &includeDirs );
+	const std::vector<IncludeRegistry::Header> includes = m_includeRegistry->resolve( code ? code : "", path, includeDirs, 0, nullptr, nullptr );
+
+	std::string keyMaterial = OrochiUtilsImpl::getCacheKeyMaterial( code, opts, includes );
+	OrochiUtilsImpl::appendKey( keyMaterial, "bitcode" );
+	const OrochiUtilsImpl::Hash128 key = OrochiUtilsImpl::getCacheKey( keyMaterial, OrochiUtilsImpl::getArchName( device ) );
+	const std::string cacheFile = OrochiUtilsImpl::getCacheFileName( path, key, m_cacheDirectory );
+
+	auto build = [&]( std::vector<char>& binary )
+	{
+		getData( device, code, path, optsIn, binary );
+		return !binary.empty();
+	};
+	return OrochiUtilsImpl::getCacheEntry( *this, cacheFile, key, build, dst );
+}
+
+bool OrochiUtils::getLinkedBinary( oroDevice device, const std::vector<LinkInput>& inputs, unsigned int numOptions, orortcJIT_option* options, void** optionValues, std::vector<char>& binaryOut )
+{
+	int rtcMajor = 0;
+	int rtcMinor = 0;
+	orortcVersion( &rtcMajor, &rtcMinor );
+
+	std::string keyMaterial;
+	OrochiUtilsImpl::appendKey( keyMaterial, std::to_string( oroGetCurAPI( 0 ) ) + "." + std::to_string( rtcMajor ) + "." + std::to_string( rtcMinor ) );
+	OrochiUtilsImpl::appendKey( keyMaterial, "link" );
+	for( unsigned int i = 0; i < numOptions; i++ )
+	{
+		// the logs and the wall time are outputs, they don't change the binary.
+		const orortcJIT_option option = options[i];
+		if( option == ORORTC_JIT_WALL_TIME || option == ORORTC_JIT_INFO_LOG_BUFFER || option == ORORTC_JIT_INFO_LOG_BUFFER_SIZE_BYTES || option == ORORTC_JIT_ERROR_LOG_BUFFER ||
+			option == ORORTC_JIT_ERROR_LOG_BUFFER_SIZE_BYTES || option == ORORTC_JIT_LOG_VERBOSE )
+			continue;
+
+		OrochiUtilsImpl::appendKey( keyMaterial, std::to_string( option ) );
+		if( option == ORORTC_JIT_IR_TO_ISA_OPT_EXT )
+		{
+			// an array of strings, its size given by ORORTC_JIT_IR_TO_ISA_OPT_COUNT_EXT
+			size_t count = 0;
+			for( unsigned int j = 0; j < numOptions; j++ )
+			{
+				if( options[j] == ORORTC_JIT_IR_TO_ISA_OPT_COUNT_EXT ) count = reinterpret_cast<size_t>( optionValues[j] );
+			}
+			const char** values = reinterpret_cast<const char**>( optionValues[i] );
+			for( size_t j = 0; values && j < count; j++ )
+				OrochiUtilsImpl::appendKey( keyMaterial, values[j] ? values[j] : "" );
+		}
+		else
+		{
+			OrochiUtilsImpl::appendKey( keyMaterial, std::to_string( reinterpret_cast<uintptr_t>( optionValues[i] ) ) );
+		}
+	}
+	for( const LinkInput& input : inputs )
+	{
+		OrochiUtilsImpl::appendKey( keyMaterial, std::to_string( input.type ) );
+		OrochiUtilsImpl::appendKey( keyMaterial, OrochiUtilsImpl::hash128( input.data, input.size ).toString() );
+	}
+	const OrochiUtilsImpl::Hash128 key = OrochiUtilsImpl::getCacheKey( keyMaterial, OrochiUtilsImpl::getArchName( device ) );
+	const std::string cacheFile = OrochiUtilsImpl::getCacheFileName( "link", key, m_cacheDirectory );
 
-	return functionOut;
+	auto build = [&]( std::vector<char>& binary )
+	{
+		orortcLinkState linkState = nullptr;
+		orortcResult e = orortcLinkCreate( numOptions, options, optionValues, &linkState );
+		for( size_t i = 0; e == ORORTC_SUCCESS && i < inputs.size(); i++ )
+			e = orortcLinkAddData( linkState, inputs[i].type, const_cast<void*>( inputs[i].data ), inputs[i].size, 0, 0, 0, 0 );
+
+		// the output is owned by the link state.
+		void* linked = nullptr;
+		size_t linkedSize = 0;
+		if( e == ORORTC_SUCCESS ) e = orortcLinkComplete( linkState, &linked, &linkedSize );
+		if( e == ORORTC_SUCCESS && linked ) binary.assign( static_cast<const char*>( linked ), static_cast<const char*>( linked ) + linkedSize );
+		if( linkState ) orortcLinkDestroy( linkState );
+		if( e != ORORTC_SUCCESS ) printf( "WARNING: linking failed (error = %d).\n", e );
+		return e == ORORTC_SUCCESS && !binary.empty();
+	};
+	return OrochiUtilsImpl::getCacheEntry( *this, cacheFile, key, build, binaryOut );
 }
 
 // returns nullptr if failed
 oroFunction OrochiUtils::getFunction( oroDevice device, const char* code, const char* path, const char* funcName, std::vector<const char*>* optsIn, int numHeaders, const char** headers, const char** includeNames, oroModule* loadedModule)
 {
-	std::lock_guard<std::recursive_mutex> lock( m_mutex );
+	const std::vector<oroFunction> functions = getFunctions( device, code, path, { funcName }, optsIn, numHeaders, headers, includeNames, loadedModule );
+	return functions.empty() ? nullptr : functions[0];
+}
+
+// returns an empty vector if failed
+std::vector<oroFunction> OrochiUtils::getFunctions( oroDevice device, const char* code, const char* path, const std::vector<const char*>& funcNames, std::vector<const char*>* optsIn, int numHeaders, const char** headers, const char** includeNames, oroModule* loadedModule )
+{
+	return compileFunctions( device, code, path, funcNames, optsIn, numHeaders, headers, includeNames, loadedModule, false, 0.0 );
+}
+
+std::vector<oroFunction> OrochiUtils::compileFunctions( oroDevice device, const char* code, const char* path, const std::vector<const char*>& funcNames, std::vector<const char*>* optsIn, int numHeaders, const char** headers, const char** includeNames,
+														oroModule* loadedModule, bool nameExpressions, double readMs )
+{
+	if( funcNames.empty() ) return {};
+
+	KernelTelemetry telemetry{};
+	telemetry.path = path ? path : "";
+	const auto readStart = std::chrono::steady_clock::now();
 
 	std::vector<const char*> opts;
 	SetupCompileOptions(device, optsIn, nullptr, opts);
 
-	oroFunction function;
 	std::vector<char> codec;
 
-	std::string cacheFile;
+	// the cache file doesn't depend on the function names, so all the kernels of a source share the same binary.
+	// the whole include graph is given to the compiler from memory, so neither the key nor the compilation searches the include directories.
+	std::vector<std::string> includeDirs;
+	OrochiUtilsImpl::canonicalizeOptions( opts, &includeDirs );
+	const std::vector<IncludeRegistry::Header> includes = m_includeRegistry->resolve( code ? code : "", path, includeDirs, numHeaders, headers, includeNames );
+	telemetry.readMs = readMs + OrochiUtilsImpl::elapsedMs( readStart );
+
+	const std::string arch = OrochiUtilsImpl::getArchName( device );
+	std::string keyMaterial = OrochiUtilsImpl::getCacheKeyMaterial( code, opts, includes );
+
+	// the instantiations are part of the binary, and their lowered names are stored with it.
+	// they are not in the bundles, which only hold the binaries.
+	std::vector<std::string> loweredNames;
+	if( nameExpressions )
+	{
+		OrochiUtilsImpl::appendKey( keyMaterial, "nameExpressions" );
+		for( const char* funcName : funcNames )
+			OrochiUtilsImpl::appendKey( keyMaterial, funcName );
+	}
+
+	const OrochiUtilsImpl::Hash128 cacheKey = OrochiUtilsImpl::getCacheKey( keyMaterial, arch );
+	const std::string cacheFile = OrochiUtilsImpl::getCacheFileName( path, cacheKey, m_cacheDirectory );
+	telemetry.cacheKey = cacheKey.toString();
+
+	// the cache entry is loaded directly from the mapping, without any copy
+	auto mappedCache = std::make_unique<MappedFile>( cacheFile.c_str() );
+	uint64_t lastAccess = 0;
+	size_t binarySize = 0;
+	const char* staleReason = nullptr;
+	const char* binary = OrochiUtilsImpl::getCacheFileBinary( *mappedCache, cacheKey, &binarySize, &lastAccess, &loweredNames, &staleReason );
+
+	// then the read-only bundles. they are built offline for the base architecture ( without the features ).
+	bool fromBundle = false;
+	if( !binary && !nameExpressions )
 	{
-		std::string o;
-		for( int i = 0; i < opts.size(); i++ )
-			o.append( opts[i] );
-		OrochiUtilsImpl::getCacheFileName( device, path, funcName, o.c_str(), cacheFile, m_cacheDirectory );
+		const std::string baseArch = arch.substr( 0, arch.find( ':' ) );
+		binary = findInCacheBundles( ( ( baseArch == arch ) ? cacheKey : OrochiUtilsImpl::getCacheKey( keyMaterial, baseArch ) ).toString(), &binarySize );
+		fromBundle = ( binary != nullptr );
 	}
-	if( OrochiUtilsImpl::isFileUpToDate( cacheFile.c_str(), path ) )
+
+	// on a miss, only one process compiles the entry: the others wait for the lock, then load the entry it wrote.
+	std::unique_ptr<FileLock> compileLock;
+	if( !binary )
 	{
-		// load cache
-		OrochiUtilsImpl::loadCacheFileToBinary( cacheFile, codec );
+		OrochiUtilsImpl::createDirectory( m_cacheDirectory.c_str() );
+		compileLock = std::make_unique<FileLock>( OrochiUtilsImpl::getLockFileName( cacheFile ).c_str() );
+		mappedCache = std::make_unique<MappedFile>( cacheFile.c_str() );
+		binary = OrochiUtilsImpl::getCacheFileBinary( *mappedCache, cacheKey, &binarySize, &lastAccess, &loweredNames );
+	}
+
+	if( binary )
+	{
+		telemetry.cacheResult = fromBundle ? "bundle" : "hit";
+		m_cacheHits++;
+		if( !fromBundle && OrochiUtilsImpl::now() > lastAccess + OrochiUtilsImpl::CacheFileHeader::LAST_ACCESS_GRANULARITY ) OrochiUtilsImpl::touchCacheFile( cacheFile );
 	}
 	else
 	{
+		telemetry.cacheResult = staleReason ? std::string( "stale (" ) + staleReason + ")" : "miss";
+		m_cacheMisses++;
+		const auto compileStart = std::chrono::steady_clock::now();
+
+		// an entry which exists but can't be mapped, or a binary which can't be written, is a failure of the cache.
+		std::error_code ec;
+		const uintmax_t entrySize = std::filesystem::file_size( std::filesystem::u8path( cacheFile ), ec );
+		bool cacheFailed = !mappedCache->found() && !ec && entrySize > 0;
+
+		const char* programName = ( funcNames.size() == 1 || !path ) ? funcNames[0] : path;
+
+		std::vector<const char*> includeContents;
+		std::vector<const char*> includeNamesAll;
+		for( const IncludeRegistry::Header& header : includes )
+		{
+			includeContents.push_back( header.content->c_str() );
+			includeNamesAll.push_back( header.name.c_str() );
+		}
+
 		orortcProgram prog = nullptr;
-		int createProgramErrorCode = CreateAndCompileProgram(code, funcName, opts, nullptr, numHeaders, headers, includeNames, &prog);
+		int createProgramErrorCode = CreateAndCompileProgram(code, programName, opts, nameExpressions ? funcNames : std::vector<const char*>(), static_cast<int>( includes.size() ), includeContents.data(), includeNamesAll.data(), &prog);
 
-		// if CreateAndCompileProgram failed
-		if ( createProgramErrorCode != 0 )
+		// CreateAndCompileProgram doesn't report the compilation errors ( see there ), a program without code is the failure.
+		size_t codeSize = 0;
+		orortcResult e = ORORTC_ERROR_COMPILATION;
+		if( createProgramErrorCode == 0 ) e = orortcGetCodeSize( prog, &codeSize );
+		if( e != ORORTC_SUCCESS || codeSize == 0 )
 		{
 			if ( prog )
 				orortcDestroyProgram( &prog );
-			return nullptr;
+			telemetry.compileMs = OrochiUtilsImpl::elapsedMs( compileStart );
+			addTelemetry( telemetry, funcNames, {} );
+			return {};
 		}
 
-		size_t codeSize;
-		orortcResult e;
-		e = orortcGetCodeSize( prog, &codeSize );
-		OROASSERT( e == ORORTC_SUCCESS, 0 );
-
 		codec.resize( codeSize );
 		e = orortcGetCode( prog, codec.data() );
 		OROASSERT( e == ORORTC_SUCCESS, 0 );
+
+		// the lowered names are owned by the program, so they are copied before destroying it.
+		loweredNames.clear();
+		for( size_t i = 0; nameExpressions && i < funcNames.size(); i++ )
+		{
+			const char* loweredName = nullptr;
+			e = orortcGetLoweredName( prog, funcNames[i], &loweredName );
+			if( e != ORORTC_SUCCESS || !loweredName )
+			{
+				printf( "WARNING: lowered name of %s not found in %s.\n", funcNames[i], path ? path : "<source>" );
+				orortcDestroyProgram( &prog );
+				return {};
+			}
+			loweredNames.push_back( loweredName );
+		}
+
 		e = orortcDestroyProgram( &prog );
 		OROASSERT( e == ORORTC_SUCCESS, 0 );
 
 		// store cache
-		OrochiUtilsImpl::createDirectory( m_cacheDirectory.c_str() );
-		OrochiUtilsImpl::cacheBinaryToFile( codec, cacheFile );
+		if( OrochiUtilsImpl::cacheBinaryToFile( codec.data(), codec.size(), cacheKey, cacheFile, loweredNames ) )
+			m_cacheEvictions += OrochiUtilsImpl::enforceCacheBudget( *this, cacheFile );
+		else
+			cacheFailed = true;
+		if( cacheFailed ) telemetry.cacheResult = "failed";
+		binary = codec.data();
+		binarySize = codec.size();
+		telemetry.compileMs = OrochiUtilsImpl::elapsedMs( compileStart );
+	}
+	compileLock.reset();
+	telemetry.binarySize = binarySize;
+	if( nameExpressions && loweredNames.size() != funcNames.size() )
+	{
+		printf( "WARNING: lowered names missing in %s.\n", cacheFile.c_str() );
+		return {};
 	}
+
+	const auto loadStart = std::chrono::steady_clock::now();
 	oroModule module;
-	oroError ee = oroModuleLoadData( &module, codec.data() );
-	OROASSERT( ee == oroSuccess, 0 );
-	ee = oroModuleGetFunction( &function, module, funcName );
+	oroError ee = oroModuleLoadData( &module, binary );
 	OROASSERT( ee == oroSuccess, 0 );
 
+	std::vector<oroFunction> functions( funcNames.size() );
+	for( size_t i = 0; i < funcNames.size(); i++ )
+	{
+		ee = oroModuleGetFunction( &functions[i], module, nameExpressions ? loweredNames[i].c_str() : funcNames[i] );
+		if( ee != oroSuccess )
+		{
+			printf( "WARNING: function %s not found in %s.\n", funcNames[i], path ? path : "<source>" );
+			oroModuleUnload( module );
+			return {};
+		}
+	}
+	telemetry.loadMs = OrochiUtilsImpl::elapsedMs( loadStart );
+	addTelemetry( telemetry, funcNames, functions );
+
 	if ( loadedModule ) 
 	{
 		*loadedModule = module;
 	}
 
-	return function;
+	return functions;
 }
 
 void OrochiUtils::getData( oroDevice device, const char* code, const char* path, std::vector<const char*>* optsIn, std::vector<char>& dst )
@@ -700,7 +2272,9 @@ int OrochiUtils::getProgram( oroDevice device, const char* code, const char* pat
 	std::vector<const char*> opts;
 	std::string architectureTarget;
 	SetupCompileOptions(device, optsIn, &architectureTarget, opts);
-	int createProgramErrorCode = CreateAndCompileProgram(code, path, opts, funcName, 0, nullptr, nullptr, prog);
+	std::vector<const char*> nameExpressions;
+	if( funcName ) nameExpressions.push_back( funcName );
+	int createProgramErrorCode = CreateAndCompileProgram(code, path, opts, nameExpressions, 0, nullptr, nullptr, prog);
 	return createProgramErrorCode;
 }
 
@@ -22,10 +22,17 @@
 
 #pragma once
 #include <Orochi/Orochi.h>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <string>
-#include <filesystem>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #if defined( GNUC )
@@ -56,7 +63,7 @@ class OrochiUtils
 		int x, y, z, w;
 	};
 
-	OrochiUtils() = default;
+	OrochiUtils();
 	OrochiUtils(const OrochiUtils&) = delete; 
     OrochiUtils& operator=(const OrochiUtils&) = delete;
     OrochiUtils(OrochiUtils&&) = delete; 
@@ -65,14 +72,137 @@ class OrochiUtils
 
 	// unload all the modules internally created during functions like getFunctionFromPrecompiledBinary/getFunction
 	// good practice to call it just before oroCtxDestroy, just to avoid any potential memory leak.
+	// the sources and headers read from the disk are forgotten too, so they are read again by the next compilations.
 	void unloadKernelCache();
 
+	// Include registry: headers kept in memory and given to the compiler through numHeaders/headers/includeNames, instead of being searched with -I.
+	// includeName is the name used in the #include directives ( "ParallelPrimitives/RadixSortConfigs.h" ). the bake step generates the arrays for registerIncludes ( see tools/genArgs.py ).
+	// the headers which are not registered are read from the disk the first time a kernel includes them, so the next compilations don't touch the disk.
+	void registerInclude( const std::string& includeName, const std::string& content );
+	void registerIncludes( int numHeaders, const char** headers, const char** includeNames );
+
+	// the binary is loaded once per content ( even across paths ), and all its functions are taken from the same module.
 	oroFunction getFunctionFromPrecompiledBinary( const std::string& path, const std::string& funcName );
+	std::vector<oroFunction> getFunctionsFromPrecompiledBinary( const std::string& path, const std::vector<const char*>& funcNames );
+
+	// Embedded binaries: code objects compiled offline for several architectures and linked into the application ( see tools/embedKernels.py ).
+	// arch is the base gcnArchName on HIP ( "gfx1100", without the features ), and "sm_XY" on CUDA.
+	struct EmbeddedBinary
+	{
+		const char* arch;
+		const unsigned char* data;
+		size_t size;
+	};
+
+	// returns the binary built for the architecture of the device, or nullptr if there is none ( the kernels have to be compiled then ).
+	static const EmbeddedBinary* findEmbeddedBinary( oroDevice device, const EmbeddedBinary* binaries, int numBinaries );
+
+	// same as getFunctionsFromPrecompiledBinary, for a binary in memory. name identifies the binary in the kernel cache and the messages.
+	std::vector<oroFunction> getFunctionsFromBinary( const std::string& name, const void* binary, size_t size, const std::vector<const char*>& funcNames );
 
 	oroFunction getFunctionFromFile( oroDevice device, const char* path, const char* funcName, std::vector<const char*>* opts );
 	oroFunction getFunctionFromString( oroDevice device, const char* source, const char* path, const char* funcName, std::vector<const char*>* opts, int numHeaders, const char** headers, const char** includeNames );
 	oroFunction getFunction( oroDevice device, const char* code, const char* path, const char* funcName, std::vector<const char*>* opts, int numHeaders = 0, const char** headers = 0, const char** includeNames = 0, oroModule* loadedModule = 0 );
 
+	// Same as the functions above, but for several kernels living in the same source:
+	// the source is compiled only once, cached as a single binary and loaded as a single module.
+	// The returned functions are in the same order as funcNames. Returns an empty vector if failed.
+	std::vector<oroFunction> getFunctionsFromFile( oroDevice device, const char* path, const std::vector<const char*>& funcNames, std::vector<const char*>* opts );
+	std::vector<oroFunction> getFunctionsFromString( oroDevice device, const char* source, const char* path, const std::vector<const char*>& funcNames, std::vector<const char*>* opts, int numHeaders, const char** headers, const char** includeNames );
+	std::vector<oroFunction> getFunctions( oroDevice device, const char* code, const char* path, const std::vector<const char*>& funcNames, std::vector<const char*>* opts, int numHeaders = 0, const char** headers = 0, const char** includeNames = 0, oroModule* loadedModule = 0 );
+
+	// Templated kernels: the functions are given as name expressions of instantiations ( "Kernel<int, 8, true>" ) instead of extern "C" names.
+	// all the instantiations are added to the same program, compiled once, and cached together with their lowered names.
+	// the same expressions must be used to get them back from the cache, as "Kernel<int,8,true>" is compiled again.
+	oroFunction getTemplatedFunction( oroDevice device, const char* source, const char* path, const char* nameExpression, std::vector<const char*>* opts, int numHeaders = 0, const char** headers = 0, const char** includeNames = 0 );
+	std::vector<oroFunction> getTemplatedFunctions( oroDevice device, const char* source, const char* path, const std::vector<const char*>& nameExpressions, std::vector<const char*>* opts, int numHeaders = 0, const char** headers = 0, const char** includeNames = 0 );
+	std::vector<oroFunction> getTemplatedFunctionsFromFile( oroDevice device, const char* path, const std::vector<const char*>& nameExpressions, std::vector<const char*>* opts );
+
+	// Runtime value specialisation: call it for every launch with the values of the launch constants ( macro name, value ).
+	// once the same values were given m_specializationThreshold times in a row, a variant of the kernel is compiled in the background with the values as -D options,
+	// and returned instead of the generic kernel when it's ready. the kernel reads the macros when they are defined, so loops can be unrolled and bounds checks folded:
+	//   #if defined( START_BIT )
+	//       startBit = START_BIT;
+	//   #endif
+	// the variants are cached like any other build of the kernel, the values being part of the options.
+	oroFunction getSpecializedFunction( oroDevice device, const char* path, const char* funcName, std::vector<const char*>* opts, const std::vector<std::pair<const char*, int64_t>>& values );
+	// opt-out for a kernel: getSpecializedFunction always returns its generic build.
+	void setSpecializationEnabled( const char* path, const char* funcName, std::vector<const char*>* opts, bool enabled );
+
+	// a kernel source to compile asynchronously, see compileAsync.
+	struct CompileRequest
+	{
+		std::string path;					  // file to compile. if source is not empty, it's only used as the program name and for the include lookup.
+		std::string source;					  // optional, the code to compile instead of the content of path.
+		std::vector<std::string> funcNames;
+		std::vector<std::string> options;
+		std::vector<std::string> headers;	  // optional, headers given to the compiler, with their names in includeNames.
+		std::vector<std::string> includeNames;
+	};
+
+	// compile the requests in parallel on a pool of worker threads ( m_numCompileThreads ), using the context current on the calling thread.
+	// the returned futures give the functions of each request in the order of its funcNames ( empty if failed ), exactly like getFunctionsFromFile/getFunctionsFromString.
+	// onCompletion, if given, is called from a worker thread once all the requests are done, after their futures are ready: waiting for the futures doesn't wait for it.
+	std::vector<std::shared_future<std::vector<oroFunction>>> compileAsync( oroDevice device, const std::vector<CompileRequest>& requests, std::function<void()> onCompletion = nullptr );
+	std::shared_future<std::vector<oroFunction>> getFunctionsAsync( oroDevice device, const char* path, const std::vector<const char*>& funcNames, std::vector<const char*>* opts );
+
+	// Cache bundles: a single read-only file holding many cache entries, built offline ( see tools/CacheBundle ) and shipped with an application.
+	// the mounted bundles are looked up after m_cacheDirectory, so the first launch doesn't need to compile.
+	// the entries are built for the base architecture ( "gfx90a" even if the device is "gfx90a:sramecc+:xnack-" ) and need the same HIPRTC/runtime version.
+	bool mountCacheBundle( const std::string& path );
+
+	// compile a source for an architecture ( "gfx1100"... ) without the device, and return the key of this binary in the cache. HIP only.
+	static bool compileForCacheBundle( const char* code, const char* path, std::vector<const char*>* opts, const char* arch, int numHeaders, const char** headers, const char** includeNames, std::string& keyOut, std::vector<char>& binaryOut );
+	// entries are ( key, binary ) pairs, from compileForCacheBundle.
+	static bool writeCacheBundle( const std::string& path, const std::vector<std::pair<std::string, std::vector<char>>>& entries );
+
+	// Link cache: the bitcode and the linked binaries are cached in m_cacheDirectory like the code objects, so a restart skips both the compilation and the link.
+	// same as getData, but the bitcode comes from the cache if it was already built. returns false if failed.
+	bool getCachedData( oroDevice device, const char* code, const char* path, std::vector<const char*>* opts, std::vector<char>& dst );
+
+	struct LinkInput
+	{
+		orortcJITInputType type;
+		const void* data;
+		size_t size;
+	};
+
+	// the output of orortcLinkCreate/orortcLinkAddData/orortcLinkComplete for the inputs, or the binary cached by a previous link.
+	// the entry is keyed by the ordered inputs, the JIT options and the architecture. the log and wall time options are only filled when linking.
+	bool getLinkedBinary( oroDevice device, const std::vector<LinkInput>& inputs, unsigned int numOptions, orortcJIT_option* options, void** optionValues, std::vector<char>& binaryOut );
+
+	struct CacheStats
+	{
+		size_t entries;	  // entries currently in m_cacheDirectory
+		uint64_t bytes;	  // total size of these entries
+		size_t hits;	  // since the creation of this OrochiUtils
+		size_t misses;
+		size_t evictions;
+	};
+
+	// stats of the disk cache. entries and bytes are read from m_cacheDirectory, so they include the entries written by other processes.
+	CacheStats getCacheStats() const;
+
+	// Telemetry: what it cost to get each kernel, recorded every time a module is loaded ( not when the function is already in m_kernelMap ).
+	// a kernel which fails to compile is recorded too, with a binarySize of 0.
+	struct KernelTelemetry
+	{
+		std::string path;
+		std::string function;
+		std::string cacheKey;	 // empty for the precompiled binaries
+		std::string cacheResult; // "hit", "bundle", "miss", "stale (reason)" ( an entry from an other version, truncated... ), "precompiled", "embedded" or "failed" ( compiled, but the entry couldn't be read or written )
+		double readMs;			 // reading the source and resolving its includes
+		double compileMs;		 // 0 if not compiled
+		double loadMs;			 // oroModuleLoadData and oroModuleGetFunction
+		size_t binarySize;
+		int numRegs;
+		int sharedSizeBytes;
+	};
+
+	std::vector<KernelTelemetry> getTelemetry() const;
+	// write the telemetry as a JSON array, one object per kernel.
+	bool writeTelemetry( const std::string& jsonPath ) const;
+
 	static bool readSourceCode( const std::string& path, std::string& sourceCode, std::vector<std::string>* includes = 0 );
 	static void getData( oroDevice device, const char* code, const char* path, std::vector<const char*>* opts, std::vector<char>& dst );
 	static int getProgram( oroDevice device, const char* code, const char* path, std::vector<const char*>* optsIn, const char* funcName, orortcProgram* prog );
@@ -80,6 +210,23 @@ class OrochiUtils
 	static void launch1D( oroFunction func, int nx, const void** args, int wgSize = 64, unsigned int sharedMemBytes = 0, oroStream stream = 0 );
 	static void launch2D( oroFunction func, int nx, int ny, const void** args, int wgSizeX = 8, int wgSizeY = 8, unsigned int sharedMemBytes = 0, oroStream stream = 0 );
 
+	// the same, given the arguments instead of their addresses: while a capture runs, their sizes are registered ( oroCaptureSetKernelArgSizes ) so the launches are replayed.
+	template<typename... Args>
+	static void launch1D( oroFunction func, int nx, int wgSize, unsigned int sharedMemBytes, oroStream stream, const Args&... args )
+	{
+		const void* params[] = { &args..., nullptr };
+		setCaptureArgSizes<Args...>( func );
+		launch1D( func, nx, params, wgSize, sharedMemBytes, stream );
+	}
+
+	template<typename... Args>
+	static void launch2D( oroFunction func, int nx, int ny, int wgSizeX, int wgSizeY, unsigned int sharedMemBytes, oroStream stream, const Args&... args )
+	{
+		const void* params[] = { &args..., nullptr };
+		setCaptureArgSizes<Args...>( func );
+		launch2D( func, nx, ny, params, wgSizeX, wgSizeY, sharedMemBytes, stream );
+	}
+
 	template<typename T>
 	static void malloc( T*& ptr, size_t n )
 	{
@@ -160,16 +307,134 @@ class OrochiUtils
 		OROASSERT( e == oroSuccess, 0 );
 	}
 
+  private:
+	template<typename... Args>
+	static void setCaptureArgSizes( oroFunction func )
+	{
+		if( !oroCaptureEnabled() ) return;
+		const size_t sizes[] = { sizeof( Args )..., 0 };
+		oroCaptureSetKernelArgSizes( func, sizeof...( Args ), sizes );
+	}
+
+	class WorkerPool;
+	class CacheBundle;
+	class IncludeRegistry;
+
+	// returns the binary of the entry in the mounted bundles, or nullptr.
+	const char* findInCacheBundles( const std::string& key, size_t* sizeOut = nullptr );
+
+	// getFunctions, with funcNames being name expressions if nameExpressions is true ( see getTemplatedFunctions ).
+	std::vector<oroFunction> compileFunctions( oroDevice device, const char* code, const char* path, const std::vector<const char*>& funcNames, std::vector<const char*>* opts, int numHeaders, const char** headers, const char** includeNames,
+											   oroModule* loadedModule, bool nameExpressions, double readMs );
+
+	// one record per function, with the same costs.
+	void addTelemetry( const KernelTelemetry& telemetry, const std::vector<const char*>& funcNames, const std::vector<oroFunction>& functions );
+
+	// returns the functions from m_kernelMap, or calls compile once if they are missing.
+	// concurrent requests for the same functions wait for the compilation in flight instead of compiling again.
+	std::vector<oroFunction> getCachedFunctions( const char* path, const std::vector<const char*>& funcNames, std::vector<const char*>* opts, const std::function<std::vector<oroFunction>( oroModule* )>& compile );
+
+	// returns the module of a precompiled binary, loaded only if the content of the file was never loaded before.
+	oroModule getPrecompiledModule( const std::string& path );
+
+	// returns the module of a binary, loaded only if its content was never loaded in the current context. m_binaryModulesMutex must be held.
+	oroModule getBinaryModule( const std::string& contentHash, const void* binary, const std::string& name );
+
+	// returns true only if all the functions are already in m_kernelMap. m_kernelMapMutex must be held.
+	bool findFunctionsInCache( const char* path, const std::vector<const char*>& funcNames, std::vector<const char*>* opts, const std::string& contextKey, std::vector<oroFunction>& functionsOut );
+	void addFunctionsToCache( const char* path, const std::vector<const char*>& funcNames, std::vector<const char*>* opts, oroCtx context, const std::string& contextKey, oroModule module, std::vector<oroFunction>& functions );
+
+	// m_kernelMap and m_inFlight are read-mostly: lookups take this lock in shared mode, and it's never held during a compilation.
+	std::shared_mutex m_kernelMapMutex;
+
   public:
 	std::string m_cacheDirectory = "./cache/";
+
+	// budget of m_cacheDirectory, enforced when an entry is written by evicting the least recently used entries. 0 means no limit.
+	uint64_t m_cacheMaxBytes = 0;
+	size_t m_cacheMaxEntries = 0;
+	// deprecated: not taken by OrochiUtils anymore, m_kernelMap is guarded by an internal lock. kept so the code locking it still builds,
+	// but holding it doesn't make accessing m_kernelMap safe.
 	std::recursive_mutex m_mutex;
 
 	struct FunctionModule {
 		oroFunction function;
 		oroModule module;
+		oroCtx context; // the context the module was loaded in, nullptr if not created by Orochi
 	};
 
+	// keyed by path, function name, options and context: a function is only valid in the context of its module.
+
 	std::unordered_map<std::string, FunctionModule> m_kernelMap;
+
+	// compilations in progress, keyed by request ( path, options and function names ).
+	std::unordered_map<std::string, std::shared_future<std::vector<oroFunction>>> m_inFlight;
+
+	struct BinaryFile
+	{
+		std::filesystem::file_time_type time;
+		uintmax_t size;
+		std::string contentHash;
+	};
+
+	struct ContextModule
+	{
+		oroModule module;
+		oroCtx context;
+	};
+
+	// precompiled and embedded binaries: the content of each path, and the module loaded for each content and context.
+	std::mutex m_binaryModulesMutex;
+	std::unordered_map<std::string, BinaryFile> m_binaryFiles;
+	std::unordered_map<std::string, ContextModule> m_binaryModules;
+
+	std::shared_mutex m_cacheBundlesMutex;
+	std::vector<std::unique_ptr<CacheBundle>> m_cacheBundles;
+
+	std::atomic<size_t> m_cacheHits{ 0 };
+	std::atomic<size_t> m_cacheMisses{ 0 };
+	std::atomic<size_t> m_cacheEvictions{ 0 };
+
+	// the size of the cache directory as known by this process: scanned by the first write and when it goes over the budget, increased by the entries written in between.
+	struct CacheUsage
+	{
+		std::string directory; // the directory scanned, empty before the first scan
+		uint64_t bytes = 0;
+		size_t entries = 0;
+	};
+	std::mutex m_cacheUsageMutex;
+	CacheUsage m_cacheUsage;
+
+	// if not empty, the telemetry is written to this file when this OrochiUtils is destroyed.
+	std::string m_telemetryFile;
+
+	mutable std::mutex m_telemetryMutex;
+	std::vector<KernelTelemetry> m_telemetry;
+
+	// number of threads used by compileAsync. 0 means one per host core.
+	unsigned int m_numCompileThreads = 0;
+
+	// number of launches with the same values before getSpecializedFunction compiles a variant. 0 disables the specialisation.
+	uint32_t m_specializationThreshold = 16;
+
+	struct Specialization
+	{
+		std::string values;		  // the values of the last launches
+		uint32_t stableCalls = 0; // number of launches in a row with these values
+		std::unordered_map<std::string, std::shared_future<std::vector<oroFunction>>> variants; // by values
+	};
+
+	// by kernel ( path, function name, options and context ).
+	std::mutex m_specializationsMutex;
+	std::unordered_map<std::string, Specialization> m_specializations;
+	std::unordered_set<std::string> m_specializationOptOuts; // by path, function name and options, for every context
+
+  private:
+	std::unique_ptr<IncludeRegistry> m_includeRegistry;
+
+	// created on the first compileAsync. must stay the last member, so it's destroyed ( and its pending compilations finished ) first.
+	std::once_flag m_workerPoolCreated;
+	std::unique_ptr<WorkerPool> m_workerPool;
 };
 
 class OroStopwatch
@@ -24,6 +24,8 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <chrono>
+#include <filesystem>
 #include <iostream>
 #include <numeric>
 
@@ -36,10 +38,33 @@
 // clang-format on
 #endif
 
+#if defined( ORO_PP_EMBEDDED_KERNELS )
+#include <ParallelPrimitives/cache/EmbeddedKernels.h>
+#endif
+
 #if defined( __GNUC__ )
 #include <dlfcn.h>
 #endif
 
+// the generated headers which are not included are replaced by empty ones, in the same namespace.
+#if !defined( ORO_PP_LOAD_FROM_STRING )
+static const char* hip_RadixSortKernels = nullptr;
+namespace hip
+{
+static const char** RadixSortKernelsArgs = nullptr;
+static const char** RadixSortKernelsIncludes = nullptr;
+static const int RadixSortKernelsNumIncludes = 0;
+} // namespace hip
+#endif
+
+#if !defined( ORO_PP_EMBEDDED_KERNELS )
+namespace hip
+{
+static const OrochiUtils::EmbeddedBinary* RadixSortKernelsBinaries = nullptr;
+static const int RadixSortKernelsNumBinaries = 0;
+} // namespace hip
+#endif
+
 namespace
 {
 #if defined( ORO_PRECOMPILED )
@@ -52,15 +77,27 @@ constexpr auto useBitCode = false;
 constexpr auto useBakeKernel = true;
 #else
 constexpr auto useBakeKernel = false;
-static const char* hip_RadixSortKernels = nullptr;
-namespace hip
-{
-static const char** RadixSortKernelsArgs = nullptr;
-static const char** RadixSortKernelsIncludes = nullptr;
-} // namespace hip
+#endif
+
+#if defined( ORO_PP_TIERED_JIT )
+constexpr auto useTieredJit = true;
+#else
+constexpr auto useTieredJit = false;
+#endif
+
+#if defined( ORO_PP_EMBEDDED_KERNELS )
+constexpr auto useEmbeddedKernels = true;
+#else
+constexpr auto useEmbeddedKernels = false;
 #endif
 
 static_assert( !( useBitCode && useBakeKernel ), "useBitCode and useBakeKernel cannot coexist" );
+static_assert( !( useBitCode && useEmbeddedKernels ), "useBitCode and useEmbeddedKernels cannot coexist" );
+static_assert( !( useBitCode && useTieredJit ), "useBitCode and useTieredJit cannot coexist" );
+
+// the kernels in the order of RadixSort::setKernels.
+constexpr const char* kernelNames[] = { "CountKernel", "ParallelExclusiveScanSingleWG", "ParallelExclusiveScanAllWG", "SortKernel", "SortKVKernel", "SortSinglePassKernel", "SortSinglePassKVKernel" };
+constexpr auto numKernels = std::size( kernelNames );
 
 #if !defined( __GNUC__ )
 const HMODULE GetCurrentModule()
@@ -87,6 +124,30 @@ void printKernelInfo( const std::string& name, oroFunction func )
 	std::cout << ", vgpr : shared = " << numReg << " : " << sharedSizeBytes << " : " << constSizeBytes << '\n';
 }
 
+// the compile options of the kernels for the given block sizes.
+template<typename Config>
+std::vector<std::string> getCompileOptions( const oroDeviceProp& props, const std::string& includeDir, const Config& config )
+{
+	std::vector<std::string> opts;
+
+	if( const std::string device_name = props.name; device_name.find( "NVIDIA" ) != std::string::npos )
+	{
+		opts.push_back( "--use_fast_math" );
+	}
+	else
+	{
+		opts.push_back( "-ffast-math" );
+	}
+
+	opts.push_back( "-I" + includeDir );
+	opts.push_back( "-DOVERWRITE" );
+	opts.push_back( "-DCOUNT_WG_SIZE_VAL=" + std::to_string( config.num_threads_per_block_for_count ) );
+	opts.push_back( "-DSCAN_WG_SIZE_VAL=" + std::to_string( config.num_threads_per_block_for_scan ) );
+	opts.push_back( "-DSORT_WG_SIZE_VAL=" + std::to_string( config.num_threads_per_block_for_sort ) );
+	opts.push_back( "-DSORT_NUM_WARPS_PER_BLOCK_VAL=" + std::to_string( config.num_threads_per_block_for_sort / config.warp_size ) );
+	return opts;
+}
+
 } // namespace
 
 namespace Oro
@@ -94,7 +155,10 @@ namespace Oro
 
 RadixSort::RadixSort( oroDevice device, OrochiUtils& oroutils, oroStream stream, const std::string& kernelPath, const std::string& includeDir ) : m_device{ device }, m_oroutils{ oroutils }
 {
-	oroGetDeviceProperties( &m_props, device );
+	if( const oroDeviceProp* props = oroDeviceGetSnapshotProperties( device ) )
+		m_props = *props;
+	else
+		oroGetDeviceProperties( &m_props, device );
 	configure( kernelPath, includeDir, stream );
 }
 
@@ -138,105 +202,181 @@ void RadixSort::compileKernels( const std::string& kernelPath, const std::string
 		return std::string( buff ).substr( 0, position ) + "/";
 	};
 
+	// the precompiled and embedded kernels are built with the default config.
+	const KernelConfig defaultConfig{ DEFAULT_COUNT_BLOCK_SIZE, DEFAULT_SCAN_BLOCK_SIZE, DEFAULT_SORT_BLOCK_SIZE, DEFAULT_WARP_SIZE };
+
+	KernelConfig tunedConfig{};
+	tunedConfig.num_threads_per_block_for_count = m_props.maxThreadsPerBlock > 0 ? m_props.maxThreadsPerBlock : DEFAULT_COUNT_BLOCK_SIZE;
+	tunedConfig.num_threads_per_block_for_scan = m_props.maxThreadsPerBlock > 0 ? m_props.maxThreadsPerBlock : DEFAULT_SCAN_BLOCK_SIZE;
+	tunedConfig.num_threads_per_block_for_sort = m_props.maxThreadsPerBlock > 0 ? m_props.maxThreadsPerBlock : DEFAULT_SORT_BLOCK_SIZE;
+	tunedConfig.warp_size = ( m_props.warpSize != 0 ) ? m_props.warpSize : DEFAULT_WARP_SIZE;
+
+	assert( tunedConfig.num_threads_per_block_for_count % tunedConfig.warp_size == 0 );
+	assert( tunedConfig.num_threads_per_block_for_scan % tunedConfig.warp_size == 0 );
+	assert( tunedConfig.num_threads_per_block_for_sort % tunedConfig.warp_size == 0 );
+
 	std::string binaryPath{};
 	std::string log{};
-	if constexpr( useBitCode )
+	if constexpr( useBitCode || useTieredJit )
 	{
 		const bool isAmd = oroGetCurAPI( 0 ) == ORO_API_HIP;
 		binaryPath = getCurrentDir();
 		binaryPath += isAmd ? "oro_compiled_kernels.hipfb" : "oro_compiled_kernels.fatbin";
-		log = "loading pre-compiled kernels at path : " + binaryPath;
+	}
 
-		m_num_threads_per_block_for_count = DEFAULT_COUNT_BLOCK_SIZE;
-		m_num_threads_per_block_for_scan = DEFAULT_SCAN_BLOCK_SIZE;
-		m_num_threads_per_block_for_sort = DEFAULT_SORT_BLOCK_SIZE;
+	// the embedded kernels are only used if they were built for the architecture of the device, otherwise the kernels are compiled.
+	const OrochiUtils::EmbeddedBinary* embedded = nullptr;
+	if constexpr( useEmbeddedKernels )
+	{
+		embedded = OrochiUtils::findEmbeddedBinary( m_device, hip::RadixSortKernelsBinaries, hip::RadixSortKernelsNumBinaries );
+	}
 
-		m_warp_size = DEFAULT_WARP_SIZE;
+	// Tiered JIT: start with the precompiled kernels if they are available, and compile the tuned kernels in the background.
+	// without them, the tuned kernels are compiled right away, like without tiered JIT, rather than compiling a generic build first.
+	const bool usePrecompiled = useBitCode || embedded || ( useTieredJit && std::filesystem::exists( binaryPath ) );
+	if( embedded )
+	{
+		log = std::string( "loading embedded kernels for : " ) + embedded->arch;
+		applyConfig( defaultConfig );
+	}
+	else if( usePrecompiled )
+	{
+		log = "loading pre-compiled kernels at path : " + binaryPath;
+		applyConfig( defaultConfig );
 	}
 	else
 	{
 		log = "compiling kernels at path : " + currentKernelPath + " in : " + currentIncludeDir;
-
-		m_num_threads_per_block_for_count = m_props.maxThreadsPerBlock > 0 ? m_props.maxThreadsPerBlock : DEFAULT_COUNT_BLOCK_SIZE;
-		m_num_threads_per_block_for_scan = m_props.maxThreadsPerBlock > 0 ? m_props.maxThreadsPerBlock : DEFAULT_SCAN_BLOCK_SIZE;
-		m_num_threads_per_block_for_sort = m_props.maxThreadsPerBlock > 0 ? m_props.maxThreadsPerBlock : DEFAULT_SORT_BLOCK_SIZE;
-
-		m_warp_size = ( m_props.warpSize != 0 ) ? m_props.warpSize : DEFAULT_WARP_SIZE;
-
-		assert( m_num_threads_per_block_for_count % m_warp_size == 0 );
-		assert( m_num_threads_per_block_for_scan % m_warp_size == 0 );
-		assert( m_num_threads_per_block_for_sort % m_warp_size == 0 );
+		applyConfig( tunedConfig );
 	}
 
-	m_num_warps_per_block_for_sort = m_num_threads_per_block_for_sort / m_warp_size;
-
 	if( m_flags == Flag::LOG )
 	{
 		std::cout << log << std::endl;
 	}
 
-	struct Record
+	const KernelConfig currentConfig{ m_num_threads_per_block_for_count, m_num_threads_per_block_for_scan, m_num_threads_per_block_for_sort, m_warp_size };
+	const std::vector<std::string> options = getCompileOptions( m_props, currentIncludeDir, currentConfig );
+	std::vector<const char*> opts;
+	for( const auto& o : options )
 	{
-		std::string kernelName;
-		Kernel kernelType;
-	};
-
-	const std::vector<Record> records{
-		{ "CountKernel", Kernel::COUNT },	 { "ParallelExclusiveScanSingleWG", Kernel::SCAN_SINGLE_WG }, { "ParallelExclusiveScanAllWG", Kernel::SCAN_PARALLEL },	 { "SortKernel", Kernel::SORT },
-		{ "SortKVKernel", Kernel::SORT_KV }, { "SortSinglePassKernel", Kernel::SORT_SINGLE_PASS },		  { "SortSinglePassKVKernel", Kernel::SORT_SINGLE_PASS_KV },
-	};
-
-	const auto includeArg{ "-I" + currentIncludeDir };
-	const auto overwrite_flag = "-DOVERWRITE";
-	const auto count_block_size_param = "-DCOUNT_WG_SIZE_VAL=" + std::to_string( m_num_threads_per_block_for_count );
-	const auto scan_block_size_param = "-DSCAN_WG_SIZE_VAL=" + std::to_string( m_num_threads_per_block_for_scan );
-	const auto sort_block_size_param = "-DSORT_WG_SIZE_VAL=" + std::to_string( m_num_threads_per_block_for_sort );
-	const auto sort_num_warps_param = "-DSORT_NUM_WARPS_PER_BLOCK_VAL=" + std::to_string( m_num_warps_per_block_for_sort );
+		opts.push_back( o.c_str() );
+	}
 
-	std::vector<const char*> opts;
+	// all the kernels live in the same source, so compile it once and extract every function from the same module.
+	const std::vector<const char*> names( std::begin( kernelNames ), std::end( kernelNames ) );
 
-	if( const std::string device_name = m_props.name; device_name.find( "NVIDIA" ) != std::string::npos )
+	std::vector<oroFunction> functions;
+	if( embedded )
 	{
-		opts.push_back( "--use_fast_math" );
+		functions = m_oroutils.getFunctionsFromBinary( std::string( "RadixSortKernels." ) + embedded->arch, embedded->data, embedded->size, names );
+	}
+	else if( usePrecompiled )
+	{
+		functions = m_oroutils.getFunctionsFromPrecompiledBinary( binaryPath, names );
+	}
+	else if constexpr( useBakeKernel )
+	{
+		// the baked headers are registered once, then every compilation of the kernels ( including the tuned one ) takes them from memory.
+		m_oroutils.registerIncludes( hip::RadixSortKernelsNumIncludes, hip::RadixSortKernelsArgs, hip::RadixSortKernelsIncludes );
+		functions = m_oroutils.getFunctionsFromString( m_device, hip_RadixSortKernels, currentKernelPath.c_str(), names, &opts, 0, nullptr, nullptr );
 	}
 	else
 	{
-		opts.push_back( "-ffast-math" );
+		functions = m_oroutils.getFunctionsFromFile( m_device, currentKernelPath.c_str(), names, &opts );
 	}
 
-	opts.push_back( includeArg.c_str() );
-	opts.push_back( overwrite_flag );
-	opts.push_back( count_block_size_param.c_str() );
-	opts.push_back( scan_block_size_param.c_str() );
-	opts.push_back( sort_block_size_param.c_str() );
-	opts.push_back( sort_num_warps_param.c_str() );
+	setKernels( functions );
 
-	for( const auto& record : records )
+	if constexpr( useTieredJit )
 	{
-		if constexpr( useBakeKernel )
-		{
-			oroFunctions[record.kernelType] = m_oroutils.getFunctionFromString( m_device, hip_RadixSortKernels, currentKernelPath.c_str(), record.kernelName.c_str(), &opts, 1, hip::RadixSortKernelsArgs, hip::RadixSortKernelsIncludes );
-		}
-		else if constexpr( useBitCode )
+		const bool isTuned = tunedConfig.num_threads_per_block_for_count == currentConfig.num_threads_per_block_for_count && tunedConfig.num_threads_per_block_for_scan == currentConfig.num_threads_per_block_for_scan &&
+							 tunedConfig.num_threads_per_block_for_sort == currentConfig.num_threads_per_block_for_sort && tunedConfig.warp_size == currentConfig.warp_size;
+		if( usePrecompiled && !isTuned )
 		{
-			oroFunctions[record.kernelType] = m_oroutils.getFunctionFromPrecompiledBinary( binaryPath.c_str(), record.kernelName.c_str() );
-		}
-		else
-		{
-			oroFunctions[record.kernelType] = m_oroutils.getFunctionFromFile( m_device, currentKernelPath.c_str(), record.kernelName.c_str(), &opts );
+			OrochiUtils::CompileRequest request;
+			request.path = currentKernelPath;
+			request.funcNames.assign( std::begin( kernelNames ), std::end( kernelNames ) );
+			request.options = getCompileOptions( m_props, currentIncludeDir, tunedConfig );
+			if constexpr( useBakeKernel )
+			{
+				request.source = hip_RadixSortKernels;
+			}
+
+			m_tuned_config = tunedConfig;
+			m_tuned_kernels = m_oroutils.compileAsync( m_device, { request } ).front();
 		}
+	}
+}
+
+void RadixSort::applyConfig( const KernelConfig& config ) noexcept
+{
+	m_num_threads_per_block_for_count = config.num_threads_per_block_for_count;
+	m_num_threads_per_block_for_scan = config.num_threads_per_block_for_scan;
+	m_num_threads_per_block_for_sort = config.num_threads_per_block_for_sort;
+	m_warp_size = config.warp_size;
+	m_num_warps_per_block_for_sort = m_num_threads_per_block_for_sort / m_warp_size;
+}
+
+void RadixSort::setKernels( const std::vector<oroFunction>& functions ) noexcept
+{
+	if( functions.size() != numKernels )
+	{
+		std::cout << "Failed to compile the RadixSort kernels" << std::endl;
+		return;
+	}
+
+	const Kernel kernelTypes[] = { Kernel::COUNT, Kernel::SCAN_SINGLE_WG, Kernel::SCAN_PARALLEL, Kernel::SORT, Kernel::SORT_KV, Kernel::SORT_SINGLE_PASS, Kernel::SORT_SINGLE_PASS_KV };
+	static_assert( std::size( kernelTypes ) == numKernels );
+
+	for( size_t i = 0; i < numKernels; i++ )
+	{
+		oroFunctions[kernelTypes[i]] = functions[i];
 
 		if( m_flags == Flag::LOG )
 		{
-			printKernelInfo( record.kernelName, oroFunctions[record.kernelType] );
+			printKernelInfo( kernelNames[i], functions[i] );
 		}
 	}
 }
 
-int RadixSort::calculateWGsToExecute( const int blockSize ) const noexcept
+void RadixSort::swapInTunedKernels( oroStream stream ) noexcept
+{
+	if( !m_tuned_kernels.valid() || m_tuned_kernels.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
+	{
+		return;
+	}
+
+	const std::vector<oroFunction> functions = m_tuned_kernels.get();
+	m_tuned_kernels = {};
+
+	// if the tuned build failed, keep running the precompiled kernels.
+	if( functions.size() != numKernels || std::find( functions.begin(), functions.end(), nullptr ) != functions.end() )
+	{
+		return;
+	}
+
+	if( m_flags == Flag::LOG )
+	{
+		std::cout << "switching to the kernels tuned for the device" << std::endl;
+	}
+
+	applyConfig( m_tuned_config );
+	setKernels( functions );
+
+	// the buffers were allocated for both configs, so the sorts in flight keep theirs. the flags of the scan are cleared in the order of the stream.
+	m_num_blocks_for_count = calculateWGsToExecute( m_tuned_config );
+	m_num_blocks_for_scan = BIN_SIZE * m_num_blocks_for_count / m_num_threads_per_block_for_scan;
+	if( selectedScanAlgo == ScanAlgo::SCAN_GPU_PARALLEL )
+	{
+		m_is_ready.resetAsync( stream );
+	}
+}
+
+int RadixSort::calculateWGsToExecute( const KernelConfig& config ) const noexcept
 {
-	const int warpPerWG = blockSize / m_warp_size;
-	const int warpPerWGP = m_props.maxThreadsPerMultiProcessor / m_warp_size;
+	const int warpPerWG = config.num_threads_per_block_for_count / config.warp_size;
+	const int warpPerWGP = m_props.maxThreadsPerMultiProcessor / config.warp_size;
 	const int occupancyFromWarp = ( warpPerWGP > 0 ) ? ( warpPerWGP / warpPerWG ) : 1;
 
 	const int occupancy = std::max( 1, occupancyFromWarp );
@@ -249,13 +389,13 @@ int RadixSort::calculateWGsToExecute( const int blockSize ) const noexcept
 	static constexpr auto min_num_blocks = 16;
 	auto number_of_blocks = m_props.multiProcessorCount > 0 ? m_props.multiProcessorCount * occupancy : min_num_blocks;
 
-	if( m_num_threads_per_block_for_scan > BIN_SIZE )
+	if( config.num_threads_per_block_for_scan > BIN_SIZE )
 	{
 		// Note: both are divisible by 2
-		const auto base = m_num_threads_per_block_for_scan / BIN_SIZE;
+		const auto base = config.num_threads_per_block_for_scan / BIN_SIZE;
 
-		// Floor
-		number_of_blocks = ( number_of_blocks / base ) * base;
+		// Floor, but at least one scan block ( a device with few multiprocessors, like a small CPU ).
+		number_of_blocks = std::max( base, ( number_of_blocks / base ) * base );
 	}
 
 	return number_of_blocks;
@@ -264,25 +404,38 @@ int RadixSort::calculateWGsToExecute( const int blockSize ) const noexcept
 void RadixSort::configure( const std::string& kernelPath, const std::string& includeDir, oroStream stream ) noexcept
 {
 	compileKernels( kernelPath, includeDir );
+	allocateBuffers( stream );
+}
 
-	m_num_blocks_for_count = calculateWGsToExecute( m_num_threads_per_block_for_count );
+void RadixSort::allocateBuffers( oroStream stream ) noexcept
+{
+	m_num_blocks_for_count = calculateWGsToExecute( { m_num_threads_per_block_for_count, m_num_threads_per_block_for_scan, m_num_threads_per_block_for_sort, m_warp_size } );
 
 	/// The tmp buffer size of the count kernel and the scan kernel.
 
-	const auto tmp_buffer_size = BIN_SIZE * m_num_blocks_for_count;
+	auto tmp_buffer_size = BIN_SIZE * m_num_blocks_for_count;
 
 	/// @c tmp_buffer_size must be divisible by @c m_num_threads_per_block_for_scan
 	/// This is guaranteed since @c m_num_blocks_for_count will be adjusted accordingly
 
 	m_num_blocks_for_scan = tmp_buffer_size / m_num_threads_per_block_for_scan;
+	auto scan_buffer_size = m_num_blocks_for_scan;
+
+	// Tiered JIT: the buffers also fit the tuned kernels, so switching to them doesn't reallocate the buffers of the sorts in flight.
+	if( m_tuned_kernels.valid() )
+	{
+		const auto tuned_tmp_buffer_size = BIN_SIZE * calculateWGsToExecute( m_tuned_config );
+		tmp_buffer_size = std::max( tmp_buffer_size, tuned_tmp_buffer_size );
+		scan_buffer_size = std::max( scan_buffer_size, tuned_tmp_buffer_size / m_tuned_config.num_threads_per_block_for_scan );
+	}
 
 	m_tmp_buffer.resizeAsync( tmp_buffer_size, false, stream );
 
 	if( selectedScanAlgo == ScanAlgo::SCAN_GPU_PARALLEL )
 	{
 		// These are for the scan kernel
-		m_partial_sum.resizeAsync( m_num_blocks_for_scan, false, stream );
-		m_is_ready.resizeAsync( m_num_blocks_for_scan, false, stream );
+		m_partial_sum.resizeAsync( scan_buffer_size, false, stream );
+		m_is_ready.resizeAsync( scan_buffer_size, false, stream );
 		m_is_ready.resetAsync( stream );
 	}
 }
@@ -290,13 +443,17 @@ void RadixSort::setFlag( Flag flag ) noexcept { m_flags = flag; }
 
 void RadixSort::sort( const KeyValueSoA src, const KeyValueSoA dst, int n, int startBit, int endBit, oroStream stream ) noexcept
 {
+	if constexpr( useTieredJit )
+	{
+		swapInTunedKernels( stream );
+	}
+
 	// todo. better to compute SINGLE_SORT_N_ITEMS_PER_WI which we use in the kernel dynamically rather than hard coding it to distribute the work evenly
 	// right now, setting this as large as possible is faster than multi pass sorting
 	if( n < SINGLE_SORT_WG_SIZE * SINGLE_SORT_N_ITEMS_PER_WI )
 	{
 		const auto func = oroFunctions[Kernel::SORT_SINGLE_PASS_KV];
-		const void* args[] = { &src.key, &src.value, &dst.key, &dst.value, &n, &startBit, &endBit };
-		OrochiUtils::launch1D( func, SINGLE_SORT_WG_SIZE, args, SINGLE_SORT_WG_SIZE, 0, stream );
+		OrochiUtils::launch1D( func, SINGLE_SORT_WG_SIZE, SINGLE_SORT_WG_SIZE, 0, stream, src.key, src.value, dst.key, dst.value, n, startBit, endBit );
 		return;
 	}
 
@@ -319,13 +476,17 @@ void RadixSort::sort( const KeyValueSoA src, const KeyValueSoA dst, int n, int s
 
 void RadixSort::sort( const u32* src, const u32* dst, int n, int startBit, int endBit, oroStream stream ) noexcept
 {
+	if constexpr( useTieredJit )
+	{
+		swapInTunedKernels( stream );
+	}
+
 	// todo. better to compute SINGLE_SORT_N_ITEMS_PER_WI which we use in the kernel dynamically rather than hard coding it to distribute the work evenly
 	// right now, setting this as large as possible is faster than multi pass sorting
 	if( n < SINGLE_SORT_WG_SIZE * SINGLE_SORT_N_ITEMS_PER_WI )
 	{
 		const auto func = oroFunctions[Kernel::SORT_SINGLE_PASS];
-		const void* args[] = { &src, &dst, &n, &startBit, &endBit };
-		OrochiUtils::launch1D( func, SINGLE_SORT_WG_SIZE, args, SINGLE_SORT_WG_SIZE, 0, stream );
+		OrochiUtils::launch1D( func, SINGLE_SORT_WG_SIZE, SINGLE_SORT_WG_SIZE, 0, stream, src, dst, n, startBit, endBit );
 		return;
 	}
 
@@ -31,8 +31,10 @@
 #include <cmath>
 #include <cstdint>
 #include <functional>
+#include <future>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace Oro
 {
@@ -79,7 +81,6 @@ class RadixSort final
 	/// @param includeDir The include directory.
 	void compileKernels( const std::string& kernelPath, const std::string& includeDir ) noexcept;
 
-	[[nodiscard]] int calculateWGsToExecute( const int blockSize ) const noexcept;
 
 	/// @brief Exclusive scan algorithm on CPU for testing.
 	/// It copies the count result from the Device to Host before computation, and then copies the offsets back from Host to Device afterward.
@@ -92,6 +93,30 @@ class RadixSort final
 	/// @param includeDir The include directory.
 	void configure( const std::string& kernelPath, const std::string& includeDir, oroStream stream ) noexcept;
 
+	/// @brief Allocate the temporary buffers for the current block sizes.
+	void allocateBuffers( oroStream stream ) noexcept;
+
+	/// @brief The block sizes the kernels are compiled for.
+	struct KernelConfig
+	{
+		int num_threads_per_block_for_count{};
+		int num_threads_per_block_for_scan{};
+		int num_threads_per_block_for_sort{};
+		int warp_size{};
+	};
+
+	void applyConfig( const KernelConfig& config ) noexcept;
+
+	/// @brief The number of blocks of the count kernel for a config.
+	[[nodiscard]] int calculateWGsToExecute( const KernelConfig& config ) const noexcept;
+
+	/// @brief Set the functions in oroFunctions, in the order of the kernel records.
+	void setKernels( const std::vector<oroFunction>& functions ) noexcept;
+
+	/// @brief Tiered JIT: if the kernels tuned for the device finished compiling in the background, switch to them.
+	/// It's done at the beginning of a sort, so all the kernels of a sort always match. The buffers are allocated for both configs.
+	void swapInTunedKernels( oroStream stream ) noexcept;
+
   private:
 	// GPU blocks for the count kernel
 	int m_num_blocks_for_count{};
@@ -142,6 +167,10 @@ class RadixSort final
 	int m_num_warps_per_block_for_sort{};
 
 	int m_warp_size{};
+
+	// Tiered JIT: the kernels tuned for the device, compiled in the background, and their config.
+	std::shared_future<std::vector<oroFunction>> m_tuned_kernels;
+	KernelConfig m_tuned_config{};
 };
 
 #include <ParallelPrimitives/RadixSort.inl>
@@ -99,8 +99,7 @@ void RadixSort::sort1pass( const T src, const T dst, int n, int startBit, int en
 		const auto num_total_thread_for_count = m_num_threads_per_block_for_count * m_num_blocks_for_count;
 
 		const auto func{ oroFunctions[Kernel::COUNT] };
-		const void* args[] = { &srcKey, arg_cast( m_tmp_buffer.address() ), &n, &nItemPerWG, &startBit, &m_num_blocks_for_count };
-		OrochiUtils::launch1D( func, num_total_thread_for_count, args, m_num_threads_per_block_for_count, 0, stream );
+		OrochiUtils::launch1D( func, num_total_thread_for_count, m_num_threads_per_block_for_count, 0, stream, srcKey, m_tmp_buffer.ptr(), n, nItemPerWG, startBit, m_num_blocks_for_count );
 	};
 
 	execute<enable_profile>( launch_count_kernel, t, 0, stream );
@@ -117,8 +116,7 @@ void RadixSort::sort1pass( const T src, const T dst, int n, int startBit, int en
 
 		case ScanAlgo::SCAN_GPU_SINGLE_WG:
 		{
-			const void* args[] = { arg_cast( m_tmp_buffer.address() ), arg_cast( m_tmp_buffer.address() ), &m_num_blocks_for_count };
-			OrochiUtils::launch1D( oroFunctions[Kernel::SCAN_SINGLE_WG], WG_SIZE * m_num_blocks_for_count, args, WG_SIZE, 0, stream );
+			OrochiUtils::launch1D( oroFunctions[Kernel::SCAN_SINGLE_WG], WG_SIZE * m_num_blocks_for_count, WG_SIZE, 0, stream, m_tmp_buffer.ptr(), m_tmp_buffer.ptr(), m_num_blocks_for_count );
 		}
 		break;
 
@@ -126,8 +124,7 @@ void RadixSort::sort1pass( const T src, const T dst, int n, int startBit, int en
 		{
 			const auto num_total_thread_for_scan = m_num_threads_per_block_for_scan * m_num_blocks_for_scan;
 
-			const void* args[] = { arg_cast( m_tmp_buffer.address() ), arg_cast( m_tmp_buffer.address() ), arg_cast( m_partial_sum.address() ), arg_cast( m_is_ready.address() ) };
-			OrochiUtils::launch1D( oroFunctions[Kernel::SCAN_PARALLEL], num_total_thread_for_scan, args, m_num_threads_per_block_for_scan, 0, stream );
+			OrochiUtils::launch1D( oroFunctions[Kernel::SCAN_PARALLEL], num_total_thread_for_scan, m_num_threads_per_block_for_scan, 0, stream, m_tmp_buffer.ptr(), m_tmp_buffer.ptr(), m_partial_sum.ptr(), m_is_ready.ptr() );
 		}
 		break;
 
@@ -147,13 +144,11 @@ void RadixSort::sort1pass( const T src, const T dst, int n, int startBit, int en
 
 		if constexpr( enable_key_value_pair_sorting )
 		{
-			const void* args[] = { &srcKey, &srcVal, &dstKey, &dstVal, arg_cast( m_tmp_buffer.address() ), &n, &num_items_per_block, &startBit, &num_blocks_for_sort };
-			OrochiUtils::launch1D( oroFunctions[Kernel::SORT_KV], num_total_thread_for_sort, args, m_num_threads_per_block_for_sort, 0, stream );
+			OrochiUtils::launch1D( oroFunctions[Kernel::SORT_KV], num_total_thread_for_sort, m_num_threads_per_block_for_sort, 0, stream, srcKey, srcVal, dstKey, dstVal, m_tmp_buffer.ptr(), n, num_items_per_block, startBit, num_blocks_for_sort );
 		}
 		else
 		{
-			const void* args[] = { &srcKey, &dstKey, arg_cast( m_tmp_buffer.address() ), &n, &num_items_per_block, &startBit, &num_blocks_for_sort };
-			OrochiUtils::launch1D( oroFunctions[Kernel::SORT], num_total_thread_for_sort, args, m_num_threads_per_block_for_sort, 0, stream );
+			OrochiUtils::launch1D( oroFunctions[Kernel::SORT], num_total_thread_for_sort, m_num_threads_per_block_for_sort, 0, stream, srcKey, dstKey, m_tmp_buffer.ptr(), n, num_items_per_block, startBit, num_blocks_for_sort );
 		}
 	};
 
@@ -18,6 +18,8 @@ oroApi getApiType( int argc, char** argv )
 			api = ORO_API_HIP;
 		if( strcmp( argv[1], "cuda" ) == 0 )
 			api = ORO_API_CUDA;
+		if( strcmp( argv[1], "host" ) == 0 )
+			api = ORO_API_HOST;
 	}
 	return api;
 }
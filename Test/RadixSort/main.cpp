@@ -304,7 +304,7 @@ int main( int argc, char** argv )
 		printf( "initialization failed\n" );
 		return 0;
 	}
-	printf( ">> executing on %s\n", ( api == ORO_API_HIP ) ? "hip" : "cuda" );
+	printf( ">> executing on %s\n", ( api == ORO_API_HIP ) ? "hip" : ( api == ORO_API_HOST ) ? "host" : "cuda" );
 
 	printf( ">> testing initialization\n" );
 	oroError e;
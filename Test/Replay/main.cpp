@@ -0,0 +1,482 @@
+//
+// Copyright (c) 2021-2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Replays a log captured by oroCaptureBegin ( or ORO_CAPTURE ), and compares the time of each call with the captured one.
+// the calls are issued in the order of the log, on the backend given, whatever the captured one.
+//
+// usage: Replay <log> [cuda|host] [--hip <path of the HIP library>] [--device <index>] [--paced]
+// cuda replays on CUDA, host on the CPU ( ORO_API_HOST, which loads the modules captured on it ), --hip replays on a given HIP library ( like a stand-in driver ).
+// --paced issues each call at its time in the capture, instead of as soon as the previous one returns.
+
+#include <Orochi/Orochi.h>
+#include <Orochi/OrochiCapture.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+const char* OP_NAMES[] = { "", "malloc", "free", "memcpyHtoD", "memcpyDtoH", "memcpyDtoD", "memset", "moduleLoad", "moduleGetFunction", "moduleUnload", "launch",
+	"streamCreate", "streamDestroy", "streamSynchronize", "eventCreate", "eventDestroy", "eventRecord", "eventSynchronize", "streamWaitEvent", "deviceSynchronize" };
+const int NUM_OPS = sizeof( OP_NAMES ) / sizeof( OP_NAMES[0] );
+
+struct OpStats
+{
+	uint64_t count = 0;
+	uint64_t skipped = 0;
+	uint64_t capturedNs = 0;
+	uint64_t replayedNs = 0;
+};
+
+// the body of a record.
+struct Reader
+{
+	const uint64_t* m_data;
+	size_t m_size;
+	size_t m_pos = 0;
+
+	uint64_t next() { return m_pos < m_size ? m_data[m_pos++] : 0; }
+	const void* bytes( uint64_t size )
+	{
+		const void* p = m_data + m_pos;
+		m_pos += ( size + 7 ) / 8;
+		return m_pos <= m_size ? p : nullptr;
+	}
+};
+
+class Replayer
+{
+  public:
+	// the replayed handles, by captured handle.
+	std::unordered_map<uint64_t, oroDeviceptr> m_allocations;
+	std::unordered_map<uint64_t, oroStream> m_streams;
+	std::unordered_map<uint64_t, oroEvent> m_events;
+	std::unordered_map<uint64_t, oroModule> m_modules;
+	std::unordered_map<uint64_t, oroFunction> m_functions;
+	// the images in the log, by hash.
+	std::unordered_map<uint64_t, std::vector<char>> m_images;
+	uint64_t m_mismatches = 0;
+
+	// nullptr if the reference can't be replayed.
+	char* ref( uint64_t allocation, uint64_t offset )
+	{
+		auto it = m_allocations.find( allocation );
+		return ( it == m_allocations.end() ) ? nullptr : (char*)it->second + offset;
+	}
+	char* ref( Reader& r )
+	{
+		const uint64_t allocation = r.next();
+		return ref( allocation, r.next() );
+	}
+	// the captured null stream is the null stream.
+	oroStream stream( uint64_t s )
+	{
+		auto it = m_streams.find( s );
+		return ( it == m_streams.end() ) ? nullptr : it->second;
+	}
+	oroEvent event( uint64_t e )
+	{
+		auto it = m_events.find( e );
+		return ( it == m_events.end() ) ? nullptr : it->second;
+	}
+
+	// false if the call is skipped.
+	bool replay( uint16_t op, uint16_t flags, Reader& r );
+	void release();
+
+  private:
+	// the host side of the copies. an asynchronous copy has its own buffer, kept until its stream is synchronized.
+	std::vector<char> m_host;
+	std::unordered_map<oroStream, std::vector<std::vector<char>>> m_asyncHost;
+	char* host( uint64_t size )
+	{
+		if( m_host.size() < size ) m_host.resize( size );
+		return m_host.data();
+	}
+	char* host( uint64_t size, bool async, oroStream s )
+	{
+		if( !async ) return host( size );
+		return m_asyncHost[s].emplace_back( size ).data();
+	}
+	bool launch( uint16_t flags, Reader& r );
+};
+
+bool Replayer::replay( uint16_t op, uint16_t flags, Reader& r )
+{
+	const bool async = ( flags & OroCapture::FLAG_ASYNC ) != 0;
+	switch( op )
+	{
+	case OroCapture::MALLOC:
+	{
+		const uint64_t ptr = r.next();
+		oroDeviceptr p = nullptr;
+		if( oroMalloc( &p, r.next() ) != oroSuccess ) return false;
+		m_allocations[ptr] = p;
+		return true;
+	}
+	case OroCapture::FREE:
+	{
+		auto it = m_allocations.find( r.next() );
+		if( it == m_allocations.end() ) return false;
+		oroFree( it->second );
+		m_allocations.erase( it );
+		return true;
+	}
+	case OroCapture::MEMCPY_HTOD:
+	{
+		char* dst = ref( r );
+		const uint64_t size = r.next();
+		oroStream s = stream( r.next() );
+		const uint64_t data = r.next();
+		// without the data, the copy is done from a zeroed buffer of the same size.
+		void* src = nullptr;
+		if( data == ORO_CAPTURE_DATA_ALL )
+			src = (void*)r.bytes( size );
+		else
+			src = memset( host( size, async, s ), 0, size );
+		if( !dst || !src ) return false;
+		if( async ) return oroMemcpyHtoDAsync( dst, src, size, s ) == oroSuccess;
+		return oroMemcpyHtoD( dst, src, size ) == oroSuccess;
+	}
+	case OroCapture::MEMCPY_DTOH:
+	{
+		char* src = ref( r );
+		const uint64_t size = r.next();
+		oroStream s = stream( r.next() );
+		const uint64_t data = r.next();
+		if( !src ) return false;
+		char* dst = host( size, async, s );
+		if( async ) return oroMemcpyDtoHAsync( dst, src, size, s ) == oroSuccess;
+		if( oroMemcpyDtoH( dst, src, size ) != oroSuccess ) return false;
+		// the data copied to the device is in the log, so the replay computes the same data.
+		if( data == ORO_CAPTURE_DATA_ALL && OroCapture::hash( dst, size ) != r.next() ) m_mismatches++;
+		return true;
+	}
+	case OroCapture::MEMCPY_DTOD:
+	{
+		char* dst = ref( r );
+		char* src = ref( r );
+		const uint64_t size = r.next();
+		oroStream s = stream( r.next() );
+		if( !dst || !src ) return false;
+		if( async ) return oroMemcpyDtoDAsync( dst, src, size, s ) == oroSuccess;
+		return oroMemcpyDtoD( dst, src, size ) == oroSuccess;
+	}
+	case OroCapture::MEMSET:
+	{
+		char* dst = ref( r );
+		const uint64_t value = r.next();
+		const uint64_t count = r.next();
+		const uint64_t elementSize = r.next();
+		oroStream s = stream( r.next() );
+		if( !dst ) return false;
+		if( elementSize == 4 )
+			return ( async ? oroMemsetD32Async( dst, (int)value, count, s ) : oroMemsetD32( dst, (int)value, count ) ) == oroSuccess;
+		return ( async ? oroMemsetD8Async( dst, (unsigned char)value, count, s ) : oroMemsetD8( dst, (unsigned char)value, count ) ) == oroSuccess;
+	}
+	case OroCapture::MODULE_LOAD:
+	{
+		const uint64_t module = r.next();
+		const uint64_t key = r.next();
+		const uint64_t size = r.next();
+		if( flags & OroCapture::FLAG_IMAGE )
+		{
+			const char* image = (const char*)r.bytes( size );
+			if( image ) m_images[key].assign( image, image + size );
+		}
+		auto it = m_images.find( key );
+		if( size == 0 || it == m_images.end() ) return false;
+		oroModule m = nullptr;
+		if( oroModuleLoadData( &m, it->second.data() ) != oroSuccess ) return false;
+		m_modules[module] = m;
+		return true;
+	}
+	case OroCapture::MODULE_GET_FUNCTION:
+	{
+		const uint64_t function = r.next();
+		auto it = m_modules.find( r.next() );
+		const uint64_t length = r.next();
+		const char* name = (const char*)r.bytes( length );
+		if( it == m_modules.end() || !name ) return false;
+		oroFunction f = nullptr;
+		if( oroModuleGetFunction( &f, it->second, std::string( name, length ).c_str() ) != oroSuccess ) return false;
+		m_functions[function] = f;
+		return true;
+	}
+	case OroCapture::MODULE_UNLOAD:
+	{
+		auto it = m_modules.find( r.next() );
+		if( it == m_modules.end() ) return false;
+		oroModuleUnload( it->second );
+		m_modules.erase( it );
+		return true;
+	}
+	case OroCapture::LAUNCH:
+		return launch( flags, r );
+	case OroCapture::STREAM_CREATE:
+	{
+		const uint64_t s = r.next();
+		oroStream stream = nullptr;
+		if( oroStreamCreateWithFlags( &stream, (unsigned int)r.next() ) != oroSuccess ) return false;
+		m_streams[s] = stream;
+		return true;
+	}
+	case OroCapture::STREAM_DESTROY:
+	{
+		auto it = m_streams.find( r.next() );
+		if( it == m_streams.end() ) return false;
+		oroStreamDestroy( it->second );
+		m_streams.erase( it );
+		return true;
+	}
+	case OroCapture::STREAM_SYNCHRONIZE:
+	{
+		oroStream s = stream( r.next() );
+		if( oroStreamSynchronize( s ) != oroSuccess ) return false;
+		m_asyncHost.erase( s );
+		return true;
+	}
+	case OroCapture::EVENT_CREATE:
+	{
+		const uint64_t e = r.next();
+		oroEvent event = nullptr;
+		if( oroEventCreateWithFlags( &event, (unsigned int)r.next() ) != oroSuccess ) return false;
+		m_events[e] = event;
+		return true;
+	}
+	case OroCapture::EVENT_DESTROY:
+	{
+		auto it = m_events.find( r.next() );
+		if( it == m_events.end() ) return false;
+		oroEventDestroy( it->second );
+		m_events.erase( it );
+		return true;
+	}
+	case OroCapture::EVENT_RECORD:
+	{
+		oroEvent e = event( r.next() );
+		return e && oroEventRecord( e, stream( r.next() ) ) == oroSuccess;
+	}
+	case OroCapture::EVENT_SYNCHRONIZE:
+	{
+		oroEvent e = event( r.next() );
+		return e && oroEventSynchronize( e ) == oroSuccess;
+	}
+	case OroCapture::STREAM_WAIT_EVENT:
+	{
+		oroStream s = stream( r.next() );
+		oroEvent e = event( r.next() );
+		return e && oroStreamWaitEvent( s, e, (unsigned int)r.next() ) == oroSuccess;
+	}
+	case OroCapture::DEVICE_SYNCHRONIZE:
+		if( oroDeviceSynchronize() != oroSuccess ) return false;
+		m_asyncHost.clear();
+		return true;
+	}
+	return false;
+}
+
+bool Replayer::launch( uint16_t flags, Reader& r )
+{
+	auto it = m_functions.find( r.next() );
+	unsigned int dims[7];
+	for( unsigned int& d : dims )
+		d = (unsigned int)r.next();
+	oroStream s = stream( r.next() );
+	const uint64_t numArgs = r.next();
+	if( it == m_functions.end() || numArgs == OroCapture::UNKNOWN_ARGS ) return false;
+
+	// the arguments are copied, to write the relocated pointers in them.
+	std::vector<std::vector<char>> args( numArgs );
+	for( auto& arg : args )
+	{
+		const uint64_t size = r.next();
+		const void* bytes = r.bytes( size );
+		if( !bytes ) return false;
+		arg.assign( (const char*)bytes, (const char*)bytes + size );
+	}
+	const uint64_t numRelocations = r.next();
+	for( uint64_t i = 0; i < numRelocations; i++ )
+	{
+		const uint64_t arg = r.next();
+		const uint64_t offset = r.next();
+		const uint64_t allocation = r.next();
+		char* ptr = ref( allocation, r.next() );
+		if( arg >= numArgs || offset + sizeof( ptr ) > args[arg].size() || !ptr ) return false;
+		memcpy( args[arg].data() + offset, &ptr, sizeof( ptr ) );
+	}
+
+	if( flags & OroCapture::FLAG_EXTRA )
+	{
+		if( numArgs != 1 ) return false;
+		size_t size = args[0].size();
+		void* extra[] = { HIP_LAUNCH_PARAM_BUFFER_POINTER, args[0].data(), HIP_LAUNCH_PARAM_BUFFER_SIZE, &size, HIP_LAUNCH_PARAM_END };
+		return oroModuleLaunchKernel( it->second, dims[0], dims[1], dims[2], dims[3], dims[4], dims[5], dims[6], s, nullptr, extra ) == oroSuccess;
+	}
+	std::vector<void*> params( numArgs );
+	for( uint64_t i = 0; i < numArgs; i++ )
+		params[i] = args[i].data();
+	return oroModuleLaunchKernel( it->second, dims[0], dims[1], dims[2], dims[3], dims[4], dims[5], dims[6], s, params.data(), nullptr ) == oroSuccess;
+}
+
+void Replayer::release()
+{
+	oroDeviceSynchronize();
+	m_asyncHost.clear();
+	for( auto& a : m_allocations )
+		oroFree( a.second );
+	for( auto& m : m_modules )
+		oroModuleUnload( m.second );
+	for( auto& e : m_events )
+		oroEventDestroy( e.second );
+	for( auto& s : m_streams )
+		oroStreamDestroy( s.second );
+}
+
+uint64_t now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+} // namespace
+
+int main( int argc, char** argv )
+{
+	std::vector<std::string> args;
+	oroApi api = ORO_API_HIP;
+	const char* hipPath = nullptr;
+	int deviceIndex = 0;
+	bool paced = false;
+	for( int i = 1; i < argc; i++ )
+	{
+		const std::string arg = argv[i];
+		if( arg == "cuda" )
+			api = ORO_API_CUDA;
+		else if( arg == "host" )
+			api = ORO_API_HOST;
+		else if( arg == "--hip" && i + 1 < argc )
+			hipPath = argv[++i];
+		else if( arg == "--device" && i + 1 < argc )
+			deviceIndex = atoi( argv[++i] );
+		else if( arg == "--paced" )
+			paced = true;
+		else
+			args.push_back( arg );
+	}
+	if( args.empty() )
+	{
+		printf( "usage: Replay <log> [cuda|host] [--hip <path of the HIP library>] [--device <index>] [--paced]\n" );
+		return 1;
+	}
+
+	FILE* f = fopen( args[0].c_str(), "rb" );
+	if( !f )
+	{
+		printf( "cannot read %s\n", args[0].c_str() );
+		return 1;
+	}
+	OroCapture::FileHeader header;
+	if( fread( &header, sizeof( header ), 1, f ) != 1 || memcmp( header.magic, OroCapture::MAGIC, sizeof( header.magic ) ) != 0 || header.version != OroCapture::VERSION )
+	{
+		printf( "%s is not a capture of this version\n", args[0].c_str() );
+		fclose( f );
+		return 1;
+	}
+	// the records are read at once, so reading doesn't add to the time of the calls.
+	std::vector<char> log;
+	char buffer[1 << 16];
+	for( size_t n; ( n = fread( buffer, 1, sizeof( buffer ), f ) ) > 0; )
+		log.insert( log.end(), buffer, buffer + n );
+	fclose( f );
+
+	const char* hipPaths[] = { hipPath, nullptr };
+	if( oroInitialize( api, 0, hipPath ? hipPaths : nullptr ) != 0 )
+	{
+		printf( "cannot initialize the API\n" );
+		return 1;
+	}
+	oroDevice device;
+	oroCtx ctx;
+	if( oroInit( 0 ) != oroSuccess || oroDeviceGet( &device, deviceIndex ) != oroSuccess || oroCtxCreate( &ctx, 0, device ) != oroSuccess )
+	{
+		printf( "cannot use the device %d\n", deviceIndex );
+		return 1;
+	}
+	oroDeviceProp props;
+	oroGetDeviceProperties( &props, device );
+	printf( "replaying %s ( captured on %s ) on %s\n", args[0].c_str(), ( header.api & ORO_API_CUDADRIVER ) ? "CUDA" : ( header.api == ORO_API_HOST ) ? "the host" : "HIP", props.name );
+
+	Replayer replayer;
+	std::vector<OpStats> stats( NUM_OPS );
+	std::vector<uint64_t> body;
+	uint64_t capturedEnd = 0;
+	const uint64_t begin = now();
+	for( size_t pos = 0; pos + sizeof( OroCapture::RecordHeader ) <= log.size(); )
+	{
+		OroCapture::RecordHeader record;
+		memcpy( &record, &log[pos], sizeof( record ) );
+		pos += sizeof( record );
+		if( pos + record.size > log.size() ) break;
+		// the bodies are copied to be aligned.
+		body.resize( record.size / sizeof( uint64_t ) );
+		memcpy( body.data(), &log[pos], record.size );
+		pos += record.size;
+		if( record.op >= NUM_OPS ) continue;
+
+		if( paced )
+		{
+			while( now() - begin < record.time )
+				std::this_thread::yield();
+		}
+		Reader r = { body.data(), body.size() };
+		const uint64_t start = now();
+		const bool replayed = replayer.replay( record.op, record.flags, r );
+		const uint64_t duration = now() - start;
+
+		OpStats& s = stats[record.op];
+		s.count++;
+		if( !replayed )
+			s.skipped++;
+		s.capturedNs += record.duration;
+		s.replayedNs += duration;
+		capturedEnd = record.time + record.duration;
+	}
+	replayer.release();
+	const uint64_t replayedEnd = now() - begin;
+
+	printf( "%-20s %10s %8s %14s %14s\n", "call", "count", "skipped", "captured(us)", "replayed(us)" );
+	for( int i = 1; i < NUM_OPS; i++ )
+	{
+		const OpStats& s = stats[i];
+		if( s.count == 0 ) continue;
+		printf( "%-20s %10llu %8llu %14.1f %14.1f\n", OP_NAMES[i], (unsigned long long)s.count, (unsigned long long)s.skipped, s.capturedNs / 1000.0, s.replayedNs / 1000.0 );
+	}
+	printf( "total: captured %.3f ms, replayed %.3f ms\n", capturedEnd / 1e6, replayedEnd / 1e6 );
+	if( replayer.m_mismatches )
+		printf( "%llu copies to the host differ from the capture\n", (unsigned long long)replayer.m_mismatches );
+
+	oroCtxDestroy( ctx );
+	return replayer.m_mismatches ? 2 : 0;
+}
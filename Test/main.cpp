@@ -35,7 +35,7 @@ int main(int argc, char** argv )
 		printf("initialization failed\n");
 		return OROCHI_TEST_RETCODE__ERROR;
 	}
-	printf( ">> executing on %s\n", ( api == ORO_API_HIP )? "hip":"cuda" );
+	printf( ">> executing on %s\n", ( api == ORO_API_HIP )? "hip" : ( api == ORO_API_HOST ) ? "host" : "cuda" );
 
 	printf(">> testing initialization\n");
 	ERROR_CHECK(oroInit( 0 ));
@@ -22,6 +22,9 @@
 
 #include "basicTests.h"
 #include "common.h"
+#include <Orochi/OrochiCapture.h>
+#include <future>
+#include <thread>
 
 TEST_F( OroTestBase, init )
 { 
@@ -39,6 +42,18 @@ TEST_F( OroTestBase, checkCUEW )
 	#endif
 }
 
+TEST_F( OroTestBase, deferredRtc )
+{
+	// the runtime compiler is available after oroInitialize, and loaded by the first orortc call at the latest
+	const oroApi rtc = ( oroGetCurAPI( 0 ) & ORO_API_CUDADRIVER ) ? ORO_API_CUDARTC : ORO_API_HIPRTC;
+	ASSERT_TRUE( oroLoadedAPI() & rtc );
+	int major = 0;
+	int minor = 0;
+	ASSERT_EQ( orortcVersion( &major, &minor ), ORORTC_SUCCESS );
+	ASSERT_FALSE( oroDeferredAPI() & rtc );
+	ASSERT_TRUE( oroLoadedAPI() & rtc );
+}
+
 TEST_F( OroTestBase, deviceprops )
 {
 	{
@@ -95,6 +110,580 @@ TEST_F( OroTestBase, kernelExec )
 	o.unloadKernelCache();
 }
 
+TEST_F( OroTestBase, getFunctions )
+{
+	OrochiUtils o;
+	const std::vector<const char*> funcNames = { "testKernel", "streamData" };
+	std::vector<oroFunction> kernels = o.getFunctionsFromFile( m_device, "../UnitTest/testKernel.h", funcNames, 0 );
+	ASSERT_EQ( kernels.size(), funcNames.size() );
+	for( oroFunction kernel : kernels )
+		ASSERT_TRUE( kernel != nullptr );
+
+	// already compiled functions are returned from the kernel cache
+	oroFunction kernel = o.getFunctionFromFile( m_device, "../UnitTest/testKernel.h", "streamData", 0 );
+	ASSERT_EQ( kernel, kernels[1] );
+	o.unloadKernelCache();
+}
+
+TEST_F( OroTestBase, kernelTelemetry )
+{
+	OrochiUtils o;
+	o.m_cacheDirectory = "./telemetryTest/";
+	std::filesystem::remove_all( o.m_cacheDirectory );
+	ASSERT_TRUE( o.getFunctionFromFile( m_device, "../UnitTest/testKernel.h", "testKernel", 0 ) != nullptr );
+	// already in the kernel map, so nothing is recorded
+	ASSERT_TRUE( o.getFunctionFromFile( m_device, "../UnitTest/testKernel.h", "testKernel", 0 ) != nullptr );
+
+	const std::vector<OrochiUtils::KernelTelemetry> telemetry = o.getTelemetry();
+	ASSERT_EQ( telemetry.size(), 1 );
+	ASSERT_EQ( telemetry[0].function, "testKernel" );
+	ASSERT_EQ( telemetry[0].cacheResult, "miss" );
+	ASSERT_GT( telemetry[0].compileMs, 0.0 );
+	ASSERT_GT( telemetry[0].binarySize, 0 );
+
+	ASSERT_TRUE( o.writeTelemetry( "./telemetryTest.json" ) );
+	ASSERT_TRUE( std::filesystem::file_size( "./telemetryTest.json" ) > 0 );
+	std::filesystem::remove( "./telemetryTest.json" );
+	o.unloadKernelCache();
+	std::filesystem::remove_all( o.m_cacheDirectory );
+}
+
+TEST_F( OroTestBase, cacheKeyOptionOrder )
+{
+	OrochiUtils o;
+	o.m_cacheDirectory = ( std::filesystem::temp_directory_path() / "oroOptionOrderTest/" ).string();
+	std::filesystem::remove_all( o.m_cacheDirectory );
+	// the last definition wins, so the order of the options changes the binary and the key.
+	std::vector<const char*> opts = { "-DA=1", "-DA=2" };
+	std::vector<const char*> reversed = { "-DA=2", "-DA=1" };
+	ASSERT_TRUE( o.getFunctionFromFile( m_device, "../UnitTest/testKernel.h", "testKernel", &opts ) != nullptr );
+	ASSERT_TRUE( o.getFunctionFromFile( m_device, "../UnitTest/testKernel.h", "testKernel", &reversed ) != nullptr );
+
+	const std::vector<OrochiUtils::KernelTelemetry> telemetry = o.getTelemetry();
+	ASSERT_EQ( telemetry.size(), 2 );
+	ASSERT_EQ( telemetry[1].cacheResult, "miss" );
+	ASSERT_NE( telemetry[0].cacheKey, telemetry[1].cacheKey );
+	o.unloadKernelCache();
+	std::filesystem::remove_all( o.m_cacheDirectory );
+}
+
+TEST_F( OroTestBase, getFunctionConcurrent )
+{
+	OrochiUtils o;
+	constexpr int nThreads = 8;
+	std::vector<oroFunction> kernels( nThreads, nullptr );
+	std::vector<std::thread> threads;
+	for( int i = 0; i < nThreads; i++ )
+	{
+		threads.emplace_back(
+			[&, i]()
+			{
+				oroCtxSetCurrent( m_ctx );
+				// half of the threads ask for the same kernel, the others for a different one
+				kernels[i] = o.getFunctionFromFile( m_device, "../UnitTest/testKernel.h", ( i % 2 ) ? "streamData" : "testKernel", 0 );
+			} );
+	}
+	for( std::thread& t : threads )
+		t.join();
+
+	for( int i = 0; i < nThreads; i++ )
+	{
+		ASSERT_TRUE( kernels[i] != nullptr );
+		// the same kernel is compiled only once, so every thread gets the same function
+		ASSERT_EQ( kernels[i], kernels[i % 2] );
+	}
+	o.unloadKernelCache();
+}
+
+TEST_F( OroTestBase, getFunctionMultiContext )
+{
+	OrochiUtils o;
+	o.m_cacheDirectory = "./multiContextTest/";
+	std::filesystem::remove_all( o.m_cacheDirectory );
+	oroFunction kernel0 = o.getFunctionFromFile( m_device, "../UnitTest/testKernel.h", "testKernel", 0 );
+	ASSERT_TRUE( kernel0 != nullptr );
+
+	// an other context gets its own function, loaded from the binary compiled for the first one
+	oroCtx ctx1 = nullptr;
+	OROCHECK( oroCtxCreate( &ctx1, 0, m_device ) );
+	OROCHECK( oroCtxSetCurrent( ctx1 ) );
+	oroFunction kernel1 = o.getFunctionFromFile( m_device, "../UnitTest/testKernel.h", "testKernel", 0 );
+	ASSERT_TRUE( kernel1 != nullptr );
+	ASSERT_NE( kernel0, kernel1 );
+	ASSERT_EQ( o.getCacheStats().misses, 1 );
+	ASSERT_EQ( o.getCacheStats().hits, 1 );
+
+	OROCHECK( oroCtxSetCurrent( m_ctx ) );
+	ASSERT_EQ( o.getFunctionFromFile( m_device, "../UnitTest/testKernel.h", "testKernel", 0 ), kernel0 );
+	o.unloadKernelCache();
+	OROCHECK( oroCtxDestroy( ctx1 ) );
+	OROCHECK( oroCtxSetCurrent( m_ctx ) );
+	std::filesystem::remove_all( o.m_cacheDirectory );
+}
+
+TEST_F( OroTestBase, contextApiPerThread )
+{
+	// the calls of a thread are dispatched to the API of its own current context
+	const oroApi api = oroGetCurAPI( 0 );
+	std::thread thread(
+		[&]()
+		{
+			OROCHECK( oroCtxSetCurrent( m_ctx ) );
+			ASSERT_EQ( oroGetCurAPI( 0 ), api );
+			oroDeviceptr ptr = 0;
+			OROCHECK( oroMalloc( &ptr, 16 ) );
+			OROCHECK( oroFree( ptr ) );
+		} );
+	thread.join();
+	ASSERT_EQ( oroGetCurAPI( 0 ), api );
+}
+
+TEST_F( OroTestBase, currentContext )
+{
+	oroCtx ctx = nullptr;
+	OROCHECK( oroCtxGetCurrent( &ctx ) );
+	ASSERT_EQ( ctx, m_ctx );
+
+	// the current context is tracked per thread, the one created is current
+	std::thread thread(
+		[&]()
+		{
+			OROCHECK( oroCtxSetCurrent( m_ctx ) );
+			oroCtx c = nullptr;
+			OROCHECK( oroCtxGetCurrent( &c ) );
+			ASSERT_EQ( c, m_ctx );
+
+			oroCtx ctx1;
+			OROCHECK( oroCtxCreate( &ctx1, 0, m_device ) );
+			OROCHECK( oroCtxGetCurrent( &c ) );
+			ASSERT_EQ( c, ctx1 );
+			OROCHECK( oroCtxDestroy( ctx1 ) );
+		} );
+	thread.join();
+	OROCHECK( oroCtxGetCurrent( &ctx ) );
+	ASSERT_EQ( ctx, m_ctx );
+
+	// a context destroyed by an other thread is not current anymore
+	oroCtx ctx2 = nullptr;
+	std::promise<void> created, destroyed;
+	std::thread other(
+		[&]()
+		{
+			const oroError result = oroCtxCreate( &ctx2, 0, m_device );
+			created.set_value();
+			OROCHECK( result );
+			destroyed.get_future().wait();
+			oroCtx c = nullptr;
+			oroCtxGetCurrent( &c );
+			ASSERT_NE( c, ctx2 );
+		} );
+	created.get_future().wait();
+	OROCHECK( oroCtxDestroy( ctx2 ) );
+	destroyed.set_value();
+	other.join();
+	OROCHECK( oroCtxGetCurrent( &ctx ) );
+	ASSERT_EQ( ctx, m_ctx );
+}
+
+TEST_F( OroTestBase, deviceSnapshot )
+{
+	const oroDeviceSnapshot* snapshot = oroGetDeviceSnapshot();
+	ASSERT_TRUE( snapshot != nullptr );
+	int n = 0;
+	OROCHECK( oroGetDeviceCount( &n ) );
+	ASSERT_EQ( snapshot->numDevices, n );
+	ASSERT_EQ( snapshot->numHipDevices + snapshot->numCudaDevices + snapshot->numHostDevices, n );
+
+	// the snapshot matches the driver
+	const int ordinal = oroDeviceGetOrdinal( m_device );
+	ASSERT_GE( ordinal, 0 );
+	ASSERT_EQ( snapshot->devices[ordinal], m_device );
+	oroDeviceProp props;
+	OROCHECK( oroGetDeviceProperties( &props, m_device ) );
+	const oroDeviceProp* cached = oroDeviceGetSnapshotProperties( m_device );
+	ASSERT_TRUE( cached != nullptr );
+	ASSERT_EQ( cached->multiProcessorCount, props.multiProcessorCount );
+	ASSERT_STREQ( cached->name, props.name );
+	ASSERT_TRUE( oroDeviceGetArchName( m_device ) != nullptr );
+	ASSERT_EQ( snapshot->peerAccess[ordinal * n + ordinal], 0 );
+}
+
+TEST_F( OroTestBase, traceCalls )
+{
+	oroTraceEnable( true );
+	oroDeviceptr ptr = 0;
+	OROCHECK( oroMalloc( &ptr, 16 ) );
+	OROCHECK( oroFree( ptr ) );
+	oroTraceEnable( false );
+
+	std::vector<oroTraceStats> stats( 1024 );
+	const int n = oroTraceGetStats( stats.data(), (int)stats.size() );
+	ASSERT_GE( n, 2 );
+	bool found = false;
+	for( int i = 0; i < std::min( n, (int)stats.size() ); i++ )
+	{
+		if( strcmp( stats[i].name, "oroMalloc" ) != 0 ) continue;
+		found = true;
+		ASSERT_GE( stats[i].count, 1 );
+		ASSERT_LE( stats[i].minNs, stats[i].maxNs );
+	}
+	ASSERT_TRUE( found );
+	const std::string path = ( std::filesystem::temp_directory_path() / "oroTrace.json" ).string();
+	OROCHECK( oroTraceWriteChromeTrace( path.c_str() ) );
+	// the calls have the values of their arguments
+	std::ifstream file( path );
+	const std::string trace( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>() );
+	file.close();
+	std::filesystem::remove( path );
+	ASSERT_NE( trace.find( "\"size\":16" ), std::string::npos );
+}
+
+TEST_F( OroTestBase, captureCalls )
+{
+	const std::string path = ( std::filesystem::temp_directory_path() / "oroCapture.bin" ).string();
+	std::vector<int> data( 64, 1 );
+	// an allocation made before the capture, tracked
+	oroCaptureTrackAllocations( true );
+	oroDeviceptr before = 0;
+	OROCHECK( oroMalloc( &before, data.size() * sizeof( int ) ) );
+	OROCHECK( oroCaptureBegin( path.c_str(), ORO_CAPTURE_DATA_ALL ) );
+	oroDeviceptr ptr = 0;
+	OROCHECK( oroMalloc( &ptr, data.size() * sizeof( int ) ) );
+	OROCHECK( oroMemcpyHtoD( ptr, data.data(), data.size() * sizeof( int ) ) );
+	OROCHECK( oroMemcpyDtoH( data.data(), ptr, data.size() * sizeof( int ) ) );
+	OROCHECK( oroFree( ptr ) );
+	OROCHECK( oroCaptureEnd() );
+	OROCHECK( oroFree( before ) );
+	oroCaptureTrackAllocations( false );
+
+	// the log has the header and a record of each call, in order
+	FILE* f = fopen( path.c_str(), "rb" );
+	ASSERT_TRUE( f != nullptr );
+	OroCapture::FileHeader header;
+	ASSERT_EQ( fread( &header, sizeof( header ), 1, f ), 1 );
+	ASSERT_EQ( header.version, OroCapture::VERSION );
+	std::vector<uint16_t> ops;
+	OroCapture::RecordHeader record;
+	while( fread( &record, sizeof( record ), 1, f ) == 1 )
+	{
+		ops.push_back( record.op );
+		fseek( f, record.size, SEEK_CUR );
+	}
+	fclose( f );
+	std::filesystem::remove( path );
+	// the allocation made before the capture is recorded first, with its content
+	ASSERT_EQ( ops, std::vector<uint16_t>( { OroCapture::MALLOC, OroCapture::MEMCPY_HTOD, OroCapture::MALLOC, OroCapture::MEMCPY_HTOD, OroCapture::MEMCPY_DTOH, OroCapture::FREE } ) );
+}
+
+TEST_F( OroDemoBase, hostBackend )
+{
+	// the host backend runs the kernels on the CPU, without driver
+	ASSERT_EQ( oroInitialize( ORO_API_HOST, 0 ), 0 );
+	OROCHECK( oroInit( 0 ) );
+	oroDevice device;
+	oroCtx ctx;
+	OROCHECK( oroDeviceGet( &device, 0 ) );
+	OROCHECK( oroCtxCreate( &ctx, 0, device ) );
+	ASSERT_EQ( oroGetCurAPI( 0 ), ORO_API_HOST );
+	oroDeviceProp props;
+	OROCHECK( oroGetDeviceProperties( &props, device ) );
+	ASSERT_EQ( props.warpSize, 32 );
+
+	{
+		OrochiUtils o;
+		int* a = nullptr;
+		OROCHECK( oroMalloc( (oroDeviceptr*)&a, sizeof( int ) ) );
+		OROCHECK( oroMemset( (oroDeviceptr)a, 0, sizeof( int ) ) );
+		oroFunction kernel = o.getFunctionFromFile( device, "../UnitTest/testKernel.h", "testKernel", 0 );
+		ASSERT_TRUE( kernel != nullptr );
+		const void* args[] = { &a };
+		OrochiUtils::launch1D( kernel, 64, args, 64 );
+		OrochiUtils::waitForCompletion();
+		int aHost = -1;
+		OROCHECK( oroMemcpyDtoH( &aHost, (oroDeviceptr)a, sizeof( int ) ) );
+		ASSERT_EQ( aHost, 2016 );
+
+		// the threads of a block share __shared__ and switch at __syncthreads and the warp functions. only the first warp shuffles
+		// before the first __syncthreads, the other ones must still wait for it there.
+		const char* code = R"(
+extern "C" __global__ void warps( int* data )
+{
+	__shared__ int s[128];
+	const int i = blockIdx.x * blockDim.x + threadIdx.x;
+	const int lane = threadIdx.x % warpSize;
+	int v = data[i];
+	if( threadIdx.x < warpSize ) v = __shfl_xor( v, 1 );
+	s[threadIdx.x] = v;
+	__syncthreads();
+	data[i] = s[blockDim.x - 1 - threadIdx.x];
+	data[256 + i] = __shfl( i, warpSize - 1 - lane );
+	data[512 + i] = (int)__ballot( lane % 3 == 0 );
+	data[768 + i] = __syncthreads_count( lane == 0 );
+}
+)";
+		kernel = o.getFunctionFromString( device, code, "warps", "warps", nullptr, 0, nullptr, nullptr );
+		ASSERT_TRUE( kernel != nullptr );
+		std::vector<int> data( 4 * 256 );
+		for( int i = 0; i < 256; i++ )
+			data[i] = i;
+		int* d = nullptr;
+		OROCHECK( oroMalloc( (oroDeviceptr*)&d, data.size() * sizeof( int ) ) );
+		oroStream stream;
+		oroEvent start, stop;
+		OROCHECK( oroStreamCreate( &stream ) );
+		OROCHECK( oroEventCreateWithFlags( &start, oroEventDefault ) );
+		OROCHECK( oroEventCreateWithFlags( &stop, oroEventDefault ) );
+		OROCHECK( oroMemcpyHtoDAsync( (oroDeviceptr)d, data.data(), data.size() * sizeof( int ), stream ) );
+		OROCHECK( oroEventRecord( start, stream ) );
+		const void* warpsArgs[] = { &d };
+		OROCHECK( oroModuleLaunchKernel( kernel, 2, 1, 1, 128, 1, 1, 0, stream, (void**)warpsArgs, nullptr ) );
+		OROCHECK( oroEventRecord( stop, stream ) );
+		OROCHECK( oroMemcpyDtoHAsync( data.data(), (oroDeviceptr)d, data.size() * sizeof( int ), stream ) );
+		OROCHECK( oroStreamSynchronize( stream ) );
+		for( int i = 0; i < 256; i++ )
+		{
+			const int block = ( i / 128 ) * 128;
+			const int reversed = 127 - i % 128;
+			ASSERT_EQ( data[i], block + ( ( reversed < 32 ) ? ( reversed ^ 1 ) : reversed ) );
+			ASSERT_EQ( data[256 + i], ( i / 32 ) * 32 + 31 - i % 32 );
+			ASSERT_EQ( (unsigned int)data[512 + i], 0x49249249u );
+			ASSERT_EQ( data[768 + i], 4 );
+		}
+		float ms = -1.f;
+		OROCHECK( oroEventElapsedTime( &ms, start, stop ) );
+		ASSERT_GE( ms, 0.f );
+
+		OROCHECK( oroEventDestroy( start ) );
+		OROCHECK( oroEventDestroy( stop ) );
+		OROCHECK( oroStreamDestroy( stream ) );
+		OROCHECK( oroFree( (oroDeviceptr)d ) );
+		OROCHECK( oroFree( (oroDeviceptr)a ) );
+		o.unloadKernelCache();
+	}
+	OROCHECK( oroCtxDestroy( ctx ) );
+}
+
+TEST_F( OroTestBase, compileAsync )
+{
+	OrochiUtils o;
+	std::vector<OrochiUtils::CompileRequest> requests( 2 );
+	requests[0].path = "../UnitTest/testKernel.h";
+	requests[0].funcNames = { "testKernel", "streamData" };
+	requests[1].path = "../UnitTest/testKernel.h";
+	requests[1].funcNames = { "testKernel" };
+	requests[1].options = { "-DTEST_ASYNC" };
+
+	// onCompletion runs after the futures are ready, so it's waited for on its own.
+	std::atomic<int> completed = 0;
+	std::promise<void> done;
+	auto futures = o.compileAsync( m_device, requests, [&]() { completed++; done.set_value(); } );
+	ASSERT_EQ( futures.size(), requests.size() );
+	for( size_t i = 0; i < futures.size(); i++ )
+	{
+		const std::vector<oroFunction>& kernels = futures[i].get();
+		ASSERT_EQ( kernels.size(), requests[i].funcNames.size() );
+		for( oroFunction kernel : kernels )
+			ASSERT_TRUE( kernel != nullptr );
+	}
+
+	// the asynchronous compilations fill the same kernel cache as the synchronous calls
+	oroFunction kernel = o.getFunctionFromFile( m_device, "../UnitTest/testKernel.h", "streamData", 0 );
+	ASSERT_EQ( kernel, futures[0].get()[1] );
+
+	std::vector<oroFunction> kernels = o.getFunctionsAsync( m_device, "../UnitTest/testKernel.h", { "testKernel" }, 0 ).get();
+	ASSERT_EQ( kernels.size(), 1 );
+	ASSERT_EQ( kernels[0], futures[0].get()[0] );
+	done.get_future().wait();
+	o.unloadKernelCache();
+	ASSERT_EQ( completed, 1 );
+}
+
+TEST_F( OroTestBase, kernelCacheBudget )
+{
+	OrochiUtils o;
+	o.m_cacheDirectory = "./cacheBudgetTest/";
+	std::filesystem::remove_all( o.m_cacheDirectory );
+	o.m_cacheMaxEntries = 1;
+
+	// a temporary file left by a crashed writer, and the lock of an entry which was removed: stale, so removed by the budget
+	std::filesystem::create_directories( o.m_cacheDirectory );
+	const std::filesystem::path staleFiles[] = { std::filesystem::path( o.m_cacheDirectory ) / "testKernel-0.bin.tmp1_0", std::filesystem::path( o.m_cacheDirectory ) / "testKernel-0.bin.lock" };
+	for( const std::filesystem::path& file : staleFiles )
+	{
+		std::ofstream( file ).put( 0 );
+		std::filesystem::last_write_time( file, std::filesystem::file_time_type::clock::now() - std::chrono::hours( 2 ) );
+	}
+
+	std::vector<const char*> opts = { "-DCACHE_BUDGET_TEST=1" };
+	ASSERT_TRUE( o.getFunctionFromFile( m_device, "../UnitTest/testKernel.h", "testKernel", &opts ) != nullptr );
+	opts[0] = "-DCACHE_BUDGET_TEST=2";
+	ASSERT_TRUE( o.getFunctionFromFile( m_device, "../UnitTest/testKernel.h", "testKernel", &opts ) != nullptr );
+
+	OrochiUtils::CacheStats stats = o.getCacheStats();
+	ASSERT_EQ( stats.entries, 1 );
+	ASSERT_EQ( stats.misses, 2 );
+	ASSERT_EQ( stats.evictions, 1 );
+	for( const std::filesystem::path& file : staleFiles )
+		ASSERT_FALSE( std::filesystem::exists( file ) );
+	o.unloadKernelCache();
+
+	// the entry that was kept is a hit for a new OrochiUtils
+	OrochiUtils o2;
+	o2.m_cacheDirectory = o.m_cacheDirectory;
+	ASSERT_TRUE( o2.getFunctionFromFile( m_device, "../UnitTest/testKernel.h", "testKernel", &opts ) != nullptr );
+	ASSERT_EQ( o2.getCacheStats().hits, 1 );
+	o2.unloadKernelCache();
+	std::filesystem::remove_all( o.m_cacheDirectory );
+}
+
+TEST_F( OroTestBase, cacheBundle )
+{
+	if( oroGetCurAPI( 0 ) != ORO_API_HIP ) return;
+
+	oroDeviceProp props;
+	OROCHECK( oroGetDeviceProperties( &props, m_device ) );
+	const std::string arch = std::string( props.gcnArchName ).substr( 0, std::string( props.gcnArchName ).find( ':' ) );
+
+	std::string source;
+	ASSERT_TRUE( OrochiUtils::readSourceCode( "../UnitTest/testKernel.h", source ) );
+	std::string key;
+	std::vector<char> binary;
+	ASSERT_TRUE( OrochiUtils::compileForCacheBundle( source.c_str(), "../UnitTest/testKernel.h", nullptr, arch.c_str(), 0, nullptr, nullptr, key, binary ) );
+	ASSERT_TRUE( OrochiUtils::writeCacheBundle( "./testKernel.bundle", { { key, binary } } ) );
+
+	// with an empty cache directory, the kernel comes from the bundle without compiling
+	OrochiUtils o;
+	o.m_cacheDirectory = "./cacheBundleTest/";
+	std::filesystem::remove_all( o.m_cacheDirectory );
+	ASSERT_TRUE( o.mountCacheBundle( "./testKernel.bundle" ) );
+	ASSERT_TRUE( o.getFunctionFromFile( m_device, "../UnitTest/testKernel.h", "testKernel", 0 ) != nullptr );
+	ASSERT_EQ( o.getCacheStats().hits, 1 );
+	ASSERT_EQ( o.getCacheStats().misses, 0 );
+	o.unloadKernelCache();
+	std::filesystem::remove( "./testKernel.bundle" );
+}
+
+TEST_F( OroTestBase, embeddedBinary )
+{
+	if( oroGetCurAPI( 0 ) != ORO_API_HIP ) return;
+
+	oroDeviceProp props;
+	OROCHECK( oroGetDeviceProperties( &props, m_device ) );
+	const std::string arch = std::string( props.gcnArchName ).substr( 0, std::string( props.gcnArchName ).find( ':' ) );
+
+	std::string source;
+	ASSERT_TRUE( OrochiUtils::readSourceCode( "../UnitTest/testKernel.h", source ) );
+	std::string key;
+	std::vector<char> binary;
+	ASSERT_TRUE( OrochiUtils::compileForCacheBundle( source.c_str(), "../UnitTest/testKernel.h", nullptr, arch.c_str(), 0, nullptr, nullptr, key, binary ) );
+
+	// the binary of an other architecture is never selected
+	const unsigned char* data = reinterpret_cast<const unsigned char*>( binary.data() );
+	const OrochiUtils::EmbeddedBinary binaries[] = { { "gfx000", data, binary.size() }, { arch.c_str(), data, binary.size() } };
+	ASSERT_TRUE( OrochiUtils::findEmbeddedBinary( m_device, binaries, 1 ) == nullptr );
+	const OrochiUtils::EmbeddedBinary* embedded = OrochiUtils::findEmbeddedBinary( m_device, binaries, 2 );
+	ASSERT_EQ( embedded, &binaries[1] );
+
+	OrochiUtils o;
+	const std::vector<const char*> funcNames = { "testKernel", "streamData" };
+	std::vector<oroFunction> kernels = o.getFunctionsFromBinary( "testKernel." + arch, embedded->data, embedded->size, funcNames );
+	ASSERT_EQ( kernels.size(), funcNames.size() );
+	for( oroFunction kernel : kernels )
+		ASSERT_TRUE( kernel != nullptr );
+	ASSERT_EQ( o.getTelemetry().front().cacheResult, "embedded" );
+	o.unloadKernelCache();
+}
+
+TEST_F( OroTestBase, includeRegistry )
+{
+	// the header only exists in memory
+	OrochiUtils o;
+	o.registerInclude( "registry/testValue.h", "#pragma once\n#define TEST_VALUE 2016\n" );
+	const char* source = "#include <registry/testValue.h>\n"
+						 "extern \"C\" __global__ void registryKernel( int* a ) { *a = TEST_VALUE; }\n";
+	oroFunction kernel = o.getFunctionFromString( m_device, source, "registryKernel.h", "registryKernel", 0, 0, nullptr, nullptr );
+	ASSERT_TRUE( kernel != nullptr );
+
+	int a_host = -1;
+	int* a_device = nullptr;
+	OROCHECK( oroMalloc( (oroDeviceptr*)&a_device, sizeof( int ) ) );
+	const void* args[] = { &a_device };
+	OrochiUtils::launch1D( kernel, 1, args, 1 );
+	OrochiUtils::waitForCompletion();
+	OROCHECK( oroMemcpyDtoH( &a_host, (oroDeviceptr)a_device, sizeof( int ) ) );
+	ASSERT_EQ( a_host, 2016 );
+	OROCHECK( oroFree( (oroDeviceptr)a_device ) );
+	o.unloadKernelCache();
+}
+
+TEST_F( OroTestBase, templatedFunction )
+{
+	const char* source = "template<typename T, int N, bool NEGATE>\n"
+						 "__global__ void fillKernel( T* a ) { *a = NEGATE ? -T( N ) : T( N ); }\n";
+	const std::vector<const char*> nameExpressions = { "fillKernel<int, 8, true>", "fillKernel<int, 4, false>" };
+
+	// both instantiations come from the same compilation
+	OrochiUtils o;
+	std::vector<oroFunction> kernels = o.getTemplatedFunctions( m_device, source, "fillKernel.h", nameExpressions, 0 );
+	ASSERT_EQ( kernels.size(), nameExpressions.size() );
+	ASSERT_EQ( o.getTemplatedFunction( m_device, source, "fillKernel.h", "fillKernel<int, 4, false>", 0 ), kernels[1] );
+
+	int* a_device = nullptr;
+	OROCHECK( oroMalloc( (oroDeviceptr*)&a_device, sizeof( int ) ) );
+	const int expected[] = { -8, 4 };
+	for( int i = 0; i < 2; i++ )
+	{
+		int a_host = 0;
+		const void* args[] = { &a_device };
+		OrochiUtils::launch1D( kernels[i], 1, args, 1 );
+		OrochiUtils::waitForCompletion();
+		OROCHECK( oroMemcpyDtoH( &a_host, (oroDeviceptr)a_device, sizeof( int ) ) );
+		ASSERT_EQ( a_host, expected[i] );
+	}
+	OROCHECK( oroFree( (oroDeviceptr)a_device ) );
+	o.unloadKernelCache();
+
+	// the lowered names are loaded from the disk cache with the binary
+	OrochiUtils o2;
+	ASSERT_EQ( o2.getTemplatedFunctions( m_device, source, "fillKernel.h", nameExpressions, 0 ).size(), nameExpressions.size() );
+	ASSERT_EQ( o2.getCacheStats().hits, 1 );
+	o2.unloadKernelCache();
+}
+
+TEST_F( OroTestBase, specializedFunction )
+{
+	OrochiUtils o;
+	o.m_specializationThreshold = 2;
+	const char* path = "../UnitTest/testKernel.h";
+	oroFunction generic = o.getFunctionFromFile( m_device, path, "specializationKernel", 0 );
+	ASSERT_TRUE( generic != nullptr );
+
+	// the variant is compiled in the background once the value was stable, the generic kernel is used meanwhile
+	int value = 7;
+	oroFunction kernel = generic;
+	for( int i = 0; i < 1000 && kernel == generic; i++ )
+	{
+		kernel = o.getSpecializedFunction( m_device, path, "specializationKernel", 0, { { "SPECIALIZED_VALUE", value } } );
+		if( kernel == generic ) std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+	}
+	ASSERT_TRUE( kernel != generic );
+
+	int a_host = 0;
+	int* a_device = nullptr;
+	OROCHECK( oroMalloc( (oroDeviceptr*)&a_device, sizeof( int ) ) );
+	const void* args[] = { &a_device, &value };
+	OrochiUtils::launch1D( kernel, 1, args, 1 );
+	OrochiUtils::waitForCompletion();
+	OROCHECK( oroMemcpyDtoH( &a_host, (oroDeviceptr)a_device, sizeof( int ) ) );
+	ASSERT_EQ( a_host, value + 1 );
+	OROCHECK( oroFree( (oroDeviceptr)a_device ) );
+
+	// opt-out
+	o.setSpecializationEnabled( path, "specializationKernel", 0, false );
+	ASSERT_EQ( o.getSpecializedFunction( m_device, path, "specializationKernel", 0, { { "SPECIALIZED_VALUE", value } } ), generic );
+	o.unloadKernelCache();
+}
+
 TEST_F( OroTestBase, GpuMemoryTest )
 {
 	OrochiUtils o;
@@ -359,6 +948,63 @@ TEST_F( OroTestBase, link )
 		ORORTCCHECK( oroModuleUnload( module ) );
 	}
 }
+
+TEST_F( OroTestBase, linkCache )
+{
+	oroDeviceProp props;
+	OROCHECK( oroGetDeviceProperties( &props, m_device ) );
+	const bool isAmd = oroGetCurAPI( 0 ) == ORO_API_HIP;
+
+	std::string arch = "-arch=sm_" + std::to_string( props.major ) + std::string( "0" );
+	std::vector<const char*> opts = isAmd ? std::vector<const char*>( { "-fgpu-rdc", "-c", "--cuda-device-only" } ) : std::vector<const char*>( { "--device-c", arch.c_str() } );
+	const orortcJITInputType type = isAmd ? ORORTC_JIT_INPUT_LLVM_BITCODE : ORORTC_JIT_INPUT_CUBIN;
+
+	OrochiUtils o;
+	o.m_cacheDirectory = "./linkCacheTest/";
+	std::filesystem::remove_all( o.m_cacheDirectory );
+
+	// the second pass takes the bitcode and the linked binary from the cache
+	for( int pass = 0; pass < 2; pass++ )
+	{
+		std::vector<char> data0;
+		std::vector<char> data1;
+		{
+			std::string code;
+			OrochiUtils::readSourceCode( "../UnitTest/moduleTestKernel.h", code );
+			ASSERT_TRUE( o.getCachedData( m_device, code.c_str(), "../UnitTest/moduleTestKernel.h", &opts, data1 ) );
+		}
+		{
+			std::string code;
+			OrochiUtils::readSourceCode( "../UnitTest/moduleTestFunc.h", code );
+			ASSERT_TRUE( o.getCachedData( m_device, code.c_str(), "../UnitTest/moduleTestFunc.h", &opts, data0 ) );
+		}
+
+		std::vector<char> binary;
+		ASSERT_TRUE( o.getLinkedBinary( m_device, { { type, data1.data(), data1.size() }, { type, data0.data(), data0.size() } }, 0, nullptr, nullptr, binary ) );
+
+		oroModule module;
+		OROCHECK( oroModuleLoadData( &module, binary.data() ) );
+		oroFunction function = nullptr;
+		OROCHECK( oroModuleGetFunction( &function, module, "testKernel" ) );
+
+		int x_host = -1;
+		int* x_device = nullptr;
+		OROCHECK( oroMalloc( (oroDeviceptr*)&x_device, sizeof( int ) ) );
+		OROCHECK( oroMemset( (oroDeviceptr)x_device, 0, sizeof( int ) ) );
+		const void* args[] = { &x_device };
+		OrochiUtils::launch1D( function, 64, args, 64 );
+		OrochiUtils::waitForCompletion();
+		OROCHECK( oroMemcpyDtoH( &x_host, (oroDeviceptr)x_device, sizeof( int ) ) );
+		ASSERT_EQ( x_host, 2016 );
+		OROCHECK( oroFree( (oroDeviceptr)x_device ) );
+		OROCHECK( oroModuleUnload( module ) );
+	}
+
+	const OrochiUtils::CacheStats stats = o.getCacheStats();
+	ASSERT_EQ( stats.misses, 3 );
+	ASSERT_EQ( stats.hits, 3 );
+	std::filesystem::remove_all( o.m_cacheDirectory );
+}
 #if 0
 TEST_F( OroTestBase, link_addFile )
 {
@@ -56,4 +56,11 @@ extern "C" __global__ void streamData(float *ptr, const size_t n,
   		accum += ptr[idx]; 
   }
    output[threadIdx.x] = accum; 
-}
\ No newline at end of file
+}
+extern "C" __global__ void specializationKernel( int* __restrict__ a, int value )
+{
+#if defined( SPECIALIZED_VALUE )
+	value = SPECIALIZED_VALUE + 1;
+#endif
+	*a = value;
+}
@@ -1511,9 +1511,13 @@ enum {
   // error code if the major version of the API used to compiled is more recent than the one of the driver
   // It doesn't seem a good idea to use an API that is unkonwn by the driver.
   CUEW_ERROR_OLD_DRIVER = -4, 
+
+  // the library is loaded by the first call of one of its functions ( see cuewNvrtcStatus ).
+  CUEW_DEFERRED = 1,
 };
 
-enum { CUEW_INIT_CUDA = 1, CUEW_INIT_NVRTC = 2 };
+// CUEW_INIT_EAGER resolves all the symbols in cuewInit. by default, each function is resolved the first time it's called.
+enum { CUEW_INIT_CUDA = 1, CUEW_INIT_NVRTC = 2, CUEW_INIT_EAGER = 4 };
 
 
 
@@ -1523,6 +1527,8 @@ const char *cuewErrorString(CUresult result);
 const char *cuewCompilerPath(void);
 int cuewCompilerVersion(void);
 int cuewNvrtcVersion(void);
+// CUEW_DEFERRED until nvrtc is loaded, then the result of its load.
+int cuewNvrtcStatus(void);
 
 
 
@@ -42,6 +42,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <atomic>
+#include <mutex>
+#include <type_traits>
 
 
 #ifdef OROCHI_ENABLE_CUEW
@@ -73,12 +76,68 @@ typedef void *DynamicLibrary;
         name##_oro = (t##name *)dynamic_library_find(lib, #name); \
         assert(name);
 
-#define _LIBRARY_FIND(lib, name)  name##_oro = (t##name *)dynamic_library_find(lib, #name);
+#define _LIBRARY_FIND_EAGER(lib, name)  name##_oro = (t##name *)dynamic_library_find(lib, #name);
+
+// By default, the function pointers are trampolines: the first call resolves the symbol, once for all the threads, and the calls go
+// through it, so cuewInit doesn't look up the whole API. CUEW_INIT_EAGER resolves every symbol in cuewInit instead.
+// the trampolines don't patch the function pointers, as the other threads read them without synchronization.
+// lib must have a static storage, as the trampolines read it when they are called.
+#define _LIBRARY_FIND(lib, name)  name##_oro = cuew_lazy ? static_cast<t##name *>( []( auto... args ) { static CuewLazySymbol<t##name> symbol; return cuewLazyCall( symbol, #name, lib, args... ); } ) \
+                                                         : (t##name *)dynamic_library_find(lib, #name);
 
 
 static DynamicLibrary cuda_lib = NULL;
 static DynamicLibrary cudart_lib = NULL;
-static DynamicLibrary nvrtc_lib = NULL;
+static DynamicLibrary nvrtc_handle = NULL;
+static int cuew_lazy = 1;
+
+// nvrtc is loaded the first time a symbol is searched in it, so it's only mapped by the processes which use it ( see cuewLoadNvrtc ).
+struct CuewNvrtcLibrary { operator DynamicLibrary() const; };
+static CuewNvrtcLibrary nvrtc_lib;
+
+template<typename R>
+static constexpr bool cuewIsStatus = std::is_same<R, CUresult>::value || std::is_same<R, cudaError_t>::value || std::is_same<R, nvrtcResult>::value;
+
+// the result of a function whose symbol is missing from the library.
+// the status is an error, the other types are a value the caller can tell from a result, or a default value after a message.
+template<typename R>
+static R cuewMissingSymbol()
+{
+  if constexpr( std::is_same<R, CUresult>::value ) return CUDA_ERROR_SHARED_OBJECT_SYMBOL_NOT_FOUND;
+  else if constexpr( std::is_same<R, cudaError_t>::value ) return cudaErrorSharedObjectSymbolNotFound;
+  else if constexpr( std::is_same<R, nvrtcResult>::value ) return NVRTC_ERROR_INTERNAL_ERROR;
+  else if constexpr( std::is_same<R, const char*>::value ) return "cuew: symbol not found";
+  else {
+    static_assert( std::is_class<R>::value, "the result of a missing symbol must be defined" );
+    return R{};
+  }
+}
+
+// the symbol of a function, resolved by its first call.
+template<typename F>
+struct CuewLazySymbol
+{
+  std::once_flag once;
+  F* fn = NULL;
+};
+
+// the calls of a function with lazy resolution. the first one resolves the symbol, the concurrent ones wait for it.
+// lib is a DynamicLibrary or nvrtc_lib, only converted by the first call.
+template<typename F, typename L, typename... Args>
+static auto cuewLazyCall( CuewLazySymbol<F>& symbol, const char* name, const L& lib, Args... args )
+{
+  using R = decltype( symbol.fn( args... ) );
+  std::call_once( symbol.once, [&]() {
+    symbol.fn = (F *)dynamic_library_find(static_cast<DynamicLibrary>(lib), name);
+    if (symbol.fn == NULL && !cuewIsStatus<R>) {
+      fprintf(stderr, "CUDA: %s not found in the library\n", name);
+    }
+  } );
+  if (symbol.fn == NULL) {
+    return cuewMissingSymbol<R>();
+  }
+  return symbol.fn( args... );
+}
 
 
 
@@ -1605,6 +1664,9 @@ _LIBRARY_FIND( cudart_lib, cudaWaitExternalSemaphoresAsync_v2 );
 ///// (region automatically generated by Orochi Summoner)
 #pragma endregion
 
+  // called right away by cuewInit to check the version, so resolved now to know if it exists.
+  _LIBRARY_FIND_EAGER( cudart_lib, cudaRuntimeGetVersion );
+
 
 
 
@@ -1619,14 +1681,14 @@ _LIBRARY_FIND( cudart_lib, cudaWaitExternalSemaphoresAsync_v2 );
 
 static void cuewExitNvrtc(void)
 {
-  if (nvrtc_lib != NULL) {
+  if (nvrtc_handle != NULL) {
     /*  Ignore errors. */
-    dynamic_library_close(nvrtc_lib);
-    nvrtc_lib = NULL;
+    dynamic_library_close(nvrtc_handle);
+    nvrtc_handle = NULL;
   }
 }
 
-static int cuewNvrtcInit(void)
+static int cuewOpenNvrtc(void)
 {
   /* Library paths. */
 #ifdef _WIN32
@@ -1653,9 +1715,60 @@ static int cuewNvrtcInit(void)
     NULL
   };
 #endif
+  int error = atexit(cuewExitNvrtc);
+  if (error) {
+    return CUEW_ERROR_ATEXIT_FAILED;
+  }
+
+  /* Load library. */
+  nvrtc_handle = dynamic_library_open_find(nvrtc_paths);
+
+  if (nvrtc_handle == NULL) {
+    return CUEW_ERROR_OPEN_FAILED;
+  }
+
+#ifndef CUEW_DO_NOT_CHECK_VERSION // not recommanded to define this flag, but just give a possibility for the developer to do it...
+  tnvrtcVersion *version = (tnvrtcVersion *)dynamic_library_find(nvrtc_handle, "nvrtcVersion");
+  if (version)
+  {
+    int major, minor = 0;
+    version(&major, &minor);
+    if ( (int)CUDA_VERSION / (int)1000 > major )
+    {
+      return CUEW_ERROR_OLD_DRIVER;
+    }
+  }
+#endif
+
+  return CUEW_SUCCESS;
+}
+
+static std::atomic<int> nvrtc_status( CUEW_NOT_INITIALIZED );
+
+// loads nvrtc the first time it's called ( thread-safe ), and returns the result.
+static int cuewLoadNvrtc(void)
+{
+  static const int result = cuewOpenNvrtc();
+  nvrtc_status = result;
+  return result;
+}
+
+CuewNvrtcLibrary::operator DynamicLibrary() const
+{
+  cuewLoadNvrtc();
+  return nvrtc_handle;
+}
+
+int cuewNvrtcStatus(void)
+{
+  const int status = nvrtc_status;
+  return status == CUEW_NOT_INITIALIZED ? CUEW_DEFERRED : status;
+}
+
+static int cuewNvrtcInit(void)
+{
   static int initialized = 0;
   static int result = 0;
-  int error;
 
   if (initialized) {
     return result;
@@ -1663,18 +1776,12 @@ static int cuewNvrtcInit(void)
 
   initialized = 1;
 
-  error = atexit(cuewExitNvrtc);
-  if (error) {
-    result = CUEW_ERROR_ATEXIT_FAILED;
-    return result;
-  }
-
-  /* Load library. */
-  nvrtc_lib = dynamic_library_open_find(nvrtc_paths);
-
-  if (nvrtc_lib == NULL) {
-    result = CUEW_ERROR_OPEN_FAILED;
-    return result;
+  // with the lazy resolution, nvrtc is loaded by the first call of one of its functions.
+  if (!cuew_lazy) {
+    result = cuewLoadNvrtc();
+    if (result == CUEW_ERROR_ATEXIT_FAILED || result == CUEW_ERROR_OPEN_FAILED) {
+      return result;
+    }
   }
 
 #pragma region OROCHI_SUMMONER_REGION_cuew_cpp_rtc
@@ -1711,7 +1818,9 @@ _LIBRARY_FIND( nvrtc_lib, nvrtcVersion );
 ///// (region automatically generated by Orochi Summoner)
 #pragma endregion
 
-  result = CUEW_SUCCESS;
+  if (cuew_lazy) {
+    result = CUEW_DEFERRED;
+  }
   return result;
 }
 
@@ -1721,6 +1830,7 @@ void cuewInit( int* resultDriver, int* resultRtc, cuuint32_t flags )
   *resultRtc = CUEW_NOT_INITIALIZED;
 
   const int includeVersion_major = (int)CUDA_VERSION / (int)1000;
+  cuew_lazy = ( flags & CUEW_INIT_EAGER ) == 0;
 
   if (flags & CUEW_INIT_CUDA) 
   {
@@ -1743,20 +1853,9 @@ void cuewInit( int* resultDriver, int* resultRtc, cuuint32_t flags )
   }
   if (flags & CUEW_INIT_NVRTC) 
   {
+    // the version is checked when nvrtc is loaded.
     *resultRtc = cuewNvrtcInit();
 
-#ifndef CUEW_DO_NOT_CHECK_VERSION // not recommanded to define this flag, but just give a possibility for the developer to do it...
-    if (nvrtcVersion_oro) 
-    {
-      int major, minor = 0;
-      nvrtcVersion_oro(&major, &minor);
-      if ( includeVersion_major > major )
-      {
-        *resultRtc = CUEW_ERROR_OLD_DRIVER;
-      }
-    }
-#endif
-
   }
 
 
@@ -1981,8 +2080,7 @@ const char *cuewCompilerPath(void)
 int cuewNvrtcVersion(void)
 {
   int major, minor;
-  if (nvrtcVersion_oro) {
-    nvrtcVersion_oro(&major, &minor);
+  if (nvrtcVersion_oro && nvrtcVersion_oro(&major, &minor) == NVRTC_SUCCESS) {
     return 10 * major + minor;
   }
   return 0;
@@ -2536,11 +2536,16 @@ enum {
   // error code if the major version of the API used to compiled is more recent than the one of the driver
   // It doesn't seem a good idea to use an API that is unkonwn by the driver.
   HIPEW_ERROR_OLD_DRIVER = -4,
+
+  // the library is loaded by the first call of one of its functions ( see hipewRtcStatus ).
+  HIPEW_DEFERRED = 1,
 };
 
 enum {
 	HIPEW_INIT_HIPDRIVER = 1 << 0,
 	HIPEW_INIT_HIPRTC = 1 << 1,
+	// resolve all the symbols in hipewInit. by default, each function is resolved the first time it's called.
+	HIPEW_INIT_EAGER = 1 << 2,
 };
 
 #ifdef __cplusplus
@@ -2557,6 +2562,9 @@ enum {
 // customPaths_Hiprtc[] = {"hiprtc0600.dll", "hiprtc0507.dll", NULL};
 void hipewInit( int* resultDriver, int* resultRtc, uint32_t flags, const char** customPaths_Hip hipew__dparm(0), const char** customPaths_Hiprtc hipew__dparm(0));
 
+// HIPEW_DEFERRED until hiprtc is loaded, then the result of its load.
+int hipewRtcStatus(void);
+
 const char *hipewErrorString(hipError_t result);
 const char *hipewCompilerPath(void);
 int hipewCompilerVersion(void);
@@ -41,6 +41,11 @@
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 #ifdef _WIN32
 #  define WIN32_LEAN_AND_MEAN
@@ -68,12 +73,69 @@ typedef void* DynamicLibrary;
         name = (t##name *)dynamic_library_find(lib, #name); \
         assert(name);
 
-#define _LIBRARY_FIND(lib, name) \
+#define _LIBRARY_FIND_EAGER(lib, name) \
         name = (t##name *)dynamic_library_find(lib, #name);
 
+// By default, the function pointers are trampolines: the first call resolves the symbol, once for all the threads, and the calls go
+// through it, so hipewInit doesn't look up the whole API. HIPEW_INIT_EAGER resolves every symbol in hipewInit instead.
+// the trampolines don't patch the function pointers, as the other threads read them without synchronization.
+// lib must have a static storage, as the trampolines read it when they are called.
+#define _LIBRARY_FIND(lib, name) \
+        name = hipew_lazy ? static_cast<t##name *>( []( auto... args ) { static HipewLazySymbol<t##name> symbol; return hipewLazyCall( symbol, #name, lib, args... ); } ) \
+                          : (t##name *)dynamic_library_find(lib, #name);
+
 
 static DynamicLibrary hip_lib = NULL;
 static DynamicLibrary hiprtc_lib = NULL;
+// the library of the hiprtc functions: hiprtc_lib, or hip_lib for the runtimes which include hiprtc.
+// it's loaded the first time a symbol is searched in it, so hiprtc is only mapped by the processes which use it ( see hipewLoadRtc ).
+struct HipewRtcLibrary { operator DynamicLibrary() const; };
+static HipewRtcLibrary rtcLib;
+static int hipew_lazy = 1;
+
+template<typename R>
+static constexpr bool hipewIsStatus = std::is_same<R, hipError_t>::value || std::is_same<R, hiprtcResult>::value;
+
+// the result of a function whose symbol is missing from the library.
+// the status is an error, the other types are a value the caller can tell from a result, or a default value after a message.
+template<typename R>
+static R hipewMissingSymbol()
+{
+  if constexpr( std::is_same<R, hipError_t>::value ) return hipErrorSharedObjectSymbolNotFound;
+  else if constexpr( std::is_same<R, hiprtcResult>::value ) return HIPRTC_ERROR_INTERNAL_ERROR;
+  else if constexpr( std::is_same<R, const char*>::value ) return "hipew: symbol not found";
+  else if constexpr( std::is_same<R, int>::value ) return -1;
+  else {
+    static_assert( std::is_class<R>::value, "the result of a missing symbol must be defined" );
+    return R{};
+  }
+}
+
+// the symbol of a function, resolved by its first call.
+template<typename F>
+struct HipewLazySymbol
+{
+  std::once_flag once;
+  F* fn = NULL;
+};
+
+// the calls of a function with lazy resolution. the first one resolves the symbol, the concurrent ones wait for it.
+// lib is a DynamicLibrary or rtcLib, only converted by the first call.
+template<typename F, typename L, typename... Args>
+static auto hipewLazyCall( HipewLazySymbol<F>& symbol, const char* name, const L& lib, Args... args )
+{
+  using R = decltype( symbol.fn( args... ) );
+  std::call_once( symbol.once, [&]() {
+    symbol.fn = (F *)dynamic_library_find(static_cast<DynamicLibrary>(lib), name);
+    if (symbol.fn == NULL && !hipewIsStatus<R>) {
+      fprintf(stderr, "HIP: %s not found in the library\n", name);
+    }
+  } );
+  if (symbol.fn == NULL) {
+    return hipewMissingSymbol<R>();
+  }
+  return symbol.fn( args... );
+}
 
 
 #pragma region OROCHI_SUMMONER_REGION_hipew_cpp_1
@@ -557,6 +619,78 @@ static DynamicLibrary dynamic_library_open_find(const char **paths) {
   return NULL;
 }
 
+// the paths given to hipewInit, kept for the load of hiprtc.
+static std::vector<std::string> hiprtc_custom_paths;
+static std::atomic<int> hiprtc_status( HIPEW_NOT_INITIALIZED );
+
+static int hipewOpenRtc(void) {
+#ifdef _WIN32
+  const char* hiprtc_paths[] = {
+      "hiprtc0605.dll",
+      "hiprtc0604.dll",
+      "hiprtc0603.dll",
+      "hiprtc0602.dll",
+      "hiprtc0601.dll",
+      "hiprtc0600.dll",
+      "hiprtc0507.dll",  
+      "hiprtc0506.dll", 
+      "hiprtc0505.dll", 
+      "hiprtc0504.dll",
+      "hiprtc0503.dll",
+      NULL };
+#elif defined(__APPLE__)
+  const char* hiprtc_paths[] = { NULL };
+#else
+  const char* hiprtc_paths[] = { 
+
+      // we first try the specific '5.x' or '6.x' version
+      "/opt/rocm/hip/lib/libhiprtc.so.6",
+      "/opt/rocm/lib/libhiprtc.so.6", 
+      "libhiprtc.so.6",
+
+      "/opt/rocm/hip/lib/libhiprtc.so.5",
+      "/opt/rocm/lib/libhiprtc.so.5", 
+      "libhiprtc.so.5",
+
+      // .. if it doesn't exist, we take the generic symbolic link.
+      // if it links to any version above 5, it will be able to run HIP 5 code.
+      "/opt/rocm/hip/lib/libhiprtc.so",
+      "/opt/rocm/lib/libhiprtc.so", 
+      "libhiprtc.so",
+      NULL };
+#endif
+
+  std::vector<const char*> custom_paths;
+  for (const std::string& path : hiprtc_custom_paths) {
+    custom_paths.push_back(path.c_str());
+  }
+  custom_paths.push_back(NULL);
+  hiprtc_lib = dynamic_library_open_find(hiprtc_custom_paths.empty() ? hiprtc_paths : custom_paths.data());
+
+  // the runtimes which include hiprtc export its functions themselves.
+  if (dynamic_library_find(hiprtc_lib ? hiprtc_lib : hip_lib, "hiprtcGetErrorString") == NULL) {
+    return HIPEW_ERROR_OPEN_FAILED;
+  }
+  return HIPEW_SUCCESS;
+}
+
+// loads hiprtc the first time it's called ( thread-safe ), and returns the result.
+static int hipewLoadRtc(void) {
+  static const int result = hipewOpenRtc();
+  hiprtc_status = result;
+  return result;
+}
+
+HipewRtcLibrary::operator DynamicLibrary() const {
+  hipewLoadRtc();
+  return hiprtc_lib ? hiprtc_lib : hip_lib;
+}
+
+int hipewRtcStatus(void) {
+  const int status = hiprtc_status;
+  return status == HIPEW_NOT_INITIALIZED ? HIPEW_DEFERRED : status;
+}
+
 // Implementation function.
 static void hipewHipExit(void) {
   if (hip_lib != NULL) {
@@ -622,23 +756,9 @@ void hipewInit( int* resultDriver, int* resultRtc, uint32_t flags, const char**
       "amdhip64.dll",   // <- hip '5.x' DLL.
       "amdhip64_6.dll", // <- if the hip 5 doesn't exist, try the hip '6.x' DLL. This newer DLL will be able to run HIP 5 code.
       NULL };
-  const char* hiprtc_paths[] = {
-      "hiprtc0605.dll",
-      "hiprtc0604.dll",
-      "hiprtc0603.dll",
-      "hiprtc0602.dll",
-      "hiprtc0601.dll",
-      "hiprtc0600.dll",
-      "hiprtc0507.dll",  
-      "hiprtc0506.dll", 
-      "hiprtc0505.dll", 
-      "hiprtc0504.dll",
-      "hiprtc0503.dll",
-      NULL };
 #elif defined(__APPLE__)
   // Default installation path. 
   const char *hip_paths[] = {"", NULL};
-  const char* hiprtc_paths[] = { NULL };
 #else
   const char *hip_paths[] = { 
 
@@ -659,23 +779,6 @@ void hipewInit( int* resultDriver, int* resultRtc, uint32_t flags, const char**
 
       NULL };
 
-  const char* hiprtc_paths[] = { 
-
-      // we first try the specific '5.x' or '6.x' version
-      "/opt/rocm/hip/lib/libhiprtc.so.6",
-      "/opt/rocm/lib/libhiprtc.so.6", 
-      "libhiprtc.so.6",
-
-      "/opt/rocm/hip/lib/libhiprtc.so.5",
-      "/opt/rocm/lib/libhiprtc.so.5", 
-      "libhiprtc.so.5",
-
-      // .. if it doesn't exist, we take the generic symbolic link.
-      // if it links to any version above 5, it will be able to run HIP 5 code.
-      "/opt/rocm/hip/lib/libhiprtc.so",
-      "/opt/rocm/lib/libhiprtc.so", 
-      "libhiprtc.so",
-      NULL };
 
 #endif
 
@@ -691,6 +794,7 @@ void hipewInit( int* resultDriver, int* resultRtc, uint32_t flags, const char**
   }
 
   initialized = 1;
+  hipew_lazy = ( flags & HIPEW_INIT_EAGER ) == 0;
 
   int error = atexit( hipewHipExit );
   if (error) {
@@ -714,7 +818,9 @@ void hipewInit( int* resultDriver, int* resultRtc, uint32_t flags, const char**
 
   /* Load library. */
   hip_lib = dynamic_library_open_find(customPaths_Hip ? customPaths_Hip : hip_paths);
-  hiprtc_lib = dynamic_library_open_find(customPaths_Hiprtc ? customPaths_Hiprtc : hiprtc_paths);
+  for (int i = 0; customPaths_Hiprtc && customPaths_Hiprtc[i]; ++i) {
+    hiprtc_custom_paths.push_back(customPaths_Hiprtc[i]);
+  }
 
   if (hip_lib == NULL) {
     s_resultDriver = HIPEW_ERROR_ATEXIT_FAILED;
@@ -1174,9 +1280,8 @@ _LIBRARY_FIND( hip_lib, hipWaitExternalSemaphoresAsync );
 	return;
   }
 
-  auto rtcLib = hiprtc_lib ? hiprtc_lib : hip_lib;
-  _LIBRARY_FIND( rtcLib, hiprtcGetErrorString );
-  if( hiprtcGetErrorString )
+  // with the lazy resolution, hiprtc is loaded by the first call of one of its functions.
+  if( hipew_lazy || hipewLoadRtc() == HIPEW_SUCCESS )
   {
 
 
@@ -1213,7 +1318,7 @@ _LIBRARY_FIND( rtcLib, hiprtcVersion );
 #pragma endregion
 
 
-	s_resultRtc = HIPEW_SUCCESS;
+	s_resultRtc = hipew_lazy ? HIPEW_DEFERRED : HIPEW_SUCCESS;
 	*resultRtc = s_resultRtc;
   }
   else
@@ -1225,6 +1330,8 @@ _LIBRARY_FIND( rtcLib, hiprtcVersion );
 
 
 #ifndef HIPEW_DO_NOT_CHECK_VERSION // not recommanded to define this flag, but just give a possibility for the developer to do it...
+    // resolved now to know if it exists, as it's called right away anyway.
+    _LIBRARY_FIND_EAGER( hip_lib, hipRuntimeGetVersion );
     if ( hipRuntimeGetVersion )
     {
       int runtimeVersion = 0;
@@ -1237,7 +1344,7 @@ _LIBRARY_FIND( rtcLib, hiprtcVersion );
       }
     }
 
-    if (hiprtcVersion) 
+    if (hiprtcVersion && s_resultRtc == HIPEW_SUCCESS) 
     {
       int major, minor = 0;
       hiprtcVersion(&major, &minor);
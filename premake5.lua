@@ -8,6 +8,16 @@ newoption {
    description = "Use precompiled kernels"
 }
 
+newoption {
+   trigger = "tieredJit",
+   description = "RadixSort starts with the precompiled kernels if they are next to the binary, and switches to the kernels tuned for the device once they are compiled in the background"
+}
+
+newoption {
+   trigger = "embedKernels",
+   description = "Embed the RadixSort kernels compiled for each architecture in the binary, the kernels being compiled at runtime only for the other architectures"
+}
+
 newoption {
    trigger = "kernelcompile",
    description = "Compile kernels used for unit test"
@@ -69,7 +79,7 @@ workspace "YamatanoOrochi"
       buildToolset = "clang"
    end
    if os.istarget("linux") then
-      links { "dl" }
+      links { "dl", "pthread" }
    end
 
   filter {"platforms:x64", "configurations:Debug"}
@@ -104,6 +114,19 @@ workspace "YamatanoOrochi"
 		defines {"ORO_PRECOMPILED"}
 	end
 
+   if _OPTIONS["tieredJit"] then
+		defines {"ORO_PP_TIERED_JIT"}
+	end
+
+   if _OPTIONS["embedKernels"] then
+		defines {"ORO_PP_EMBEDDED_KERNELS"}
+      if os.ishost("windows") then
+         os.execute(".\\tools\\embedKernels.bat")
+      else
+         os.execute("sh ./tools/embedKernels.sh")
+      end
+	end
+
 
 	-- try to enable CUDA if possible.
 	include "./Orochi/enable_cuew"
@@ -117,9 +140,12 @@ workspace "YamatanoOrochi"
    	include "./Test/DeviceEnum"
 	include "./Test/WMMA"
 	include "./Test/Texture"
+	include "./Test/Replay"
    
      if os.istarget("windows") then
         include "./Test/VulkanComputeSimple"
         include "./Test/RadixSort"
         include "./Test/simpleD3D12"
      end
+   group "Tools"
+	include "./tools/CacheBundle"
@@ -0,0 +1,426 @@
+//
+// Copyright (c) 2021-2024 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Offline builder of a cache bundle ( see OrochiUtils::mountCacheBundle ).
+// Compiles the kernels of a manifest for a list of architectures, in parallel, and writes all the binaries in a single bundle.
+//
+// usage: CacheBundle <manifest.json> <output bundle> [architectures.json] [-j <threads>]
+//
+// manifest.json:
+// {
+//     "kernels": [
+//         { "path": "../UnitTest/testKernel.h", "options": [ "-I../" ] },
+//         ...
+//     ]
+// }
+// architectures.json has the format of scripts/amdGpuList.json ( the "amd" list is used ).
+// the paths and the options must be the ones given at runtime to OrochiUtils, so the keys match. the tool must be run from the same directory.
+
+#include <Orochi/Orochi.h>
+#include <Orochi/OrochiUtils.h>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+// minimal json parser, enough for the manifest and the architecture list.
+struct JsonValue
+{
+	enum class Type
+	{
+		NONE,
+		STRING,
+		ARRAY,
+		OBJECT,
+		OTHER,
+	};
+	Type type = Type::NONE;
+	std::string string;
+	std::vector<JsonValue> array;
+	std::vector<std::pair<std::string, JsonValue>> object;
+
+	const JsonValue* find( const std::string& key ) const
+	{
+		for( const auto& member : object )
+		{
+			if( member.first == key ) return &member.second;
+		}
+		return nullptr;
+	}
+
+	std::vector<std::string> strings() const
+	{
+		std::vector<std::string> out;
+		for( const JsonValue& v : array )
+		{
+			if( v.type == Type::STRING ) out.push_back( v.string );
+		}
+		return out;
+	}
+};
+
+class JsonParser
+{
+  public:
+	JsonParser( const std::string& text ) : m_text( text ) {}
+
+	bool parse( JsonValue& value )
+	{
+		if( !parseValue( value ) ) return false;
+		skipSpaces();
+		return m_pos == m_text.size();
+	}
+
+  private:
+	void skipSpaces()
+	{
+		while( m_pos < m_text.size() && isspace( static_cast<unsigned char>( m_text[m_pos] ) ) )
+			m_pos++;
+	}
+
+	// appends the code point c in UTF-8.
+	static void appendUtf8( uint32_t c, std::string& out )
+	{
+		if( c < 0x80 )
+			out += static_cast<char>( c );
+		else if( c < 0x800 )
+		{
+			out += static_cast<char>( 0xc0 | ( c >> 6 ) );
+			out += static_cast<char>( 0x80 | ( c & 0x3f ) );
+		}
+		else if( c < 0x10000 )
+		{
+			out += static_cast<char>( 0xe0 | ( c >> 12 ) );
+			out += static_cast<char>( 0x80 | ( ( c >> 6 ) & 0x3f ) );
+			out += static_cast<char>( 0x80 | ( c & 0x3f ) );
+		}
+		else
+		{
+			out += static_cast<char>( 0xf0 | ( c >> 18 ) );
+			out += static_cast<char>( 0x80 | ( ( c >> 12 ) & 0x3f ) );
+			out += static_cast<char>( 0x80 | ( ( c >> 6 ) & 0x3f ) );
+			out += static_cast<char>( 0x80 | ( c & 0x3f ) );
+		}
+	}
+
+	// the 4 hexadecimal digits of a \u escape.
+	bool parseHex4( uint32_t& out )
+	{
+		if( m_pos + 4 > m_text.size() ) return false;
+		out = 0;
+		for( int i = 0; i < 4; i++ )
+		{
+			const char c = m_text[m_pos++];
+			if( !isxdigit( static_cast<unsigned char>( c ) ) ) return false;
+			out = out * 16 + ( isdigit( static_cast<unsigned char>( c ) ) ? c - '0' : ( tolower( c ) - 'a' + 10 ) );
+		}
+		return true;
+	}
+
+	bool parseString( std::string& out )
+	{
+		if( m_text[m_pos] != '"' ) return false;
+		m_pos++;
+		while( m_pos < m_text.size() && m_text[m_pos] != '"' )
+		{
+			const char c = m_text[m_pos++];
+			if( c != '\\' )
+			{
+				out += c;
+				continue;
+			}
+			if( m_pos == m_text.size() ) return false;
+			const char escape = m_text[m_pos++];
+			switch( escape )
+			{
+			case '"':
+			case '\\':
+			case '/':
+				out += escape;
+				break;
+			case 'b':
+				out += '\b';
+				break;
+			case 'f':
+				out += '\f';
+				break;
+			case 'n':
+				out += '\n';
+				break;
+			case 'r':
+				out += '\r';
+				break;
+			case 't':
+				out += '\t';
+				break;
+			case 'u':
+			{
+				uint32_t code;
+				if( !parseHex4( code ) ) return false;
+				// the code points above 0xffff are a pair of surrogates
+				if( code >= 0xd800 && code < 0xdc00 )
+				{
+					uint32_t low;
+					if( m_text.compare( m_pos, 2, "\\u" ) != 0 ) return false;
+					m_pos += 2;
+					if( !parseHex4( low ) || low < 0xdc00 || low >= 0xe000 ) return false;
+					code = 0x10000 + ( ( code - 0xd800 ) << 10 ) + ( low - 0xdc00 );
+				}
+				else if( code >= 0xdc00 && code < 0xe000 )
+					return false;
+				appendUtf8( code, out );
+				break;
+			}
+			default:
+				return false;
+			}
+		}
+		if( m_pos == m_text.size() ) return false;
+		m_pos++;
+		return true;
+	}
+
+	bool parseValue( JsonValue& value )
+	{
+		skipSpaces();
+		if( m_pos == m_text.size() ) return false;
+
+		const char c = m_text[m_pos];
+		if( c == '"' )
+		{
+			value.type = JsonValue::Type::STRING;
+			return parseString( value.string );
+		}
+		if( c == '[' )
+		{
+			value.type = JsonValue::Type::ARRAY;
+			m_pos++;
+			skipSpaces();
+			if( m_pos < m_text.size() && m_text[m_pos] == ']' )
+			{
+				m_pos++;
+				return true;
+			}
+			while( true )
+			{
+				value.array.emplace_back();
+				if( !parseValue( value.array.back() ) ) return false;
+				skipSpaces();
+				if( m_pos == m_text.size() ) return false;
+				if( m_text[m_pos++] == ']' ) return true;
+				if( m_text[m_pos - 1] != ',' ) return false;
+			}
+		}
+		if( c == '{' )
+		{
+			value.type = JsonValue::Type::OBJECT;
+			m_pos++;
+			skipSpaces();
+			if( m_pos < m_text.size() && m_text[m_pos] == '}' )
+			{
+				m_pos++;
+				return true;
+			}
+			while( true )
+			{
+				skipSpaces();
+				std::string key;
+				if( m_pos == m_text.size() || !parseString( key ) ) return false;
+				skipSpaces();
+				if( m_pos == m_text.size() || m_text[m_pos++] != ':' ) return false;
+				value.object.emplace_back( key, JsonValue() );
+				if( !parseValue( value.object.back().second ) ) return false;
+				skipSpaces();
+				if( m_pos == m_text.size() ) return false;
+				if( m_text[m_pos++] == '}' ) return true;
+				if( m_text[m_pos - 1] != ',' ) return false;
+			}
+		}
+
+		// numbers, true, false, null: not used by the tool
+		value.type = JsonValue::Type::OTHER;
+		while( m_pos < m_text.size() && m_text[m_pos] != ',' && m_text[m_pos] != ']' && m_text[m_pos] != '}' && !isspace( static_cast<unsigned char>( m_text[m_pos] ) ) )
+			m_pos++;
+		return true;
+	}
+
+	const std::string& m_text;
+	size_t m_pos = 0;
+};
+
+bool readJson( const std::string& path, JsonValue& value )
+{
+	std::ifstream f( path );
+	if( !f.is_open() )
+	{
+		printf( "cannot open %s\n", path.c_str() );
+		return false;
+	}
+	std::stringstream ss;
+	ss << f.rdbuf();
+	const std::string text = ss.str();
+	if( !JsonParser( text ).parse( value ) )
+	{
+		printf( "cannot parse %s\n", path.c_str() );
+		return false;
+	}
+	return true;
+}
+
+struct Kernel
+{
+	std::string path;
+	std::string source;
+	std::vector<std::string> options;
+};
+
+struct Job
+{
+	const Kernel* kernel;
+	std::string arch;
+	std::string key;
+	std::vector<char> binary;
+	bool success = false;
+};
+} // namespace
+
+int main( int argc, char** argv )
+{
+	std::vector<std::string> args;
+	unsigned int numThreads = std::max( 1u, std::thread::hardware_concurrency() );
+	for( int i = 1; i < argc; i++ )
+	{
+		if( std::string( argv[i] ) == "-j" && i + 1 < argc )
+			numThreads = std::max( 1, atoi( argv[++i] ) );
+		else
+			args.push_back( argv[i] );
+	}
+	if( args.size() < 2 )
+	{
+		printf( "usage: CacheBundle <manifest.json> <output bundle> [architectures.json] [-j <threads>]\n" );
+		return 1;
+	}
+	const std::string archListPath = ( args.size() > 2 ) ? args[2] : "../scripts/amdGpuList.json";
+
+	JsonValue manifest;
+	JsonValue archList;
+	if( !readJson( args[0], manifest ) || !readJson( archListPath, archList ) ) return 1;
+
+	std::vector<std::string> archs;
+	if( const JsonValue* amd = archList.find( "amd" ) ) archs = amd->strings();
+
+	std::vector<Kernel> kernels;
+	if( const JsonValue* list = manifest.find( "kernels" ) )
+	{
+		for( const JsonValue& k : list->array )
+		{
+			const JsonValue* path = k.find( "path" );
+			if( !path || path->type != JsonValue::Type::STRING ) continue;
+
+			Kernel kernel;
+			kernel.path = path->string;
+			if( const JsonValue* options = k.find( "options" ) ) kernel.options = options->strings();
+			if( !OrochiUtils::readSourceCode( kernel.path, kernel.source ) )
+			{
+				printf( "cannot read %s\n", kernel.path.c_str() );
+				return 1;
+			}
+			kernels.push_back( kernel );
+		}
+	}
+	if( kernels.empty() || archs.empty() )
+	{
+		printf( "nothing to compile ( %zu kernels, %zu architectures )\n", kernels.size(), archs.size() );
+		return 1;
+	}
+
+	// the bundles are for HIP, the compiler doesn't need any device.
+	if( oroInitialize( ORO_API_HIP, 0 ) != 0 )
+	{
+		printf( "initialization failed\n" );
+		return 1;
+	}
+
+	std::vector<Job> jobs;
+	for( const Kernel& kernel : kernels )
+	{
+		for( const std::string& arch : archs )
+		{
+			Job job;
+			job.kernel = &kernel;
+			job.arch = arch;
+			jobs.push_back( job );
+		}
+	}
+
+	printf( "compiling %zu kernels for %zu architectures on %u threads\n", kernels.size(), archs.size(), numThreads );
+
+	std::atomic<size_t> next{ 0 };
+	std::vector<std::thread> threads;
+	for( unsigned int t = 0; t < numThreads; t++ )
+	{
+		threads.emplace_back(
+			[&]()
+			{
+				for( size_t i = next++; i < jobs.size(); i = next++ )
+				{
+					Job& job = jobs[i];
+					std::vector<const char*> opts;
+					for( const std::string& o : job.kernel->options )
+						opts.push_back( o.c_str() );
+					job.success = OrochiUtils::compileForCacheBundle( job.kernel->source.c_str(), job.kernel->path.c_str(), &opts, job.arch.c_str(), 0, nullptr, nullptr, job.key, job.binary );
+				}
+			} );
+	}
+	for( std::thread& t : threads )
+		t.join();
+
+	std::vector<std::pair<std::string, std::vector<char>>> entries;
+	std::unordered_set<std::string> keys;
+	int numFailed = 0;
+	for( Job& job : jobs )
+	{
+		if( !job.success )
+		{
+			printf( "FAILED: %s for %s\n", job.kernel->path.c_str(), job.arch.c_str() );
+			numFailed++;
+			continue;
+		}
+		if( keys.insert( job.key ).second ) entries.emplace_back( job.key, std::move( job.binary ) );
+	}
+
+	if( !OrochiUtils::writeCacheBundle( args[1], entries ) )
+	{
+		printf( "cannot write %s\n", args[1].c_str() );
+		return 1;
+	}
+	printf( "%zu entries written to %s ( %d failed )\n", entries.size(), args[1].c_str(), numFailed );
+	return numFailed ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+#!/usr/bin/env python
+# Compiles a kernel source once per architecture and writes the code objects as byte arrays in a header, with an index by architecture.
+# usage: python tools/embedKernels.py <kernel source> <name> > <header>
+# the index is OrochiUtils::EmbeddedBinary <name>Binaries[] ( see OrochiUtils::findEmbeddedBinary ).
+# the architectures which fail to compile ( or the compilers missing ) are left out of the index, the runtime compiles the kernels for them.
+from __future__ import print_function
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+# the NVIDIA architectures, as "sm_XY" like OrochiUtils::findEmbeddedBinary.
+nvidiaArchs = [ 'sm_60', 'sm_70', 'sm_75', 'sm_80', 'sm_86', 'sm_89', 'sm_90' ]
+
+
+def getAmdArchs():
+	f = open( os.path.join( os.path.dirname( os.path.abspath( __file__ ) ), '../scripts/amdGpuList.json' ) )
+	gpus = json.load( f )
+	f.close()
+	return gpus['amd']
+
+
+def compile( src, arch, dst ):
+	if arch.startswith( 'gfx' ):
+		command = [ 'hipcc', '-x', 'hip', src, '-O3', '-std=c++17', '-ffast-math', '--cuda-device-only', '--genco', '-I./', '-include', 'hip/hip_runtime.h', '--offload-arch=' + arch, '-o', dst ]
+	else:
+		command = [ 'nvcc', '-x', 'cu', src, '-O3', '-std=c++17', '--use_fast_math', '-cubin', '-arch=' + arch, '-I./', '-include', 'cuda_runtime.h', '-o', dst ]
+
+	try:
+		p = subprocess.Popen( command, stdout=subprocess.PIPE, stderr=subprocess.PIPE )
+		p.communicate()
+	except OSError:
+		return None
+	if p.returncode != 0 or not os.path.exists( dst ):
+		return None
+
+	f = open( dst, 'rb' )
+	data = f.read()
+	f.close()
+	return data
+
+
+def toArray( name, data ):
+	lines = [ 'static const unsigned char ' + name + '[] = {' ]
+	for i in range( 0, len( data ), 32 ):
+		lines.append( '\t' + ','.join( str( b ) for b in bytearray( data[i:i + 32] ) ) + ',' )
+	lines.append( '};' )
+	return '\n'.join( lines )
+
+
+src = sys.argv[1]
+name = sys.argv[2]
+
+binaries = []
+tmpDir = tempfile.mkdtemp()
+for arch in getAmdArchs() + nvidiaArchs:
+	data = compile( src, arch, os.path.join( tmpDir, name + '_' + arch ) )
+	if data is None:
+		print( 'warning: ' + name + ' not embedded for ' + arch, file=sys.stderr )
+		continue
+	binaries.append( ( arch, data ) )
+
+print( '#pragma once' )
+print( '#include <Orochi/OrochiUtils.h>' )
+print( 'namespace hip' )
+print( '{' )
+for arch, data in binaries:
+	print( toArray( name + '_' + arch, data ) )
+if binaries:
+	print( 'static const OrochiUtils::EmbeddedBinary ' + name + 'Binaries[] = {' )
+	for arch, data in binaries:
+		print( '\t{ "' + arch + '", ' + name + '_' + arch + ', sizeof( ' + name + '_' + arch + ' ) },' )
+	print( '};' )
+else:
+	print( 'static const OrochiUtils::EmbeddedBinary* ' + name + 'Binaries = nullptr;' )
+print( 'static const int ' + name + 'NumBinaries = ' + str( len( binaries ) ) + ';' )
+print( '} // namespace hip' )
@@ -0,0 +1,2 @@
+echo "// automatically generated, don't edit" > ParallelPrimitives/cache/EmbeddedKernels.h
+python tools/embedKernels.py ./ParallelPrimitives/RadixSortKernels.h RadixSortKernels >> ParallelPrimitives/cache/EmbeddedKernels.h
@@ -10,9 +10,11 @@ def genArgs( fileName, api, includes ):
         
         print( '#if !defined(ORO_PP_LOAD_FROM_STRING)' )
         print( '	static const char** '+iName+'Args = 0;' )
+        print( '	static const int '+iName+'NumIncludes = 0;' )
         print( '#else' )
         print( '	static const char* '+iName+'Args[] = {' )
         includes += iName +'Includes[] = {'
+        numIncludes = 0
         for line in f.readlines():
             a = line.strip('\r\n')
             if a.find('#include') == -1:
@@ -30,7 +32,10 @@ def genArgs( fileName, api, includes ):
             name = name.split('.h')[0]
             name = api + '_'+name
             print ( name + ',' )
+            numIncludes += 1
         print( api + '_'+iName+'};' )
+        # the first NumIncludes entries of Args are the headers named in Includes, ready for OrochiUtils::registerIncludes
+        print( '	static const int '+iName+'NumIncludes = ' + str( numIncludes ) + ';' )
         print( '#endif' )
         return includes
 